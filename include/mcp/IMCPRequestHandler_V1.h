@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <memory>
+
+namespace mcp {
+
+// Forward declaration for MCPMessage_V1
+struct MCPMessage_V1;
+
+/**
+ * @brief Interface for modules that answer on-demand queries.
+ *
+ * This interface is implemented by provider modules whose context is
+ * expensive to produce and rarely needed (e.g. a large state dump). Instead
+ * of publishing periodically, the module registers as the request handler
+ * of a topic and computes the data only when another module asks for it
+ * through MCPBroker::request().
+ *
+ * Version 1 of the interface.
+ */
+class IMCPRequestHandler_V1 {
+public:
+    virtual ~IMCPRequestHandler_V1() = default;
+
+    /**
+     * @brief Answer a request.
+     *
+     * Called on a broker worker thread, never on the audio thread. The
+     * request's correlationId identifies it; the broker copies it to the
+     * returned reply.
+     *
+     * @param request The request message.
+     * @return std::shared_ptr<MCPMessage_V1> The reply, or nullptr to answer
+     *         later with MCPBroker::reply() (before the request times out).
+     */
+    virtual std::shared_ptr<MCPMessage_V1> onMCPRequest(const MCPMessage_V1* request) = 0;
+};
+
+} // namespace mcp
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "IMCPSubscriber_V1.h"
+#include <cstddef>
+
+namespace mcp {
+
+/**
+ * @brief Interface for subscribers that take their messages in batches.
+ *
+ * A subscriber that implements this interface receives every message queued
+ * for it in a single onMCPMessages() call instead of one virtual call per
+ * message, which pays off for consumers with high per-call overhead (e.g.
+ * ones that lock or wake another thread per callback). Under light load a
+ * batch holds a single message; it grows as messages back up behind a
+ * running callback.
+ *
+ * Subscribe it like any other subscriber (IMCPSubscriber_V2 derives from
+ * IMCPSubscriber_V1); the broker detects the interface at subscription
+ * time. Batches of one subscription arrive in publication order and never
+ * overlap, but for CallbackExecutor::INLINE subscriptions they run as their
+ * own dispatch entry rather than inside the topic's fan-out.
+ *
+ * Version 2 of the subscriber interface.
+ */
+class IMCPSubscriber_V2 : public IMCPSubscriber_V1 {
+public:
+    virtual ~IMCPSubscriber_V2() = default;
+
+    /**
+     * @brief Callback function called with the messages queued for this subscriber.
+     *
+     * Called on a worker thread, not on the audio thread. The messages stay
+     * valid only for the duration of the call.
+     *
+     * @param messages The messages, oldest first.
+     * @param count Number of messages (at least 1).
+     */
+    virtual void onMCPMessages(const MCPMessage_V1* const* messages, std::size_t count) = 0;
+
+    /**
+     * @brief Adapter for paths that deliver a single message (e.g. MCPBroker::sendTo()).
+     *
+     * Forwards the message as a batch of one.
+     *
+     * @param message The message that was published.
+     */
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        onMCPMessages(&message, 1);
+    }
+};
+
+} // namespace mcp
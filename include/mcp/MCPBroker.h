@@ -1,19 +1,425 @@
 #pragma once
 
 #include "IMCPBroker.h"
+#include "IMCPRequestHandler_V1.h"
+#include "IMCPSubscriber_V2.h"
+#include "MCPDispatchQueue.h"
+#include "MCPTopicHistory.h"
+#include "MCPDerivedTopic.h"
+#include "MCPWorkStealingPool.h"
+#include "MCPFlowControl.h"
+#include "MCPSerialization.h"
+#include "MCPSnapshot.h"
+#include "MCPErrorReports.h"
+#include "MCPContentCache.h"
 #include <string>
 #include <vector>
 #include <map>
 #include <mutex>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
+#include <deque>
 #include <queue>
 #include <condition_variable>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
 
 namespace mcp {
 
+/**
+ * @brief Semantics of a topic's messages.
+ *
+ * STATE topics carry the current value of something (a parameter, a preset
+ * name); only the latest value matters, so they may be coalesced. EVENT
+ * topics carry discrete occurrences that must each be delivered.
+ */
+enum class TopicKind {
+    EVENT,
+    STATE
+};
+
+/**
+ * @brief What a provider declares about a topic when registering it.
+ *
+ * With a descriptor the broker no longer has to treat the topic generically:
+ * the topic's dispatch sub-queue is set up at registration instead of on the
+ * first publish, its kind decides whether it may be conflated, and publishes
+ * that do not match it are rejected before they are queued.
+ */
+struct TopicDescriptor {
+    /**
+     * Top-level type of the payload; ANY skips the check. Only MessagePack
+     * payloads are checked, from their first byte.
+     */
+    PayloadType payloadType = PayloadType::ANY;
+
+    /** Required data format (e.g. DataFormat::MSGPACK); empty accepts any. */
+    std::string dataFormat;
+
+    /** State or event semantics (see MCPBroker::setTopicKind()). */
+    TopicKind kind = TopicKind::EVENT;
+
+    /**
+     * Nominal publish rate in Hz, zero if unknown. Informational: lets
+     * subscribers pick a SubscriptionOptions::minInterval.
+     */
+    double nominalRate = 0.0;
+
+    /** Largest payload in bytes; zero for no limit. */
+    std::size_t maxPayloadSize = 0;
+
+    bool operator==(const TopicDescriptor& other) const {
+        return payloadType == other.payloadType && dataFormat == other.dataFormat &&
+               kind == other.kind && nominalRate == other.nominalRate &&
+               maxPayloadSize == other.maxPayloadSize;
+    }
+
+    bool operator!=(const TopicDescriptor& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief Latency requirement of a subscription.
+ *
+ * Classes are listed from most to least urgent. Each class implies a default
+ * relative deadline (REALTIME 1 ms, INTERACTIVE 16 ms, NORMAL 50 ms,
+ * BACKGROUND 250 ms) measured from the moment a message is published.
+ */
+enum class LatencyClass {
+    REALTIME,
+    INTERACTIVE,
+    NORMAL,
+    BACKGROUND
+};
+
+/**
+ * @brief Where a subscriber's onMCPMessage() calls run.
+ *
+ * Whatever the executor, a subscriber receives the messages of one topic
+ * one at a time and in dispatch order.
+ */
+enum class CallbackExecutor {
+    /** On the broker's dispatch thread (the default; cheapest for light callbacks). */
+    INLINE,
+
+    /**
+     * On a shared work-stealing pool, so CPU-heavy subscribers run in parallel
+     * across cores instead of holding up the dispatch thread and each other.
+     */
+    SHARED_POOL,
+
+    /** On a thread owned by this subscription alone. */
+    DEDICATED_THREAD
+};
+
+/**
+ * @brief How a consumer group picks the member that receives a message.
+ */
+enum class GroupBalancing {
+    /** Members take turns. */
+    ROUND_ROBIN,
+
+    /**
+     * The member with the fewest messages still queued or running goes
+     * first (ties take turns). Useful with an off-thread executor, where
+     * slow members build up a backlog.
+     */
+    LEAST_LOADED
+};
+
+/**
+ * @brief Per-subscription options passed to MCPBroker::subscribe().
+ */
+struct SubscriptionOptions {
+    /**
+     * Latency class of the subscriber. Within each message, subscribers are
+     * called in class order and then earliest-deadline-first, so
+     * latency-critical consumers always go first.
+     */
+    LatencyClass latencyClass = LatencyClass::NORMAL;
+
+    /**
+     * Explicit relative deadline; zero uses the class default. The tightest
+     * deadline among a topic's subscribers also orders that topic's messages
+     * against other topics in the dispatch queue.
+     */
+    std::chrono::microseconds deadline{0};
+
+    /**
+     * Deliver the topic's retained history (see MCPBroker::enableHistory())
+     * before any live message. Every message is delivered exactly once:
+     * the replay ends with the last message dispatched before the
+     * subscription, and live delivery starts with the next one. A STATE
+     * topic without history replays its latest value instead (see
+     * MCPBroker::getRetainedValue()).
+     */
+    bool replayHistory = false;
+
+    /**
+     * For topics with a pyramid (see MCPBroker::enablePyramid()): the number
+     * of points the subscriber can use. It receives the coarsest MinMaxLevel
+     * with at least this many bins instead of the full array, or the full
+     * array if it has no such level. Zero always delivers the full array.
+     */
+    std::size_t targetResolution = 0;
+
+    /** Where the subscriber's callbacks run. */
+    CallbackExecutor executor = CallbackExecutor::INLINE;
+
+    /**
+     * Pool for CallbackExecutor::SHARED_POOL; null uses the broker's own
+     * pool (see MCPBroker::getCallbackPool()).
+     */
+    std::shared_ptr<WorkStealingPool> pool;
+
+    /**
+     * Consumer group of the subscription. Each message on the topic goes to
+     * exactly one member of each group instead of to every member, which
+     * turns the topic into a work queue for the group. Empty (the default)
+     * receives every message. Combine with an off-thread executor to spread
+     * the work across cores.
+     */
+    std::string group;
+
+    /**
+     * How the group picks a member. All members of a group should agree;
+     * the group follows its first member in fan-out order.
+     */
+    GroupBalancing balancing = GroupBalancing::ROUND_ROBIN;
+
+    /**
+     * Credit account of the subscriber; null (the default) delivers without
+     * flow control. Each delivery consumes a credit. Without credit the
+     * message is handled per creditPolicy and never reaches onMCPMessage()
+     * until credit is granted, so no dispatch time is spent on messages the
+     * subscriber would discard.
+     */
+    std::shared_ptr<DeliveryCredits> credits;
+
+    /** What to do with a message while the subscriber has no credit. */
+    CreditPolicy creditPolicy = CreditPolicy::HOLD;
+
+    /** Maximum messages kept per subscription under CreditPolicy::HOLD. */
+    std::size_t maxHeldMessages = 256;
+
+    /**
+     * Absolute deadband for numeric topics: a value is only delivered if it
+     * differs from the last value delivered to this subscriber by more than
+     * this. Zero disables it. Messages that are not a single MessagePack
+     * number are always delivered.
+     */
+    double deadbandAbsolute = 0.0;
+
+    /**
+     * Relative deadband for numeric topics, as a fraction of the last
+     * delivered value (0.005 = 0.5%). Zero disables it. With both deadbands
+     * set, the wider one applies.
+     */
+    double deadbandRelative = 0.0;
+
+    /**
+     * Minimum time between deliveries to this subscriber (1 / maximum rate);
+     * zero disables rate limiting. Messages arriving sooner replace each
+     * other, and the newest is delivered once the interval has passed, so
+     * the final value of a burst is never lost. Use this for display
+     * subscribers of fast state topics (e.g. 30 Hz meters).
+     */
+    std::chrono::microseconds minInterval{0};
+};
+
+/**
+ * @brief Configuration of adaptive auto-conflation.
+ *
+ * When enabled, the broker samples per-topic produce and consume rates every
+ * sampleWindow. A STATE topic whose publish rate exceeds its dispatch rate by
+ * overloadRatio while holding at least backlogThreshold queued messages is
+ * switched to latest-value coalescing. It reverts to normal queueing once a
+ * whole window passes without anything being coalesced and with no backlog.
+ */
+struct AdaptiveConflationConfig {
+    /** Whether adaptive conflation is active. */
+    bool enabled = false;
+
+    /** Length of the rate sampling window. */
+    std::chrono::milliseconds sampleWindow{100};
+
+    /** Minimum queued messages on the topic before it can be switched. */
+    std::size_t backlogThreshold = 16;
+
+    /** Produce/consume ratio above which a topic counts as overloaded. */
+    double overloadRatio = 1.0;
+};
+
+/**
+ * @brief Report of a topic switching in or out of coalescing.
+ */
+struct ConflationEvent {
+    /** The topic that switched. */
+    std::string topic;
+
+    /** True if the topic now coalesces, false if it reverted. */
+    bool conflating = false;
+
+    /** Publish rate during the last window, in messages per second. */
+    double produceRate = 0.0;
+
+    /** Dispatch rate during the last window, in messages per second. */
+    double consumeRate = 0.0;
+
+    /** Messages queued on the topic when the switch happened. */
+    std::size_t backlog = 0;
+};
+
+/**
+ * @brief Configuration of content-addressed payload deduplication.
+ *
+ * Payloads of at least minPayloadSize bytes are hashed on publish, and the
+ * first sighting of a payload is copied into the broker's content cache. A
+ * payload identical to the previous one on its topic is suppressed if the
+ * topic is a STATE topic (its subscribers already hold that value). A
+ * payload found in the cache is delivered as a reference to the cached blob
+ * instead of the publisher's copy, which is released right away;
+ * subscribers can skip decoding a payload whose data pointer they have seen
+ * before.
+ */
+struct ContentDedupConfig {
+    /** Smallest payload that is hashed, in bytes; 0 disables deduplication. */
+    std::size_t minPayloadSize = 0;
+
+    /** Maximum total size of the content cache, in bytes. */
+    std::size_t cacheCapacity = 4 * 1024 * 1024;
+};
+
+/**
+ * @brief Counters of content-addressed payload deduplication.
+ */
+struct ContentDedupStats {
+    /** Republished STATE payloads that were not dispatched. */
+    uint64_t suppressed = 0;
+
+    /** Messages delivered with a cached blob as their payload. */
+    uint64_t shared = 0;
+
+    /** Number of blobs in the content cache. */
+    std::size_t cachedPayloads = 0;
+
+    /** Total size of the blobs in the content cache, in bytes. */
+    std::size_t cachedBytes = 0;
+};
+
+/**
+ * @brief Outcome of a request sent with MCPBroker::request().
+ */
+enum class ReplyStatus {
+    /** The handler answered; Reply::message holds the answer. */
+    OK,
+
+    /** No request handler is registered for the topic. */
+    NO_HANDLER,
+
+    /** The handler did not answer within the timeout. */
+    TIMEOUT,
+
+    /** The handler threw an exception. */
+    FAILED,
+
+    /** The broker shut down or was cleared before an answer arrived. */
+    CANCELLED
+};
+
+/**
+ * @brief Answer to a request.
+ */
+struct Reply {
+    /** How the request ended. */
+    ReplyStatus status = ReplyStatus::CANCELLED;
+
+    /** The reply message (null unless status is OK). */
+    std::shared_ptr<MCPMessage_V1> message;
+};
+
+/**
+ * @brief Where the broker's dispatch work runs.
+ */
+enum class DispatchMode {
+    /** The broker runs its own dispatch worker pool (the default). */
+    WORKER_THREADS,
+
+    /**
+     * No broker threads; the host dispatches by calling MCPBroker::pump()
+     * from a thread of its own (never the audio thread).
+     */
+    MANUAL_PUMP
+};
+
+/**
+ * @brief Configuration of the broker's elastic dispatch worker pool.
+ *
+ * The broker always keeps minWorkers dispatch threads alive. When the queue
+ * backs up (depth or age of the oldest dispatchable message above the
+ * thresholds) an extra worker is spawned, at most one per scaleUpCooldown and
+ * never more than maxWorkers in total. Extra workers retire after they have
+ * found no work for idleRetireTime. The high watermark, the spawn cooldown and
+ * the idle period together provide hysteresis so the pool does not thrash.
+ *
+ * Messages of the same topic are never dispatched concurrently, so per-topic
+ * ordering holds for any pool size. With maxWorkers > 1, however, callbacks
+ * for DIFFERENT topics may run concurrently on the same subscriber.
+ */
+struct WorkerPoolConfig {
+    /** Number of workers that are always running (at least 1). */
+    std::size_t minWorkers = 1;
+
+    /** Upper bound on the number of workers. 1 disables elastic scaling. */
+    std::size_t maxWorkers = 1;
+
+    /** Queue depth at or above which an extra worker is spawned. */
+    std::size_t scaleUpQueueDepth = 64;
+
+    /** Age of the oldest dispatchable message at or above which an extra worker is spawned. */
+    std::chrono::milliseconds scaleUpMessageAge{5};
+
+    /** Minimum time between two spawns. */
+    std::chrono::milliseconds scaleUpCooldown{10};
+
+    /** Time an extra worker must stay idle before it retires. */
+    std::chrono::milliseconds idleRetireTime{500};
+};
+
+/**
+ * @brief A single pool-size change recorded by the broker.
+ */
+struct WorkerPoolSample {
+    /** Time at which the pool size changed. */
+    std::chrono::steady_clock::time_point time;
+
+    /** Number of workers after the change. */
+    std::size_t workers;
+};
+
+/**
+ * @brief Snapshot of the dispatch worker pool metrics.
+ */
+struct WorkerPoolStats {
+    /** Number of workers currently running. */
+    std::size_t currentWorkers = 0;
+
+    /** Largest number of workers that ran at the same time. */
+    std::size_t peakWorkers = 0;
+
+    /** Number of workers spawned since construction (core workers included). */
+    uint64_t workersSpawned = 0;
+
+    /** Number of surplus workers retired after staying idle. */
+    uint64_t workersRetired = 0;
+
+    /** Most recent pool-size changes, oldest first (bounded). */
+    std::vector<WorkerPoolSample> history;
+};
+
 /**
  * @brief Implementation of the MCP Broker.
  * 
@@ -49,6 +455,20 @@ public:
      */
     MCPBroker();
 
+    /**
+     * @brief Constructor selecting the dispatch mode.
+     * 
+     * With DispatchMode::WORKER_THREADS the worker threads start with the
+     * first publish (or other queued work, or setWorkerPoolConfig()), so
+     * creating the broker and registering a patch's modules spawn no
+     * threads. With DispatchMode::MANUAL_PUMP no worker thread is started
+     * and the worker pool configuration is ignored; messages wait in the
+     * queue until the host calls pump().
+     * 
+     * @param mode Where dispatch work runs.
+     */
+    explicit MCPBroker(DispatchMode mode);
+
     /**
      * @brief Destructor.
      * 
@@ -60,12 +480,126 @@ public:
     bool registerContext(const std::string& topic, 
                         std::shared_ptr<IMCPProvider_V1> provider) override;
     
+    /**
+     * @brief Register a provider for several topics at once.
+     * 
+     * Equivalent to calling registerContext() for each topic, but takes the
+     * registry lock once, which keeps loading a large patch fast.
+     * 
+     * Thread-safe - can be called from any thread.
+     * 
+     * @param topics The names of the topics being provided.
+     * @param provider A shared pointer to the provider module.
+     * @return std::size_t Number of topics the provider was newly registered for.
+     */
+    std::size_t registerContexts(const std::vector<std::string>& topics,
+                                 std::shared_ptr<IMCPProvider_V1> provider);
+    
+    /**
+     * @brief Register a context provider and declare the topic's payload.
+     * 
+     * Every provider of a topic must declare the same descriptor; the
+     * declaration stays in force until clearAllRegistries(). From then on
+     * publish() rejects messages on the topic whose format, size or payload
+     * type do not match.
+     * 
+     * Thread-safe - can be called from any thread.
+     * 
+     * @param topic The name of the topic being provided.
+     * @param provider A shared pointer to the provider module.
+     * @param descriptor What the topic's messages look like.
+     * @return bool True if registration was successful, false if the
+     *         provider is already registered or the topic was declared with
+     *         a different descriptor.
+     */
+    bool registerContext(const std::string& topic,
+                        std::shared_ptr<IMCPProvider_V1> provider,
+                        const TopicDescriptor& descriptor);
+    
+    /**
+     * @brief Register a context provider for a topic literal.
+     * 
+     * Like registerContext(const std::string&, ...), and in addition lets
+     * messages carrying the literal's hash skip hashing the topic name on
+     * their way through the broker.
+     * 
+     * @param topic The topic being provided.
+     * @param provider A shared pointer to the provider module.
+     * @return bool True if registration was successful, false if the
+     *         provider is already registered or another topic name has the
+     *         same hash.
+     */
+    bool registerContext(const TopicLiteral& topic,
+                        std::shared_ptr<IMCPProvider_V1> provider);
+    
     bool unregisterContext(const std::string& topic, 
                           std::shared_ptr<IMCPProvider_V1> provider) override;
     
+    /**
+     * @brief Get the descriptor a topic was registered with.
+     * 
+     * @param topic The topic name.
+     * @param descriptor Receives the descriptor.
+     * @return bool True if the topic has a descriptor.
+     */
+    bool getTopicDescriptor(const std::string& topic, TopicDescriptor& descriptor) const;
+    
     bool subscribe(const std::string& topic,
                   std::shared_ptr<IMCPSubscriber_V1> subscriber) override;
     
+    /**
+     * @brief Subscribe to a context topic with per-subscription options.
+     * 
+     * Subscribers implementing IMCPSubscriber_V2 receive their messages in
+     * batches through onMCPMessages().
+     * 
+     * Thread-safe - can be called from any thread.
+     * 
+     * @param topic The name of the topic to subscribe to.
+     * @param subscriber A shared pointer to the subscriber module.
+     * @param options Delivery options for this subscription.
+     * @return bool True if subscription was successful, false otherwise.
+     */
+    bool subscribe(const std::string& topic,
+                  std::shared_ptr<IMCPSubscriber_V1> subscriber,
+                  const SubscriptionOptions& options);
+    
+    /**
+     * @brief Subscribe to several topics at once with the same options.
+     * 
+     * Equivalent to calling subscribe() for each topic, but takes the
+     * subscription and queue locks once, which keeps loading a large patch
+     * fast.
+     * 
+     * Thread-safe - can be called from any thread.
+     * 
+     * @param topics The names of the topics to subscribe to.
+     * @param subscriber A shared pointer to the subscriber module.
+     * @param options Delivery options for every subscription.
+     * @return std::size_t Number of topics newly subscribed to.
+     */
+    std::size_t subscribeMany(const std::vector<std::string>& topics,
+                              std::shared_ptr<IMCPSubscriber_V1> subscriber,
+                              const SubscriptionOptions& options = SubscriptionOptions());
+    
+    /**
+     * @brief Subscribe to a topic literal.
+     * 
+     * Like subscribe(const std::string&, ...), and in addition lets messages
+     * carrying the literal's hash find their subscribers without hashing
+     * the topic name.
+     * 
+     * @param topic The topic to subscribe to.
+     * @param subscriber A shared pointer to the subscriber module.
+     * @param options Delivery options for this subscription.
+     * @return bool True if subscription was successful, false if the
+     *         subscriber is already subscribed or another topic name has the
+     *         same hash.
+     */
+    bool subscribe(const TopicLiteral& topic,
+                  std::shared_ptr<IMCPSubscriber_V1> subscriber,
+                  const SubscriptionOptions& options = SubscriptionOptions());
+    
     bool unsubscribe(const std::string& topic,
                     std::shared_ptr<IMCPSubscriber_V1> subscriber) override;
     
@@ -78,6 +612,105 @@ public:
     
     bool publish(std::shared_ptr<MCPMessage_V1> message) override;
     
+    /**
+     * @brief Make a subscriber reachable by module id for directed messages.
+     * 
+     * Thread-safe - can be called from any thread.
+     * 
+     * @param moduleId The id other modules address it by.
+     * @param subscriber The subscriber that receives messages sent to the id.
+     * @return bool False if the id is already taken by a live subscriber.
+     */
+    bool registerEndpoint(int moduleId, std::shared_ptr<IMCPSubscriber_V1> subscriber);
+    
+    /**
+     * @brief Stop receiving directed messages for a module id.
+     * 
+     * @param moduleId The id passed to registerEndpoint().
+     * @return bool True if the id was registered.
+     */
+    bool unregisterEndpoint(int moduleId);
+    
+    /**
+     * @brief Send a message to a single module instead of a topic's subscribers.
+     * 
+     * The target is found in O(1) by module id and only its onMCPMessage() is
+     * called, on a dispatch worker like a published message. Topic
+     * subscribers, history and derived topics do not see the message.
+     * Messages sent to one module are delivered in send order.
+     * Thread-safe - can be called from any thread except the audio thread.
+     * 
+     * @param moduleId The target module id (see registerEndpoint()).
+     * @param message The message; its topic tells the target what it is.
+     * @return bool True if the message was queued, false if the message is
+     *         invalid or no live subscriber is registered for the id.
+     */
+    bool sendTo(int moduleId, std::shared_ptr<MCPMessage_V1> message);
+    
+    /**
+     * @brief Answer requests on a topic on demand.
+     * 
+     * Each topic has at most one handler. Thread-safe.
+     * 
+     * @param topic The topic to serve, e.g. com.vcvrack.core/state-dump.
+     * @param handler The handler called for each request on the topic.
+     * @return bool False if the topic already has a live handler.
+     */
+    bool registerRequestHandler(const std::string& topic,
+                                std::shared_ptr<IMCPRequestHandler_V1> handler);
+    
+    /**
+     * @brief Stop answering requests on a topic.
+     * 
+     * @param topic The topic.
+     * @param handler The handler that was registered for it.
+     * @return bool True if the handler was registered for the topic.
+     */
+    bool unregisterRequestHandler(const std::string& topic,
+                                  std::shared_ptr<IMCPRequestHandler_V1> handler);
+    
+    /**
+     * @brief Ask a topic's request handler for data and get a callback.
+     * 
+     * The broker assigns the request a correlation id, runs the handler on a
+     * worker in the topic's dispatch order and calls the callback exactly
+     * once with the reply, a failure or a timeout. The callback runs on a
+     * broker worker thread. Thread-safe - never call it from the audio thread.
+     * 
+     * @param request The request; its topic selects the handler and its
+     *        correlationId is overwritten.
+     * @param callback Receives the outcome.
+     * @param timeout How long to wait for the answer.
+     * @return bool False if the request is invalid or no handler is
+     *         registered; the callback is not called then.
+     */
+    bool request(std::shared_ptr<MCPMessage_V1> request,
+                 std::function<void(const Reply&)> callback,
+                 std::chrono::milliseconds timeout);
+    
+    /**
+     * @brief Ask a topic's request handler for data and get a future.
+     * 
+     * Same as the callback form; failures, including a missing handler,
+     * are reported through Reply::status.
+     * 
+     * @param request The request message.
+     * @param timeout How long to wait for the answer.
+     * @return std::future<Reply> Becomes ready with the outcome.
+     */
+    std::future<Reply> request(std::shared_ptr<MCPMessage_V1> request,
+                               std::chrono::milliseconds timeout);
+    
+    /**
+     * @brief Answer a request later, from any thread.
+     * 
+     * For handlers that returned nullptr from onMCPRequest().
+     * 
+     * @param reply The reply; its correlationId must be the request's.
+     * @return bool False if the request already timed out or was answered.
+     */
+    bool reply(std::shared_ptr<MCPMessage_V1> reply);
+    
     int getVersion() const override;
 
     /**
@@ -85,18 +718,689 @@ public:
      * 
      * This method is used during shutdown to ensure clean cleanup.
      * It clears the topic registry, subscriptions, and message queue.
+     * The retained values are saved to the snapshot file (see
+     * enableSnapshot()) before they are dropped.
      */
     void clearAllRegistries();
 
+    /**
+     * @brief Dispatch queued messages on the calling thread.
+     *
+     * Delivery follows the same rules as the worker threads: per-topic
+     * ordering, earliest-deadline-first across topics, and a throwing
+     * subscriber never stops the pump. Expired timers (e.g. debounced
+     * derived topics) are processed as well. Several threads may pump
+     * concurrently. Intended for DispatchMode::MANUAL_PUMP.
+     *
+     * @param maxMessages Maximum number of queue entries to dispatch; 0
+     *        dispatches until the queue is empty, including messages
+     *        published by the callbacks themselves.
+     * @return std::size_t Number of queue entries dispatched.
+     */
+    std::size_t pump(std::size_t maxMessages = 0);
+
+    /**
+     * @brief Dispatch queued messages on the calling thread for a time budget.
+     *
+     * Stops once the queue is empty or the budget is used up; a single
+     * slow callback can overrun the budget.
+     *
+     * @param timeBudget Maximum time to spend dispatching.
+     * @return std::size_t Number of queue entries dispatched.
+     */
+    std::size_t pump(std::chrono::microseconds timeBudget);
+
+    /**
+     * @brief Get the dispatch mode chosen at construction.
+     *
+     * @return DispatchMode The dispatch mode.
+     */
+    DispatchMode getDispatchMode() const { return m_dispatchMode; }
+
+    /**
+     * @brief Configure the elastic dispatch worker pool.
+     *
+     * Thread-safe. Starts the workers if they have not started yet, and
+     * missing core workers are started immediately; surplus workers retire
+     * once they become idle.
+     *
+     * @param config The new pool configuration.
+     */
+    void setWorkerPoolConfig(const WorkerPoolConfig& config);
+
+    /**
+     * @brief Get the current worker pool configuration.
+     *
+     * @return WorkerPoolConfig The active configuration.
+     */
+    WorkerPoolConfig getWorkerPoolConfig() const;
+
+    /**
+     * @brief Get the worker pool metrics, including the pool size over time.
+     *
+     * @return WorkerPoolStats A snapshot of the pool metrics.
+     */
+    WorkerPoolStats getWorkerPoolStats() const;
+
+    /**
+     * @brief Choose how the dispatch workers share their time between topics.
+     *
+     * SchedulingPolicy::DEFICIT_ROUND_ROBIN keeps a chatty topic from holding
+     * all dispatch capacity: quiet topics wait for at most one turn of each
+     * busy topic instead of behind its whole backlog. Per-topic ordering is
+     * kept under every policy. Thread-safe.
+     *
+     * @param policy The scheduling policy (EARLIEST_DEADLINE by default).
+     */
+    void setSchedulingPolicy(SchedulingPolicy policy);
+
+    /**
+     * @brief Get the current scheduling policy.
+     *
+     * @return SchedulingPolicy The scheduling policy.
+     */
+    SchedulingPolicy getSchedulingPolicy() const;
+
+    /**
+     * @brief Set a topic's share of dispatch capacity under deficit round-robin.
+     *
+     * A topic with weight n may dispatch up to n messages per turn. Thread-safe.
+     *
+     * @param topic The topic name.
+     * @param weight Messages per turn (at least 1; default 1).
+     */
+    void setTopicWeight(const std::string& topic, uint32_t weight);
+
+    /**
+     * @brief Declare whether a topic carries state or events.
+     *
+     * Only STATE topics are eligible for adaptive conflation, and the
+     * broker retains the latest value of each STATE topic for late
+     * subscribers and snapshots. Topics are EVENT by default. Thread-safe.
+     *
+     * @param topic The topic name.
+     * @param kind The topic kind.
+     */
+    void setTopicKind(const std::string& topic, TopicKind kind);
+
+    /**
+     * @brief Get the declared kind of a topic.
+     *
+     * @param topic The topic name.
+     * @return TopicKind The declared kind (EVENT if never declared).
+     */
+    TopicKind getTopicKind(const std::string& topic) const;
+
+    /**
+     * @brief Configure adaptive auto-conflation. Thread-safe.
+     *
+     * Disabling it reverts every coalescing topic immediately.
+     *
+     * @param config The new configuration.
+     */
+    void setAdaptiveConflation(const AdaptiveConflationConfig& config);
+
+    /**
+     * @brief Set a callback invoked for every conflation switch.
+     *
+     * The callback runs on whichever thread triggered the evaluation (a
+     * publisher or a worker) without broker locks held.
+     *
+     * @param listener The callback, or an empty function to remove it.
+     */
+    void setConflationListener(std::function<void(const ConflationEvent&)> listener);
+
+    /**
+     * @brief Check whether a topic is currently coalescing.
+     *
+     * @param topic The topic name.
+     * @return bool True if the topic is in latest-value mode.
+     */
+    bool isTopicConflating(const std::string& topic) const;
+
+    /**
+     * @brief Total number of conflation switches (both directions) so far.
+     *
+     * @return uint64_t The switch count.
+     */
+    uint64_t getConflationSwitchCount() const;
+
+    /**
+     * @brief Configure content-addressed payload deduplication. Thread-safe.
+     *
+     * Changing the configuration clears the content cache.
+     *
+     * @param config The new configuration.
+     */
+    void setContentDedup(const ContentDedupConfig& config);
+
+    /**
+     * @brief Get the content deduplication counters. Thread-safe.
+     *
+     * @return ContentDedupStats A snapshot of the counters.
+     */
+    ContentDedupStats getContentDedupStats() const;
+
+    /**
+     * @brief Keep the most recent messages of a topic in a bounded ring.
+     *
+     * Messages are recorded as they are dispatched. Re-enabling a topic
+     * replaces its ring (and discards what it held). Thread-safe.
+     *
+     * @param topic The topic name.
+     * @param config Retention limits.
+     */
+    void enableHistory(const std::string& topic, const HistoryConfig& config);
+
+    /**
+     * @brief Stop keeping history for a topic and release what it held.
+     *
+     * @param topic The topic name.
+     * @return bool True if the topic had history enabled.
+     */
+    bool disableHistory(const std::string& topic);
+
+    /**
+     * @brief Get the history ring of a topic for lock-free reads.
+     *
+     * Visualizers should keep the returned handle and read from it directly;
+     * it stays valid (but stops growing) if history is later disabled.
+     *
+     * @param topic The topic name.
+     * @return std::shared_ptr<const TopicHistory> The ring, or nullptr if
+     *         history is not enabled for the topic.
+     */
+    std::shared_ptr<const TopicHistory> getTopicHistory(const std::string& topic) const;
+
+    /**
+     * @brief Read the most recent messages of a topic, oldest first.
+     *
+     * @param topic The topic name.
+     * @param maxMessages Maximum number of messages to return; 0 returns all.
+     * @return std::vector<std::shared_ptr<const MCPMessage_V1>> The messages
+     *         (empty if history is not enabled for the topic).
+     */
+    std::vector<std::shared_ptr<const MCPMessage_V1>> getHistory(const std::string& topic,
+                                                                 std::size_t maxMessages = 0) const;
+
+    /**
+     * @brief Get the latest value dispatched (or restored) on a STATE topic.
+     *
+     * @param topic The topic name.
+     * @return std::shared_ptr<const MCPMessage_V1> The message, or nullptr if
+     *         the topic is not STATE or has no value yet.
+     */
+    std::shared_ptr<const MCPMessage_V1> getRetainedValue(const std::string& topic) const;
+
+    /**
+     * @brief Write the latest value of every STATE topic to a snapshot file.
+     *
+     * Thread-safe. See Snapshot for the file format.
+     *
+     * @param path The file to write.
+     * @return bool True if the file was written.
+     */
+    bool saveSnapshot(const std::string& path) const;
+
+    /**
+     * @brief Restore STATE topic values from a snapshot file.
+     *
+     * Each stored topic is declared STATE and its value becomes the
+     * retained value, so subscribers that replay (see
+     * SubscriptionOptions::replayHistory) or poll getRetainedValue() have
+     * context before any provider has published. Restored payloads are read
+     * straight from the memory-mapped file. Thread-safe.
+     *
+     * @param path The file to read.
+     * @return bool True if the file was a valid snapshot.
+     */
+    bool loadSnapshot(const std::string& path);
+
+    /**
+     * @brief Warm-start from a snapshot file and keep it up to date.
+     *
+     * Restores the file if it exists (see loadSnapshot()) and saves the
+     * retained values to it when the broker shuts down. Thread-safe.
+     *
+     * @param path The snapshot file.
+     * @return bool True if a snapshot was restored.
+     */
+    bool enableSnapshot(const std::string& path);
+
+    /**
+     * @brief Declare a topic computed in the broker from another topic.
+     *
+     * Every message dispatched on spec.sourceTopic runs through the operator
+     * chain exactly once, however many consumers the derived topic has, and
+     * each result is published on spec.topic. The chain runs on a dispatch
+     * worker in the source topic's order, so operators need no locking of
+     * their own. Derived topics may be chained, but not in a cycle.
+     * Thread-safe.
+     *
+     * @param spec The derived topic declaration.
+     * @return bool True if the topic was defined, false if the name is taken,
+     *         the spec is incomplete or it would create a cycle.
+     */
+    bool defineDerivedTopic(const DerivedTopicSpec& spec);
+
+    /**
+     * @brief Remove a derived topic. Pending debounced values are discarded.
+     *
+     * @param topic The derived topic name.
+     * @return bool True if the topic was defined.
+     */
+    bool removeDerivedTopic(const std::string& topic);
+
+    /**
+     * @brief Get the names of all derived topics.
+     *
+     * @return std::vector<std::string> The derived topic names.
+     */
+    std::vector<std::string> getDerivedTopics() const;
+
+    /**
+     * @brief Serve a float array topic as a min/max/mean pyramid.
+     *
+     * Messages on the topic must carry a MessagePack std::vector<float>.
+     * Subscribers that set SubscriptionOptions::targetResolution receive a
+     * MessagePack MinMaxLevel (see serialization::extractMessageData()) at
+     * the requested level of detail instead of the full array. Levels are
+     * computed once per message and shared by all subscribers that use them.
+     * Thread-safe.
+     *
+     * @param topic The array topic, e.g. com.vcvrack.core/spectrum.
+     */
+    void enablePyramid(const std::string& topic);
+
+    /**
+     * @brief Deliver a topic's full arrays to every subscriber again.
+     *
+     * @param topic The array topic.
+     * @return bool True if the topic had a pyramid.
+     */
+    bool disablePyramid(const std::string& topic);
+
+    /**
+     * @brief Get the broker's pool for CallbackExecutor::SHARED_POOL subscribers.
+     *
+     * The pool has one thread per hardware thread and is started on first use.
+     * Thread-safe.
+     *
+     * @return std::shared_ptr<WorkStealingPool> The shared callback pool.
+     */
+    std::shared_ptr<WorkStealingPool> getCallbackPool();
+
+    /**
+     * @brief Report an error on ERROR_REPORTS_TOPIC.
+     *
+     * Never allocates, locks or blocks, so it may be called from any thread,
+     * including the audio thread. Reports are deduplicated by (source, code)
+     * and counted; the dispatch workers (or pump()) publish one ErrorReport
+     * per error that occurred at most once per report interval (see
+     * setErrorReportInterval()), or drop the summaries while nobody
+     * subscribes to the topic. The broker itself reports failing
+     * subscribers, request handlers and dispatch tasks this way.
+     *
+     * @param source Who reports the error (a module or topic name).
+     * @param code The error code (see ErrorCode).
+     * @param severity The severity.
+     * @param message Description of the error; only the first one of each
+     *        (source, code) pair is kept.
+     * @param topic Topic involved, or nullptr.
+     * @param subscriber Identifies a subscriber that failed (e.g. its type
+     *        name), or nullptr; appended to the message.
+     */
+    void reportError(const char* source, const char* code, ErrorSeverity severity,
+                     const char* message, const char* topic = nullptr,
+                     const char* subscriber = nullptr) noexcept;
+
+    /**
+     * @brief Set the minimum time between two rounds of error summaries.
+     *
+     * Thread-safe.
+     *
+     * @param interval The interval (1 second by default).
+     */
+    void setErrorReportInterval(std::chrono::milliseconds interval);
+
+    /**
+     * @brief Split the fan-out of topics with many subscribers across threads.
+     *
+     * When a message has at least minSubscribers recipients, its inline
+     * subscribers are divided into contiguous chunks that the dispatching
+     * thread and helpers on the callback pool (see getCallbackPool()) claim
+     * one at a time. Helpers queued behind SHARED_POOL callbacks never hold
+     * the dispatch up: the dispatching thread runs every chunk no helper has
+     * started. The dispatch waits for every chunk before the topic's next
+     * message, so each
+     * subscriber still sees the topic's messages in order; only the order
+     * between different subscribers of one message becomes unspecified.
+     * Inline subscribers must then tolerate being called from pool threads.
+     * Thread-safe.
+     *
+     * @param minSubscribers Recipient count at which the fan-out goes
+     *        parallel; 0 (the default) keeps every fan-out on one thread.
+     */
+    void setParallelFanout(std::size_t minSubscribers);
+
+    /**
+     * @brief Get the recipient count at which the fan-out goes parallel.
+     *
+     * @return std::size_t The threshold (0 if disabled).
+     */
+    std::size_t getParallelFanout() const;
+
     // Friend function declaration for shutdown helper
     friend void shutdownMCPBroker();
 
 private:
+    // A dispatch worker thread and whether it has exited
+    struct Worker {
+        std::thread thread;
+        bool finished = false;
+    };
+
     // Worker thread function for processing the message queue
-    void processMessageQueue();
+    void processMessageQueue(Worker* self);
+
+    // Take the next ready entry and dispatch it; lock must hold m_queueMutex
+    // and is released during delivery. Returns false if nothing was ready.
+    bool dispatchNext(std::unique_lock<std::mutex>& lock);
+
+    // Start the core workers with the first queued work (m_queueMutex must be held)
+    void startWorkers(std::chrono::steady_clock::time_point now);
+
+    // Spawn an extra worker if the queue is backed up (m_queueMutex must be held)
+    void maybeScaleUp(std::chrono::steady_clock::time_point now);
+
+    // Start a new worker thread (m_queueMutex must be held)
+    void spawnWorker(std::chrono::steady_clock::time_point now);
 
-    // Helper to deliver a message to all subscribers of a topic
-    void deliverMessage(std::shared_ptr<MCPMessage_V1> message);
+    // Record a pool-size change in the metrics (m_queueMutex must be held)
+    void recordPoolSize(std::chrono::steady_clock::time_point now);
+
+    // Sample topic rates and switch conflation if a window has passed
+    // (m_queueMutex must be held); switches are appended to events
+    void evaluateConflation(std::chrono::steady_clock::time_point now,
+                            std::vector<ConflationEvent>& events);
+
+    // Invoke the conflation listener (m_queueMutex must NOT be held)
+    void reportConflation(const std::vector<ConflationEvent>& events);
+
+    // A large payload's blob in the content cache, and whether it was there
+    // before this publish
+    struct CachedPayload {
+        std::shared_ptr<void> blob;
+        bool seen = false;
+    };
+
+    // Look a large payload up in the content cache, caching a copy on its
+    // first sighting (m_queueMutex must NOT be held)
+    CachedPayload cachePayload(const MCPMessage_V1& message, uint64_t hash);
+
+    // Apply content deduplication to a large payload (m_queueMutex must be
+    // held); may replace the message with one sharing the cached blob.
+    // Returns false if the message is to be suppressed.
+    bool deduplicatePayload(std::shared_ptr<MCPMessage_V1>& message, const CachedPayload& cached);
+
+    // Publish the collected error summaries if the report interval has
+    // passed; lock must hold m_queueMutex and is released while publishing
+    void flushErrorReports(std::unique_lock<std::mutex>& lock);
+
+    // Deadband of a subscription and the last value actually handed to the
+    // subscriber; only touched while the subscription's topic is in flight
+    struct Deadband {
+        double absolute = 0.0;
+        double relative = 0.0;
+        bool hasLast = false;
+        double last = 0.0;
+
+        // True if the value moved far enough from the last delivered one
+        bool pass(double value) const;
+
+        // Make a delivered message's value the reference (non-numeric
+        // messages leave it unchanged)
+        void delivered(const MCPMessage_V1& message);
+    };
+
+    // Rate limit of a subscription: when it last delivered and the newest
+    // message waiting for the interval to pass; only touched while the
+    // subscription's topic is in flight (except closed)
+    struct RateLimit {
+        std::chrono::steady_clock::duration interval{};
+        bool hasLast = false;
+        std::chrono::steady_clock::time_point last;
+        std::shared_ptr<MCPMessage_V1> trailing;
+        bool timerArmed = false;
+        std::atomic<bool> closed{false};
+
+        // Record and return true if the message can be delivered now;
+        // otherwise keep it as the trailing message
+        bool admit(const std::shared_ptr<MCPMessage_V1>& message,
+                   std::chrono::steady_clock::time_point now);
+    };
+
+    // Messages waiting for a batched (IMCPSubscriber_V2) subscription; drained
+    // by one task at a time on the subscription's strand or its own queue key
+    struct Mailbox {
+        std::weak_ptr<IMCPSubscriber_V2> subscriber;
+        std::string queueKey;
+        std::mutex mutex;
+        std::vector<std::shared_ptr<MCPMessage_V1>> pending;
+        bool scheduled = false;
+        bool closed = false;
+    };
+
+    // Error collector shared with strand tasks, which may still be running
+    // when the broker is destroyed; it wakes the broker's workers only while
+    // the broker is attached
+    struct ErrorSink {
+        ErrorCollector collector;
+        std::atomic<MCPBroker*> broker{nullptr};
+
+        // Reporters currently notifying the attached broker
+        std::atomic<uint32_t> waking{0};
+
+        // Record an error and wake the broker for the first one of a round
+        void report(const char* source, const char* code, ErrorSeverity severity,
+                    const char* message, const char* topic, const char* subscriber = nullptr) noexcept;
+
+        // Stop waking the broker; returns once no reporter is notifying it
+        void detach() noexcept;
+    };
+
+    // A subscriber registered for a topic together with its options
+    struct Subscription {
+        std::weak_ptr<IMCPSubscriber_V1> subscriber;
+        SubscriptionOptions options;
+        std::chrono::microseconds deadline{0};
+
+        // Serial mailbox for off-thread executors (null for INLINE)
+        std::shared_ptr<Strand> strand;
+
+        // Messages handed to a group member and not yet processed (null outside groups)
+        std::shared_ptr<std::atomic<uint32_t>> load;
+
+        // Credit-based flow control (null without credits)
+        std::shared_ptr<CreditGate> gate;
+
+        // Numeric deadband filter (null without a deadband)
+        std::shared_ptr<Deadband> deadband;
+
+        // Delivery rate limit (null without a minimum interval)
+        std::shared_ptr<RateLimit> rateLimit;
+
+        // Batch mailbox (null unless the subscriber implements IMCPSubscriber_V2)
+        std::shared_ptr<Mailbox> mailbox;
+    };
+
+    // A subscriber picked to receive one message
+    struct Recipient {
+        std::shared_ptr<IMCPSubscriber_V1> subscriber;
+        std::shared_ptr<Strand> strand;
+        std::shared_ptr<std::atomic<uint32_t>> load;
+        std::shared_ptr<CreditGate> gate;
+        std::shared_ptr<Deadband> deadband;
+        std::shared_ptr<RateLimit> rateLimit;
+        std::shared_ptr<Mailbox> mailbox;
+    };
+
+    // Finish a pending request with an outcome; false if it already finished
+    bool completeRequest(uint64_t correlationId, const Reply& reply);
+    
+    // Finish every pending request as CANCELLED
+    void cancelPendingRequests();
+    
+    // Hand one message to a recipient, inline, through its strand or its mailbox
+    void deliverTo(const Recipient& recipient, const std::shared_ptr<MCPMessage_V1>& message);
+
+    // Queue a message in a recipient's mailbox and schedule a drain if none is pending
+    void deliverBatched(const Recipient& recipient, const std::shared_ptr<MCPMessage_V1>& message);
+
+    // Deliver to the given recipients in chunks shared between the calling
+    // thread and helpers on the callback pool; returns once all are done
+    void deliverParallel(const std::vector<Recipient>& recipients,
+                         const std::vector<std::size_t>& indices,
+                         const std::shared_ptr<MCPMessage_V1>& message,
+                         const std::vector<std::shared_ptr<MCPMessage_V1>>& levelMessages);
+
+    // Pass everything queued in a mailbox to its subscriber in one call
+    static void drainMailbox(Mailbox& mailbox, const std::shared_ptr<std::atomic<uint32_t>>& load,
+                             ErrorSink& errors);
+
+    // Pass one message through a recipient's credit gate and deliver it if admitted
+    void admitAndDeliver(const std::string& topic, const Recipient& recipient,
+                         const std::shared_ptr<MCPMessage_V1>& message);
+
+    // Retry a recipient's held messages on the topic once credit is granted
+    void waitForCredit(const std::string& topic, const Recipient& recipient);
+
+    // Have grants to a credit account wake the workers (m_subscriptionMutex must be held)
+    void registerCreditWakeup(const std::shared_ptr<DeliveryCredits>& credits);
+
+    // Queue the retries of waiters whose credit arrived (m_queueMutex must be held)
+    void releaseCreditWaiters(std::chrono::steady_clock::time_point now);
+
+    // Wake a sleeping worker from a thread that must not block (m_queueMutex
+    // must NOT be held); see processMessageQueue() for wakeups that are lost
+    void wakeWorker() noexcept;
+
+    // Deliver a recipient's trailing message once its rate interval has passed
+    void scheduleTrailingDelivery(const std::string& topic, const Recipient& recipient);
+
+    // Record a topic literal's hash; false if another topic has the same hash
+    bool claimTopicHash(const TopicLiteral& topic);
+    
+    // Subscription list of a message's topic, found by hash if the topic is
+    // indexed (m_subscriptionMutex must be held)
+    std::vector<Subscription>* findSubscriptions(const MCPMessage_V1& message);
+    
+    // Drop a topic's hash index entry before its subscription list is
+    // erased (m_subscriptionMutex must be held)
+    void unindexSubscriptions(const std::string& topic);
+    
+    // Pick one live member of each consumer group on a topic; skipped is left
+    // empty if the topic has no groups (m_subscriptionMutex must be held)
+    void selectGroupMembers(const std::string& topic,
+                            const std::vector<Subscription>& subscriptions,
+                            std::vector<bool>& skipped);
+
+    // Create the strand for a subscription's executor (m_subscriptionMutex must be held)
+    std::shared_ptr<Strand> createStrand(const SubscriptionOptions& options);
+
+    // Close the strands, credit gates, rate limits and mailboxes of
+    // subscriptions being removed so queued, held and trailing messages are
+    // dropped, and release their mailbox sub-queues (takes m_queueMutex)
+    void closeSubscriptions(std::vector<Subscription>::iterator first,
+                                   std::vector<Subscription>::iterator last);
+
+    // Helper to record a message in the topic's history and deliver it to
+    // all subscribers of the topic
+    void deliverMessage(std::shared_ptr<MCPMessage_V1> message,
+                        std::chrono::steady_clock::time_point publishTime);
+
+    // Build the pyramid of an array message and pick the level for each
+    // requested resolution (0 or no suitable level keeps the full message)
+    static std::vector<std::shared_ptr<MCPMessage_V1>> decimateForSubscribers(
+        const std::shared_ptr<MCPMessage_V1>& message, const std::vector<std::size_t>& resolutions);
+
+    // Run a dispatched message through the derived topics fed by its topic
+    void runDerivedTopics(const std::vector<std::shared_ptr<DerivedTopic>>& derivedTopics,
+                          const std::shared_ptr<MCPMessage_V1>& message);
+
+    // Schedule the debounce timers requested by a derived topic's chain
+    void scheduleDerivedTimers(const std::shared_ptr<DerivedTopic>& derivedTopic,
+                               const std::vector<DerivedTopicTimer>& timers);
+
+    // Queue a task on a topic once a point in time has passed (takes
+    // m_queueMutex); false if the workers are not running
+    bool scheduleTask(const std::string& topic, std::chrono::steady_clock::time_point due,
+                      std::function<void()> task);
+
+    // Move every expired scheduled task into the dispatch queue (m_queueMutex must be held)
+    void moveDueTasks(std::chrono::steady_clock::time_point now);
+
+    // Save the retained values to the snapshot file, if one is enabled; a
+    // broker without values leaves an existing file alone
+    void saveShutdownSnapshot() const;
+
+    // Deliver a history snapshot to a single subscriber (runs as a dispatch task)
+    static void replayHistory(const std::weak_ptr<IMCPSubscriber_V1>& subscriber,
+                              const std::vector<std::shared_ptr<const MCPMessage_V1>>& messages,
+                              ErrorSink& errors);
+
+    // Relative deadline implied by a subscription's options
+    static std::chrono::microseconds effectiveDeadline(const SubscriptionOptions& options);
+
+    // Propagate the tightest subscriber deadline of a topic to the dispatch
+    // queue (m_subscriptionMutex must be held; takes m_queueMutex)
+    void updateTopicDeadline(const std::string& topic,
+                             const std::vector<Subscription>& subscriptions);
+
+    // Tightest subscriber deadline of a topic
+    static std::chrono::microseconds topicDeadline(const std::vector<Subscription>& subscriptions);
+
+    // Dispatch queue changes collected while m_subscriptionMutex is held and
+    // applied under a single m_queueMutex lock
+    struct QueueUpdates {
+        std::vector<std::pair<std::string, std::chrono::microseconds>> deadlines;
+        std::vector<std::pair<std::string, std::function<void()>>> replays;
+    };
+
+    // Add one provider to a topic (m_registryMutex must be held)
+    bool addProvider(const std::string& topic, const std::shared_ptr<IMCPProvider_V1>& provider);
+
+    // Add one subscription (m_subscriptionMutex must be held); queue
+    // changes are appended to updates
+    bool addSubscription(const std::string& topic,
+                         const std::shared_ptr<IMCPSubscriber_V1>& subscriber,
+                         const SubscriptionOptions& options,
+                         QueueUpdates& updates);
+
+    // Apply collected queue changes (takes m_queueMutex)
+    void applyQueueUpdates(QueueUpdates& updates);
+
+    // Held messages of a recipient waiting for a credit grant
+    struct CreditWaiter {
+        std::string topic;
+        std::shared_ptr<CreditGate> gate;
+        std::function<void()> retry;
+    };
+
+    // A task waiting for its due time before joining a topic's dispatch order
+    struct ScheduledTask {
+        std::chrono::steady_clock::time_point due;
+        uint64_t sequence;
+        std::string topic;
+        std::function<void()> task;
+
+        bool operator>(const ScheduledTask& other) const {
+            if (due != other.due) {
+                return due > other.due;
+            }
+            return sequence > other.sequence;
+        }
+    };
 
     // Prevent copying/moving
     MCPBroker(const MCPBroker&) = delete;
@@ -114,20 +1418,120 @@ private:
     mutable std::mutex m_registryMutex;
     ProviderMap m_topicRegistry;
     
-    // Subscription data structure: topic -> list of subscribers
-    using SubscriberMap = std::unordered_map<std::string, 
-                                           std::vector<std::weak_ptr<IMCPSubscriber_V1>>>;
+    // Directed-message targets by module id; each target's messages are
+    // ordered on a dispatch queue key of its own
+    struct Endpoint {
+        std::weak_ptr<IMCPSubscriber_V1> subscriber;
+        std::string queueKey;
+    };
+    mutable std::mutex m_endpointMutex;
+    std::unordered_map<int, Endpoint> m_endpoints;
+    
+    // Request handlers by topic and requests awaiting an answer by correlation id
+    std::mutex m_requestMutex;
+    std::unordered_map<std::string, std::weak_ptr<IMCPRequestHandler_V1>> m_requestHandlers;
+    std::unordered_map<uint64_t, std::function<void(const Reply&)>> m_pendingRequests;
+    uint64_t m_nextCorrelationId;
+    
+    // Subscription data structure: topic -> subscribers in fan-out order
+    // Lock order: m_subscriptionMutex before m_queueMutex
+    using SubscriberMap = std::unordered_map<std::string, std::vector<Subscription>>;
     mutable std::mutex m_subscriptionMutex;
     SubscriberMap m_subscriptions;
+    uint64_t m_nextMailboxId;
+    
+    // Topic literal hashes and the subscription lists of those topics, so
+    // messages carrying a hash skip the name (guarded by m_subscriptionMutex)
+    std::unordered_map<uint64_t, std::string> m_topicHashes;
+    std::unordered_map<uint64_t, std::vector<Subscription>*> m_subscriptionsByHash;
+    
+    // Latest value of each STATE topic (null until the first one) and the
+    // snapshot file saved on shutdown (guarded by m_subscriptionMutex)
+    std::unordered_map<std::string, std::shared_ptr<const MCPMessage_V1>> m_retainedState;
+    std::string m_snapshotPath;
+    
+    // Per-topic history rings (guarded by m_subscriptionMutex so that recording
+    // and subscriber snapshots are atomic with respect to replaying subscribes)
+    std::unordered_map<std::string, std::shared_ptr<TopicHistory>> m_histories;
+    
+    // Derived topics by name and by source topic (guarded by m_subscriptionMutex)
+    std::unordered_map<std::string, std::shared_ptr<DerivedTopic>> m_derivedTopics;
+    std::unordered_map<std::string, std::vector<std::shared_ptr<DerivedTopic>>> m_derivedBySource;
+    
+    // Array topics served as min/max pyramids (guarded by m_subscriptionMutex)
+    std::unordered_set<std::string> m_pyramidTopics;
+    
+    // Broker-wide pool for SHARED_POOL subscribers, created on first use
+    // (guarded by m_subscriptionMutex)
+    std::shared_ptr<WorkStealingPool> m_callbackPool;
+    
+    // Recipient count at which deliverMessage() fans out in parallel (0 = never)
+    std::atomic<std::size_t> m_parallelFanout;
+    
+    // Next member to try for each consumer group: topic -> group -> cursor
+    // (guarded by m_subscriptionMutex)
+    std::unordered_map<std::string, std::unordered_map<std::string, std::size_t>> m_groupCursors;
 
-    // Message queue for publish/subscribe
-    std::queue<std::shared_ptr<MCPMessage_V1>> m_messageQueue;
-    std::mutex m_queueMutex;
+    // Message queue for publish/subscribe (per-topic sub-queues)
+    DispatchQueue m_messageQueue;
+    mutable std::mutex m_queueMutex;
     std::condition_variable m_queueCondition;
     
-    // Worker thread for processing messages
-    std::thread m_workerThread;
+    // Elastic worker pool for processing messages (guarded by m_queueMutex)
+    std::vector<std::unique_ptr<Worker>> m_workers;
+    std::size_t m_activeWorkers;
+    bool m_workersStarted;
+    WorkerPoolConfig m_poolConfig;
+    WorkerPoolStats m_poolStats;
+    std::deque<WorkerPoolSample> m_poolHistory;
+    std::chrono::steady_clock::time_point m_lastSpawn;
     std::atomic<bool> m_threadRunning;
+    DispatchMode m_dispatchMode;
+    
+    // Timer queue drained by the workers (guarded by m_queueMutex)
+    std::priority_queue<ScheduledTask, std::vector<ScheduledTask>,
+                        std::greater<ScheduledTask>> m_scheduledTasks;
+    uint64_t m_nextScheduledSequence;
+    
+    // Recipients waiting for credit (guarded by m_queueMutex), whether a
+    // grant arrived since they were last checked (set from any thread) and
+    // the credit accounts whose grants wake the broker (guarded by
+    // m_subscriptionMutex)
+    std::vector<CreditWaiter> m_creditWaiters;
+    std::atomic<bool> m_creditsGranted;
+    std::vector<std::weak_ptr<DeliveryCredits>> m_creditAccounts;
+    
+    // Errors waiting to be summarized on ERROR_REPORTS_TOPIC (lock-free) and
+    // when the next summary may go out (guarded by m_queueMutex)
+    std::shared_ptr<ErrorSink> m_errorSink;
+    std::chrono::milliseconds m_errorReportInterval;
+    std::chrono::steady_clock::time_point m_nextErrorReport;
+    
+    // Topic declarations checked on publish (guarded by m_queueMutex)
+    std::unordered_map<std::string, TopicDescriptor> m_topicDescriptors;
+    
+    // Adaptive conflation state (guarded by m_queueMutex)
+    std::unordered_map<std::string, TopicKind> m_topicKinds;
+    std::unordered_set<std::string> m_conflatingTopics;
+    AdaptiveConflationConfig m_conflationConfig;
+    std::function<void(const ConflationEvent&)> m_conflationListener;
+    std::chrono::steady_clock::time_point m_lastLoadSample;
+    uint64_t m_conflationSwitches;
+    
+    // Content deduplication state (guarded by m_queueMutex); the minimum
+    // size is mirrored so publishers hash before taking the lock. Each topic
+    // refers to the cached blob of its last large payload; entries whose
+    // blob is gone are swept once the map reaches m_lastPayloadLimit
+    ContentDedupConfig m_dedupConfig;
+    std::atomic<std::size_t> m_dedupMinSize;
+    std::unordered_map<std::string, std::weak_ptr<void>> m_lastPayloads;
+    std::size_t m_lastPayloadLimit;
+    ContentDedupStats m_dedupStats;
+    
+    // Content cache, with its own mutex so publishers compare and copy large
+    // payloads without holding m_queueMutex (taken after it, if at all)
+    mutable std::mutex m_contentCacheMutex;
+    ContentCache m_contentCache;
 };
 
 /**
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <cstddef>
+#include <cstdint>
+
+namespace mcp {
+
+/**
+ * @brief Byte-bounded cache of payloads keyed by their content hash.
+ *
+ * Holds private copies of payloads, so cached blobs never change even if
+ * the buffer they were copied from is reused (e.g. by a
+ * PreparedPublication). Lookups compare the bytes, not only the hash, and
+ * the least recently used blobs are evicted once the total size exceeds the
+ * capacity.
+ *
+ * Not thread-safe; the owner serializes access.
+ */
+class ContentCache {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param capacity Maximum total size of the cached blobs in bytes.
+     */
+    explicit ContentCache(std::size_t capacity = 0);
+
+    /**
+     * @brief 64-bit hash of a payload (reads 8 bytes at a time).
+     *
+     * @param data The payload.
+     * @param size Size of the payload in bytes.
+     * @return uint64_t The hash.
+     */
+    static uint64_t hash(const void* data, std::size_t size);
+
+    /**
+     * @brief Find a cached blob with the given contents.
+     *
+     * @param hash The payload's hash (see hash()).
+     * @param data The payload.
+     * @param size Size of the payload in bytes.
+     * @return std::shared_ptr<void> The cached blob, or nullptr if none matches.
+     */
+    std::shared_ptr<void> find(uint64_t hash, const void* data, std::size_t size);
+
+    /**
+     * @brief Cache a copy of a payload, evicting older blobs as needed.
+     *
+     * A cached blob with the same hash but other contents is replaced.
+     *
+     * @param hash The payload's hash (see hash()).
+     * @param data The payload.
+     * @param size Size of the payload in bytes.
+     * @return std::shared_ptr<void> The new blob, or nullptr if the payload
+     *         is larger than the capacity.
+     */
+    std::shared_ptr<void> insert(uint64_t hash, const void* data, std::size_t size);
+
+    /**
+     * @brief Cache a blob made with copy(), evicting older blobs as needed.
+     *
+     * Lets the owner make the copy without holding its lock. A cached blob
+     * with the same hash is replaced.
+     *
+     * @param hash The payload's hash (see hash()).
+     * @param blob The copy of the payload; must not be modified afterwards.
+     * @param size Size of the payload in bytes.
+     * @return std::shared_ptr<void> The blob, or nullptr if it is larger
+     *         than the capacity.
+     */
+    std::shared_ptr<void> insert(uint64_t hash, std::shared_ptr<void> blob, std::size_t size);
+
+    /**
+     * @brief Make a private copy of a payload for insert().
+     *
+     * @param data The payload.
+     * @param size Size of the payload in bytes.
+     * @return std::shared_ptr<void> The copy.
+     */
+    static std::shared_ptr<void> copy(const void* data, std::size_t size);
+
+    /**
+     * @brief Change the capacity, evicting blobs that no longer fit.
+     *
+     * @param capacity Maximum total size of the cached blobs in bytes.
+     */
+    void setCapacity(std::size_t capacity);
+
+    /** @brief Maximum total size of the cached blobs in bytes. */
+    std::size_t getCapacity() const { return m_capacity; }
+
+    /** @brief Total size of the cached blobs in bytes. */
+    std::size_t getSize() const { return m_size; }
+
+    /** @brief Number of cached blobs. */
+    std::size_t getEntryCount() const { return m_entries.size(); }
+
+    /** @brief Drop every cached blob. */
+    void clear();
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::shared_ptr<void> data;
+        std::size_t size;
+    };
+
+    // Evict least recently used blobs until the size fits the capacity
+    void evict();
+
+    // Most recently used first
+    std::list<Entry> m_entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+    std::size_t m_capacity;
+    std::size_t m_size;
+};
+
+} // namespace mcp
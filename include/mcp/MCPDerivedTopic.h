@@ -0,0 +1,209 @@
+#pragma once
+
+#include "MCPMessage_V1.h"
+#include "MCPSerialization.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <chrono>
+
+namespace mcp {
+
+/**
+ * @brief One stage of a derived topic's operator chain.
+ *
+ * Use the static factories to build stages:
+ * - map: replace the message by the result of a function (nullptr drops it)
+ * - filter: forward only messages that satisfy a predicate
+ * - throttle: forward at most one message per interval (the first one of the
+ *   interval; the rest are dropped)
+ * - debounce: forward the latest message once the source has been quiet for
+ *   the given period
+ *
+ * mapValue() and filterValue() wrap typed functions over MessagePack payloads.
+ */
+struct StreamOperator {
+    /** Kind of stage. */
+    enum class Kind {
+        MAP,
+        FILTER,
+        THROTTLE,
+        DEBOUNCE
+    };
+
+    /** Function of a MAP stage. */
+    using MapFunction = std::function<std::shared_ptr<MCPMessage_V1>(const MCPMessage_V1&)>;
+
+    /** Predicate of a FILTER stage. */
+    using FilterFunction = std::function<bool(const MCPMessage_V1&)>;
+
+    Kind kind = Kind::FILTER;
+    MapFunction mapFunction;
+    FilterFunction filterFunction;
+
+    /** Interval of a THROTTLE stage or quiet period of a DEBOUNCE stage. */
+    std::chrono::microseconds period{0};
+
+    /** @brief Stage that transforms each message. */
+    static StreamOperator map(MapFunction function) {
+        StreamOperator op;
+        op.kind = Kind::MAP;
+        op.mapFunction = std::move(function);
+        return op;
+    }
+
+    /** @brief Stage that drops messages failing a predicate. */
+    static StreamOperator filter(FilterFunction function) {
+        StreamOperator op;
+        op.kind = Kind::FILTER;
+        op.filterFunction = std::move(function);
+        return op;
+    }
+
+    /** @brief Stage that forwards at most one message per interval. */
+    static StreamOperator throttle(std::chrono::microseconds interval) {
+        StreamOperator op;
+        op.kind = Kind::THROTTLE;
+        op.period = interval;
+        return op;
+    }
+
+    /** @brief Stage that forwards the latest message after a quiet period. */
+    static StreamOperator debounce(std::chrono::microseconds quietPeriod) {
+        StreamOperator op;
+        op.kind = Kind::DEBOUNCE;
+        op.period = quietPeriod;
+        return op;
+    }
+
+    /**
+     * @brief MAP stage over MessagePack values.
+     *
+     * @tparam In The source value type.
+     * @tparam Out The result value type.
+     * @param function Converts a source value to the derived value.
+     */
+    template<typename In, typename Out>
+    static StreamOperator mapValue(std::function<Out(const In&)> function) {
+        return map([function](const MCPMessage_V1& message) {
+            Out value = function(serialization::extractMessageData<In>(&message));
+            auto result = serialization::createMsgPackMessage(message.topic, message.senderModuleId, value);
+            result->timestamp = message.timestamp;
+            return result;
+        });
+    }
+
+    /**
+     * @brief FILTER stage over MessagePack values.
+     *
+     * @tparam T The value type.
+     * @param predicate Returns true for values to forward.
+     */
+    template<typename T>
+    static StreamOperator filterValue(std::function<bool(const T&)> predicate) {
+        return filter([predicate](const MCPMessage_V1& message) {
+            return predicate(serialization::extractMessageData<T>(&message));
+        });
+    }
+};
+
+/**
+ * @brief Declaration of a derived topic.
+ */
+struct DerivedTopicSpec {
+    /** Name of the derived topic consumers subscribe to. */
+    std::string topic;
+
+    /** Topic whose messages feed the chain (may itself be derived). */
+    std::string sourceTopic;
+
+    /** Operator chain, applied in order. */
+    std::vector<StreamOperator> operators;
+
+    /** Sender ID stamped on the derived messages. */
+    int senderModuleId = 0;
+};
+
+/**
+ * @brief A pending debounce flush requested by a DerivedTopic.
+ */
+struct DerivedTopicTimer {
+    /** Index of the debounce stage to flush. */
+    std::size_t stage = 0;
+
+    /** Time at which DerivedTopic::fire() should be called. */
+    std::chrono::steady_clock::time_point due;
+};
+
+/**
+ * @brief Runtime state of a derived topic's operator chain.
+ *
+ * The broker runs the chain once per source message, no matter how many
+ * consumers the derived topic has. Each debounce stage holds its latest
+ * message and asks for at most one outstanding timer; when the timer fires
+ * early (because newer messages arrived) it simply asks to be re-armed.
+ *
+ * NOT thread-safe - the broker only calls it with the source topic in flight.
+ */
+class DerivedTopic {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param spec The derived topic declaration.
+     */
+    explicit DerivedTopic(const DerivedTopicSpec& spec);
+
+    /** @brief The derived topic declaration. */
+    const DerivedTopicSpec& getSpec() const { return m_spec; }
+
+    /**
+     * @brief Run a source message through the chain.
+     *
+     * @param message The source message.
+     * @param now The current time.
+     * @param timers Receives debounce timers the caller must schedule.
+     * @return std::shared_ptr<MCPMessage_V1> The message to publish on the
+     *         derived topic, or nullptr if the chain dropped or held it.
+     */
+    std::shared_ptr<MCPMessage_V1> process(const std::shared_ptr<MCPMessage_V1>& message,
+                                           std::chrono::steady_clock::time_point now,
+                                           std::vector<DerivedTopicTimer>& timers);
+
+    /**
+     * @brief Handle an expired debounce timer.
+     *
+     * @param timer The timer returned earlier by process() or fire().
+     * @param now The current time.
+     * @param timers Receives timers that must be (re-)scheduled.
+     * @return std::shared_ptr<MCPMessage_V1> The message to publish, or nullptr.
+     */
+    std::shared_ptr<MCPMessage_V1> fire(const DerivedTopicTimer& timer,
+                                        std::chrono::steady_clock::time_point now,
+                                        std::vector<DerivedTopicTimer>& timers);
+
+private:
+    // Per-stage runtime state
+    struct StageState {
+        std::chrono::steady_clock::time_point lastForward;
+        bool forwarded = false;
+        std::shared_ptr<MCPMessage_V1> pending;
+        std::chrono::steady_clock::time_point pendingSince;
+        bool timerArmed = false;
+    };
+
+    // Run the chain from a given stage on
+    std::shared_ptr<MCPMessage_V1> runFrom(std::size_t stage,
+                                           std::shared_ptr<MCPMessage_V1> message,
+                                           std::chrono::steady_clock::time_point now,
+                                           std::vector<DerivedTopicTimer>& timers);
+
+    // Re-address a chain result to the derived topic
+    std::shared_ptr<MCPMessage_V1> retarget(const MCPMessage_V1& message) const;
+
+    DerivedTopicSpec m_spec;
+    std::vector<StageState> m_stages;
+};
+
+} // namespace mcp
@@ -0,0 +1,319 @@
+#pragma once
+
+#include "MCPMessage_V1.h"
+#include <string>
+#include <memory>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+namespace mcp {
+
+/**
+ * @brief A message waiting in the broker's dispatch queue.
+ */
+struct DispatchEntry {
+    /** The message to deliver. */
+    std::shared_ptr<MCPMessage_V1> message;
+
+    /** Global enqueue sequence number (monotonically increasing). */
+    uint64_t sequence = 0;
+
+    /** Time at which the message entered the queue. */
+    std::chrono::steady_clock::time_point enqueueTime;
+
+    /** Time by which the message should be dispatched (enqueue time + topic deadline). */
+    std::chrono::steady_clock::time_point deadline;
+
+    /**
+     * Broker-internal work run in the topic's dispatch order instead of
+     * delivering a message (e.g. a history replay); empty for messages.
+     */
+    std::function<void()> task;
+};
+
+/**
+ * @brief Produce/consume counters of one topic over a sampling window.
+ */
+struct TopicLoad {
+    /** The topic name. */
+    std::string topic;
+
+    /** Messages published on the topic during the window. */
+    uint64_t produced = 0;
+
+    /** Messages taken by a worker during the window. */
+    uint64_t consumed = 0;
+
+    /** Messages replaced by a newer value during the window. */
+    uint64_t coalesced = 0;
+
+    /** Messages currently waiting in the topic's sub-queue. */
+    std::size_t backlog = 0;
+
+    /** Whether the topic is in latest-value coalescing mode. */
+    bool coalescing = false;
+};
+
+/**
+ * @brief How the dispatch queue picks the next topic to serve.
+ */
+enum class SchedulingPolicy {
+    /**
+     * The ready topic whose head message has the earliest deadline goes
+     * first (the default). Topics sharing a deadline are served in global
+     * FIFO order, so a burst on one topic delays every later message.
+     */
+    EARLIEST_DEADLINE,
+
+    /**
+     * Deficit round-robin over the ready topics: each turn a topic may
+     * dispatch up to its weight in messages before going to the back of the
+     * round, so a quiet topic never waits behind more than one turn of each
+     * busy topic, however deep their backlogs are.
+     */
+    DEFICIT_ROUND_ROBIN
+};
+
+/**
+ * @brief Per-topic dispatch queue used by the broker's worker pool.
+ *
+ * Messages are kept in one FIFO sub-queue per topic. A topic that is being
+ * dispatched by a worker is marked "in flight" and is not handed to any other
+ * worker until complete() is called, which guarantees per-topic ordering even
+ * when several workers drain the queue concurrently. Among the topics that are
+ * ready, the one whose head message has the earliest deadline is served first
+ * (ties broken by enqueue order). Every message's deadline is its enqueue time
+ * plus its topic's relative deadline; topics that share the default deadline
+ * are therefore served in global FIFO order, like a plain queue.
+ *
+ * With SchedulingPolicy::DEFICIT_ROUND_ROBIN the ready topics are served in
+ * weighted round-robin order instead; see setSchedulingPolicy(). Both
+ * policies cost O(log topics) or less per message.
+ *
+ * A topic can be switched to latest-value coalescing, in which case it keeps
+ * at most one pending message: a newer publish replaces the pending one in
+ * place, keeping its position in the queue.
+ *
+ * NOT thread-safe - the broker protects every call with its queue mutex.
+ */
+class DispatchQueue {
+public:
+    /** Opaque handle to a topic's sub-queue, returned by tryPop(). */
+    struct TopicQueue;
+
+    DispatchQueue();
+    ~DispatchQueue();
+
+    /**
+     * @brief Append a message to its topic's sub-queue.
+     *
+     * @param message The message to enqueue (must have a non-empty topic).
+     * @param now The current time, recorded as the enqueue time.
+     */
+    void push(std::shared_ptr<MCPMessage_V1> message,
+              std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Queue a task in a topic's dispatch order.
+     *
+     * The task runs on a worker with the topic in flight, so it is ordered
+     * with respect to the topic's deliveries like a message would be. Tasks
+     * are never coalesced.
+     *
+     * @param topic The topic whose order the task joins.
+     * @param task The work to run.
+     * @param now The current time, recorded as the enqueue time.
+     * @param front True to run ahead of every message still waiting on the
+     *        topic, false to queue behind them.
+     */
+    void pushTask(const std::string& topic, std::function<void()> task,
+                  std::chrono::steady_clock::time_point now, bool front = false);
+
+    /**
+     * @brief Create a topic's sub-queue ahead of its first message.
+     *
+     * @param topic The topic name.
+     */
+    void prepareTopic(const std::string& topic);
+
+    /**
+     * @brief Erase a topic's sub-queue once nothing uses it.
+     *
+     * For broker-internal queue keys whose owner went away (e.g. an
+     * unregistered endpoint). A sub-queue that still holds entries or is in
+     * flight is erased when it drains; using the topic again before that
+     * keeps it.
+     *
+     * @param topic The topic name.
+     */
+    void removeTopic(const std::string& topic);
+
+    /**
+     * @brief Let messages carrying a topic hash find their sub-queue by it.
+     *
+     * push() then looks a message up by MCPMessage_V1::topicHash instead of
+     * hashing its topic name. Messages whose hash was never indexed fall
+     * back to the name.
+     *
+     * @param topic The topic name.
+     * @param hash The topic's hash (see hashTopicName()).
+     * @return true if the hash now refers to the topic, false if it already
+     *         refers to a different topic (a collision).
+     */
+    bool indexTopicHash(const std::string& topic, uint64_t hash);
+
+    /**
+     * @brief Set the relative dispatch deadline of a topic.
+     *
+     * Applies to messages enqueued from now on.
+     *
+     * @param topic The topic name.
+     * @param deadline Time after enqueue by which its messages should be dispatched.
+     */
+    void setTopicDeadline(const std::string& topic, std::chrono::steady_clock::duration deadline);
+
+    /**
+     * @brief Set the relative deadline used by topics without their own.
+     *
+     * @param deadline The default relative deadline.
+     */
+    void setDefaultDeadline(std::chrono::steady_clock::duration deadline);
+
+    /**
+     * @brief Choose how ready topics are ordered.
+     *
+     * Topics that are already ready are carried over to the new policy.
+     *
+     * @param policy The scheduling policy.
+     */
+    void setSchedulingPolicy(SchedulingPolicy policy);
+
+    /** @brief The current scheduling policy. */
+    SchedulingPolicy getSchedulingPolicy() const { return m_policy; }
+
+    /**
+     * @brief Set a topic's round-robin weight.
+     *
+     * Under SchedulingPolicy::DEFICIT_ROUND_ROBIN the topic may dispatch up
+     * to this many messages per turn. Ignored by the other policies.
+     *
+     * @param topic The topic name.
+     * @param weight Messages per turn (at least 1; default 1).
+     */
+    void setTopicWeight(const std::string& topic, uint32_t weight);
+
+    /**
+     * @brief Switch a topic in or out of latest-value coalescing.
+     *
+     * Switching on collapses the current backlog to its newest message.
+     *
+     * @param topic The topic name.
+     * @param coalescing True to coalesce, false to queue every message.
+     */
+    void setCoalescing(const std::string& topic, bool coalescing);
+
+    /**
+     * @brief Collect the per-topic load counters and start a new window.
+     *
+     * @return std::vector<TopicLoad> One entry per topic that saw traffic
+     *         in the window or is currently coalescing.
+     */
+    std::vector<TopicLoad> sampleLoad();
+
+    /**
+     * @brief Take the next message from a topic that is not in flight.
+     *
+     * On success the message's topic is marked in flight and the caller must
+     * call complete() with the returned handle once delivery has finished.
+     *
+     * @param entry Receives the dequeued entry.
+     * @param topicQueue Receives the handle of the topic the entry came from.
+     * @return true if a message was dequeued, false if no topic is ready.
+     */
+    bool tryPop(DispatchEntry& entry, TopicQueue*& topicQueue);
+
+    /**
+     * @brief Mark a topic as no longer in flight.
+     *
+     * @param topicQueue The handle returned by tryPop().
+     */
+    void complete(TopicQueue* topicQueue);
+
+    /** @brief Total number of queued messages across all topics. */
+    std::size_t size() const { return m_size; }
+
+    /** @brief True if no messages are queued. */
+    bool empty() const { return m_size == 0; }
+
+    /** @brief Number of topic sub-queues, including idle ones. */
+    std::size_t topicCount() const { return m_topics.size(); }
+
+    /** @brief Number of topics that currently have a message a worker could take. */
+    std::size_t readyCount() const { return m_ready.size() + m_roundRobin.size(); }
+
+    /**
+     * @brief Age of the most urgent message that a worker could take right now.
+     *
+     * @param now The current time.
+     * @return The age, or zero if no topic is ready.
+     */
+    std::chrono::steady_clock::duration oldestReadyAge(
+        std::chrono::steady_clock::time_point now) const;
+
+    /**
+     * @brief Drop all queued messages and topic sub-queues with their settings.
+     *
+     * Topics that are in flight stay valid until their workers call
+     * complete(), which erases them.
+     */
+    void clear();
+
+private:
+    struct ReadyTopic {
+        std::chrono::steady_clock::time_point deadline;
+        uint64_t sequence;
+        TopicQueue* queue;
+
+        bool operator>(const ReadyTopic& other) const {
+            if (deadline != other.deadline) {
+                return deadline > other.deadline;
+            }
+            return sequence > other.sequence;
+        }
+    };
+
+    // Find or create the sub-queue of a topic
+    TopicQueue* topicQueueFor(const std::string& topic);
+
+    // Find or create the sub-queue of a message's topic, by hash if indexed
+    TopicQueue* topicQueueFor(const MCPMessage_V1& message);
+
+    // Put a topic into the ready set if it has work and is idle
+    void markReadyIfIdle(TopicQueue* topicQueue);
+
+    // Erase an idle sub-queue and its hash index entries
+    void eraseTopic(TopicQueue* topicQueue);
+
+    std::unordered_map<std::string, std::unique_ptr<TopicQueue>> m_topics;
+
+    // Sub-queues by topic hash; the hash already is the bucket key
+    struct IdentityHash {
+        std::size_t operator()(uint64_t hash) const { return static_cast<std::size_t>(hash); }
+    };
+    std::unordered_map<uint64_t, TopicQueue*, IdentityHash> m_topicsByHash;
+    SchedulingPolicy m_policy;
+
+    // Ready topics: a deadline heap (EARLIEST_DEADLINE) or the round (DEFICIT_ROUND_ROBIN)
+    std::priority_queue<ReadyTopic, std::vector<ReadyTopic>, std::greater<ReadyTopic>> m_ready;
+    std::deque<TopicQueue*> m_roundRobin;
+    std::size_t m_size;
+    uint64_t m_nextSequence;
+    std::chrono::steady_clock::duration m_defaultDeadline;
+};
+
+} // namespace mcp
@@ -0,0 +1,161 @@
+#pragma once
+
+#include "MCPTopic.h"
+#include <string>
+#include <vector>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace mcp {
+
+/**
+ * @brief Topic on which the broker publishes error summaries.
+ */
+constexpr TopicLiteral ERROR_REPORTS_TOPIC("mcp.system/error-reports");
+
+/**
+ * @brief Error codes reported by the broker and the reference modules.
+ */
+namespace ErrorCode {
+    /** A queued message or task threw while being dispatched. */
+    const char* const DISPATCH_FAILED = "E1001";
+
+    /** A subscriber callback threw. */
+    const char* const SUBSCRIBER_FAILED = "E1002";
+
+    /** A payload could not be serialized or deserialized. */
+    const char* const SERIALIZATION_FAILED = "E1003";
+
+    /** A request handler threw. */
+    const char* const HANDLER_FAILED = "E1004";
+}
+
+/**
+ * @brief Severity of a reported error.
+ */
+enum class ErrorSeverity {
+    INFO,
+    WARNING,
+    CRITICAL
+};
+
+/**
+ * @brief Summary of one kind of error, as published on ERROR_REPORTS_TOPIC.
+ *
+ * Serialized as the documented error object (type "error", version "1.0",
+ * timestamp, source and a data map with severity, code, message and
+ * context.topic), with the occurrence counts added to the data map.
+ */
+struct ErrorReport {
+    /** Who reported the error (a module or topic name). */
+    std::string source;
+
+    /** Error code (see ErrorCode). */
+    std::string code;
+
+    /** Severity of the first occurrence. */
+    ErrorSeverity severity = ErrorSeverity::WARNING;
+
+    /** Message of the first occurrence. */
+    std::string message;
+
+    /** Topic involved in the first occurrence (empty if none). */
+    std::string topic;
+
+    /** Occurrences since the previous summary of this error. */
+    uint64_t count = 0;
+
+    /** Occurrences since the error was first reported. */
+    uint64_t total = 0;
+
+    /** Time of the summary in milliseconds since the Unix epoch. */
+    uint64_t timestamp = 0;
+};
+
+/**
+ * @brief Lock-free collector that deduplicates and counts errors.
+ *
+ * report() is safe to call from any thread, including the audio thread: it
+ * never allocates, locks or blocks. Errors are keyed by (source, code); the
+ * first report of a key stores its strings (truncated to fixed sizes) in a
+ * preallocated slot and every later one only increments the slot's counters.
+ * A consumer periodically takes a summary of everything reported since its
+ * previous call with collect().
+ *
+ * There is room for CAPACITY distinct keys; reports of further keys are
+ * only counted by getDroppedCount().
+ */
+class ErrorCollector {
+public:
+    /** Number of distinct (source, code) pairs that can be tracked. */
+    static const std::size_t CAPACITY = 128;
+
+    ErrorCollector();
+
+    /**
+     * @brief Record one occurrence of an error.
+     *
+     * @param source Who reports the error.
+     * @param code The error code.
+     * @param severity The severity.
+     * @param message Description of the error (kept for the first occurrence only).
+     * @param topic Topic involved, or nullptr.
+     * @param subscriber Identifies the subscriber that failed, or nullptr;
+     *        appended to the stored message.
+     * @return bool True if this is the first report since the last collect(),
+     *         i.e. the consumer has something new to collect.
+     */
+    bool report(const char* source, const char* code, ErrorSeverity severity,
+                const char* message, const char* topic = nullptr,
+                const char* subscriber = nullptr) noexcept;
+
+    /**
+     * @brief Whether errors were reported since the last collect().
+     */
+    bool pending() const noexcept;
+
+    /**
+     * @brief Take a summary of the errors reported since the previous call.
+     *
+     * Allocates, so call it from a consumer thread rather than the error path.
+     *
+     * @param reports Receives one summary per error that occurred.
+     * @return std::size_t Number of summaries added.
+     */
+    std::size_t collect(std::vector<ErrorReport>& reports);
+
+    /**
+     * @brief Number of reports dropped because every slot was taken.
+     */
+    uint64_t getDroppedCount() const noexcept;
+
+private:
+    static const std::size_t MAX_SOURCE = 64;
+    static const std::size_t MAX_CODE = 16;
+    static const std::size_t MAX_MESSAGE = 128;
+    static const std::size_t MAX_TOPIC = 64;
+
+    // One (source, code) pair; the strings are written once by the thread
+    // that claims the key and published through ready
+    struct Slot {
+        std::atomic<uint64_t> key;
+        std::atomic<bool> ready;
+        std::atomic<uint64_t> count;
+        std::atomic<uint64_t> total;
+        ErrorSeverity severity;
+        char source[MAX_SOURCE];
+        char code[MAX_CODE];
+        char message[MAX_MESSAGE];
+        char topic[MAX_TOPIC];
+    };
+
+    Slot m_slots[CAPACITY];
+    std::atomic<bool> m_pending;
+    std::atomic<uint64_t> m_dropped;
+
+    ErrorCollector(const ErrorCollector&) = delete;
+    ErrorCollector& operator=(const ErrorCollector&) = delete;
+};
+
+} // namespace mcp
@@ -0,0 +1,190 @@
+#pragma once
+
+#include "MCPMessage_V1.h"
+#include <memory>
+#include <deque>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+namespace mcp {
+
+/**
+ * @brief What the broker does with a message for a subscriber that has no credit.
+ */
+enum class CreditPolicy {
+    /**
+     * Keep the message and deliver it, in order, once credit is granted.
+     * At most SubscriptionOptions::maxHeldMessages are kept; the oldest are
+     * dropped beyond that.
+     */
+    HOLD,
+
+    /** Keep only the newest message of the topic (for state topics). */
+    CONFLATE,
+
+    /** Discard the message. */
+    DROP
+};
+
+/**
+ * @brief Delivery credits a subscriber grants to the broker.
+ *
+ * Each delivery consumes one credit. A subscriber that buffers messages
+ * (e.g. in a RingBuffer for its audio thread) starts with as many credits as
+ * it has free slots and grants one back for every slot it drains, so the
+ * broker never spends dispatch time on a message the subscriber would have
+ * to throw away. One credit account may be shared by all of a subscriber's
+ * subscriptions.
+ *
+ * grant() may be called from the audio thread: it never allocates or blocks.
+ * The first grant after the broker ran out of credit runs the broker's
+ * wakeup, which only flags the broker and notifies its worker.
+ */
+class DeliveryCredits {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param initial Credits available before the first grant.
+     */
+    explicit DeliveryCredits(uint32_t initial = 0);
+
+    /**
+     * @brief Return credits to the broker.
+     *
+     * @param count Number of additional deliveries the subscriber can accept.
+     */
+    void grant(uint32_t count = 1);
+
+    /**
+     * @brief Consume one credit if one is available (used by the broker).
+     *
+     * @return true if a credit was consumed.
+     */
+    bool tryAcquire();
+
+    /** @brief Credits currently available. */
+    uint32_t available() const { return m_available.load(); }
+
+    /**
+     * @brief Set the function grant() calls when the broker waits for credit.
+     *
+     * Used by the broker when a subscription with these credits is added. The
+     * wakeup runs on the thread that calls grant(), at most once each time
+     * the broker ran out of credit, so it must be cheap and must not block.
+     * A later call replaces the wakeup of another owner.
+     *
+     * @param owner Identifies the caller for clearWakeup().
+     * @param wakeup The function to call.
+     */
+    void setWakeup(const void* owner, std::function<void()> wakeup);
+
+    /**
+     * @brief Remove the wakeup set by owner.
+     *
+     * Returns once a wakeup running concurrently has finished.
+     *
+     * @param owner The owner passed to setWakeup().
+     */
+    void clearWakeup(const void* owner);
+
+    /** @brief Messages dropped for lack of credit (DROP, or HOLD beyond its limit). */
+    uint64_t getDroppedCount() const { return m_dropped.load(std::memory_order_relaxed); }
+
+    /** @brief Messages replaced by a newer one while waiting for credit (CONFLATE). */
+    uint64_t getConflatedCount() const { return m_conflated.load(std::memory_order_relaxed); }
+
+private:
+    friend class CreditGate;
+
+    // Consume a credit, or ask the next grant() for a wakeup if none is left
+    bool acquireOrWait();
+
+    std::atomic<uint32_t> m_available;
+    std::atomic<uint64_t> m_dropped;
+    std::atomic<uint64_t> m_conflated;
+
+    // Set when the broker found no credit; cleared by the grant that wakes it
+    std::atomic<bool> m_waiting;
+
+    // The wakeup and its owner, guarded by a spinlock that grant() holds only
+    // while running the wakeup
+    std::atomic_flag m_wakeupLock;
+    std::function<void()> m_wakeup;
+    const void* m_wakeupOwner;
+};
+
+/**
+ * @brief Broker-side flow control state of one subscription.
+ *
+ * Decides for each message whether it can be delivered now and keeps the
+ * messages that have to wait according to the subscription's CreditPolicy.
+ * Thread-safe.
+ */
+class CreditGate {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param credits The subscriber's credit account.
+     * @param policy What to do without credit.
+     * @param maxHeld Maximum messages kept under CreditPolicy::HOLD (at least 1).
+     */
+    CreditGate(std::shared_ptr<DeliveryCredits> credits, CreditPolicy policy, std::size_t maxHeld);
+
+    /**
+     * @brief Offer a message for delivery.
+     *
+     * Messages already waiting go first, so a message is only admitted
+     * directly if nothing is held and a credit is available.
+     *
+     * @param message The message to deliver.
+     * @return true if the caller should deliver the message now; false if it
+     *         was held or dropped.
+     */
+    bool admit(const std::shared_ptr<MCPMessage_V1>& message);
+
+    /**
+     * @brief Take the held messages that the available credits now cover.
+     *
+     * @param released Receives the messages to deliver, oldest first.
+     * @return true if messages are still held afterwards.
+     */
+    bool release(std::vector<std::shared_ptr<MCPMessage_V1>>& released);
+
+    /**
+     * @brief Claim the job of retrying the held messages.
+     *
+     * @return true if messages are held and no retry was claimed yet; the
+     *         claim lasts until release() finds nothing left to hold.
+     */
+    bool claimRetry();
+
+    /**
+     * @brief Discard the held messages and hold nothing from now on.
+     *
+     * Called when the subscription is removed.
+     */
+    void close();
+
+    /** @brief Number of messages currently held. */
+    std::size_t heldCount() const;
+
+    /** @brief The credit account the gate draws from. */
+    const std::shared_ptr<DeliveryCredits>& getCredits() const { return m_credits; }
+
+private:
+    std::shared_ptr<DeliveryCredits> m_credits;
+    CreditPolicy m_policy;
+    std::size_t m_maxHeld;
+
+    mutable std::mutex m_mutex;
+    std::deque<std::shared_ptr<MCPMessage_V1>> m_held;
+    bool m_retryPending;
+    bool m_closed;
+};
+
+} // namespace mcp
@@ -77,7 +77,9 @@ struct MCPMessage_V1 {
         dataSize(dataSize),
         messageId(messageId),
         priority(priority),
-        timestamp(std::chrono::steady_clock::now()) {}
+        timestamp(std::chrono::steady_clock::now()),
+        correlationId(0),
+        topicHash(0) {}
     
     /** The topic name associated with this message. */
     std::string topic;
@@ -102,6 +104,20 @@ struct MCPMessage_V1 {
     
     /** Timestamp when the message was created. */
     std::chrono::steady_clock::time_point timestamp;
+    
+    /**
+     * Request/reply correlation (0 for ordinary messages). The broker sets it
+     * on a request and copies it to the reply, which lets a handler that
+     * answers later (see MCPBroker::reply()) match the reply to its request.
+     */
+    uint64_t correlationId;
+
+    /**
+     * Hash of the topic name (see hashTopicName()), or 0 if unknown. Set by
+     * the TopicLiteral overloads so the broker can look the topic up without
+     * hashing or comparing the name.
+     */
+    uint64_t topicHash;
 };
 
 } // namespace mcp 
\ No newline at end of file
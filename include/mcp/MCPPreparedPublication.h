@@ -0,0 +1,153 @@
+#pragma once
+
+#include "IMCPBroker.h"
+#include "MCPMessage_V1.h"
+#include "MCPSerialization.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace mcp {
+
+/**
+ * @brief A reusable publication for a fixed-shape topic.
+ *
+ * A provider that publishes the same topic at a high rate creates one
+ * PreparedPublication up front instead of building a new MCPMessage_V1,
+ * payload buffer and topic/format strings on every publish. The publication
+ * owns a small pool of messages, each with a payload buffer of
+ * maxPayloadSize bytes. Each publish writes the new payload into a message
+ * that every subscriber has released (nobody else holds the message or its
+ * data), so in steady state publishing allocates nothing.
+ *
+ * If every pooled message is still in use, a new one is added up to
+ * maxSlots. Beyond that the pooled message released least recently is left
+ * to whoever still holds it and replaced by a new one, so publishing never
+ * fails for lack of storage but allocates (counted by getReplacedCount()).
+ *
+ * The broker keeps some messages referenced by itself: a topic's history
+ * ring (see MCPBroker::enableHistory()) and a STATE topic's latest value.
+ * When publishing through an MCPBroker, the pool bound grows by that many
+ * messages, as declared when the publication is created, so that retention
+ * does not defeat recycling.
+ *
+ * NOT thread-safe - use one PreparedPublication per publishing thread.
+ */
+class PreparedPublication {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param broker The broker to publish through.
+     * @param topic The topic every message is published on.
+     * @param senderModuleId The ID of the publishing module.
+     * @param dataFormat The payload format (e.g. DataFormat::MSGPACK).
+     * @param maxPayloadSize Capacity of each pooled payload buffer in bytes.
+     * @param initialSlots Number of messages allocated up front.
+     * @param maxSlots Upper bound on the number of pooled messages, on top
+     *        of the messages the broker retains on the topic.
+     */
+    PreparedPublication(std::shared_ptr<IMCPBroker> broker,
+                        const std::string& topic,
+                        int senderModuleId,
+                        const std::string& dataFormat,
+                        std::size_t maxPayloadSize,
+                        std::size_t initialSlots = 4,
+                        std::size_t maxSlots = 64);
+
+    /**
+     * @brief Constructor for a topic literal; the pooled messages carry its hash.
+     *
+     * @param broker The broker to publish through.
+     * @param topic The topic every message is published on.
+     * @param senderModuleId The ID of the publishing module.
+     * @param dataFormat The payload format (e.g. DataFormat::MSGPACK).
+     * @param maxPayloadSize Capacity of each pooled payload buffer in bytes.
+     * @param initialSlots Number of messages allocated up front.
+     * @param maxSlots Upper bound on the number of pooled messages, on top
+     *        of the messages the broker retains on the topic.
+     */
+    PreparedPublication(std::shared_ptr<IMCPBroker> broker,
+                        const TopicLiteral& topic,
+                        int senderModuleId,
+                        const std::string& dataFormat,
+                        std::size_t maxPayloadSize,
+                        std::size_t initialSlots = 4,
+                        std::size_t maxSlots = 64);
+
+    /**
+     * @brief Publish a raw payload by copying it into recycled storage.
+     *
+     * @param payload Pointer to the payload bytes.
+     * @param size Payload size; must not exceed maxPayloadSize.
+     * @return bool True if the message was queued, false otherwise.
+     */
+    bool publishBytes(const void* payload, std::size_t size);
+
+    /**
+     * @brief Encode a value as MessagePack straight into recycled storage.
+     *
+     * Only valid for publications created with DataFormat::MSGPACK.
+     *
+     * @tparam T A type supported by serialization::encodeMsgPackInto().
+     * @param value The value to publish.
+     * @return bool True if the message was queued, false otherwise.
+     */
+    template<typename T>
+    bool publish(const T& value) {
+        if (m_dataFormat != DataFormat::MSGPACK) {
+            return false;
+        }
+
+        std::shared_ptr<MCPMessage_V1>* slot = acquireSlot();
+        if (!slot) {
+            return false;
+        }
+
+        std::size_t size = serialization::encodeMsgPackInto(value, (*slot)->data.get(), m_maxPayloadSize);
+        if (size == 0) {
+            return false;
+        }
+        return commit(*slot, size);
+    }
+
+    /** @brief The topic this publication publishes on. */
+    const std::string& getTopic() const { return m_topic; }
+
+    /** @brief Number of pooled messages allocated so far. */
+    std::size_t getSlotCount() const { return m_slots.size(); }
+
+    /** @brief Number of successful publishes. */
+    uint64_t getPublishedCount() const { return m_published; }
+
+    /** @brief Number of pooled messages replaced because every one was still in use. */
+    uint64_t getReplacedCount() const { return m_replaced; }
+
+private:
+    // Find a pooled message nobody else references, growing the pool or
+    // replacing a message that is still held if needed
+    std::shared_ptr<MCPMessage_V1>* acquireSlot();
+
+    // Allocate one pooled message with its payload buffer
+    std::shared_ptr<MCPMessage_V1> createSlot() const;
+
+    // Stamp and publish a filled message
+    bool commit(std::shared_ptr<MCPMessage_V1>& slot, std::size_t size);
+
+    std::shared_ptr<IMCPBroker> m_broker;
+    std::string m_topic;
+    uint64_t m_topicHash;
+    int m_senderModuleId;
+    std::string m_dataFormat;
+    std::size_t m_maxPayloadSize;
+    std::size_t m_maxSlots;
+
+    std::vector<std::shared_ptr<MCPMessage_V1>> m_slots;
+    std::size_t m_nextSlot;
+    uint64_t m_nextMessageId;
+    uint64_t m_published;
+    uint64_t m_replaced;
+};
+
+} // namespace mcp
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace mcp {
+
+/**
+ * @brief One level of detail of an array topic.
+ *
+ * Bin i summarises source samples [i * binSize, (i + 1) * binSize). Drawing
+ * a vertical line from min to max per bin reproduces every peak of the full
+ * array at the level's resolution.
+ */
+struct MinMaxLevel {
+    /** Smallest sample of each bin. */
+    std::vector<float> min;
+
+    /** Largest sample of each bin. */
+    std::vector<float> max;
+
+    /** Mean of each bin (the final partial bin is approximate). */
+    std::vector<float> mean;
+
+    /** Number of source samples summarised by one bin. */
+    uint32_t binSize = 1;
+
+    /** Number of samples in the source array. */
+    uint32_t sourceSize = 0;
+
+    /** @brief Number of bins. */
+    std::size_t size() const { return min.size(); }
+};
+
+/**
+ * @brief Min/max/mean pyramid of a float array.
+ *
+ * Level k has bins of 2^(k+1) samples; each level is computed from the
+ * previous one by combining adjacent bins, so building the whole pyramid
+ * costs about two passes over the samples. The reduction uses SSE where the
+ * target supports it and a scalar loop elsewhere.
+ */
+class MinMaxPyramid {
+public:
+    /**
+     * @brief Build the levels down to a minimum resolution.
+     *
+     * @param samples The source array.
+     * @param minResolution Stop once a level has at most this many bins.
+     */
+    MinMaxPyramid(const std::vector<float>& samples, std::size_t minResolution);
+
+    /** @brief Number of levels built. */
+    std::size_t getLevelCount() const { return m_levels.size(); }
+
+    /**
+     * @brief Get a level; index 0 is the finest (2 samples per bin).
+     *
+     * @param index The level index (must be < getLevelCount()).
+     */
+    const MinMaxLevel& getLevel(std::size_t index) const { return m_levels[index]; }
+
+    /**
+     * @brief Pick the coarsest level that still has enough bins.
+     *
+     * @param targetResolution The number of bins the consumer can use.
+     * @return Index of the level to use, or -1 if no level has at least
+     *         targetResolution bins (the consumer should take the full array).
+     */
+    int selectLevel(std::size_t targetResolution) const;
+
+    /**
+     * @brief Combine adjacent pairs of bins into half as many bins.
+     *
+     * An odd final bin is carried over unchanged. The outputs must hold
+     * (count + 1) / 2 values and must not alias the inputs.
+     *
+     * @param minIn Bin minimums.
+     * @param maxIn Bin maximums.
+     * @param meanIn Bin means.
+     * @param count Number of input bins.
+     * @param minOut Receives the combined minimums.
+     * @param maxOut Receives the combined maximums.
+     * @param meanOut Receives the combined means.
+     */
+    static void decimate(const float* minIn, const float* maxIn, const float* meanIn,
+                         std::size_t count,
+                         float* minOut, float* maxOut, float* meanOut);
+
+private:
+    std::vector<MinMaxLevel> m_levels;
+};
+
+} // namespace mcp
@@ -97,8 +97,12 @@ public:
             }
         }
         catch (const MCPSerializationError& e) {
-            // Log error but don't throw from here
-            std::cerr << "Error publishing message: " << e.what() << std::endl;
+            // Report but don't throw from here
+            auto broker = MCPBroker::getInstance();
+            if (broker) {
+                broker->reportError("mcp.reference-provider", ErrorCode::SERIALIZATION_FAILED,
+                                    ErrorSeverity::WARNING, e.what(), topic.c_str());
+            }
         }
     }
 
@@ -33,7 +33,9 @@ struct ReceivedMessage {
  * 1. Subscribe to topics
  * 2. Safely receive and deserialize messages
  * 3. Pass data from the worker thread to the audio thread
- * 4. Properly initialize and clean up
+ * 4. Grant delivery credits as the audio thread drains, so the broker never
+ *    delivers more than the ring buffer can hold
+ * 5. Properly initialize and clean up
  */
 class MCPReferenceSubscriber : public rack::Module, public IMCPSubscriber_V1 {
 public:
@@ -100,6 +102,19 @@ public:
      */
     void onMCPMessage(const MCPMessage_V1* message) override;
     
+    /**
+     * @brief Get the number of messages received on a topic
+     * @param topic Topic name
+     * @return Number of messages received on the topic
+     */
+    int getMessageCount(const std::string& topic) const;
+    
+    /**
+     * @brief Get the number of messages received on all topics
+     * @return Total number of messages received
+     */
+    int getTotalMessagesReceived() const;
+    
     /**
      * @brief Subscribe to a specific topic
      * @param topic Topic to subscribe to
@@ -119,7 +134,40 @@ private:
     std::vector<std::string> m_subscribedTopics;
     
     // Thread-safe ring buffer for passing messages from worker to audio thread
-    RingBuffer<ReceivedMessage> m_messageQueue{32};
+    static const uint32_t QUEUE_CAPACITY = 32;
+    RingBuffer<ReceivedMessage> m_messageQueue{QUEUE_CAPACITY};
+    
+    // One credit per free ring slot; the audio thread grants a credit for
+    // every message it pops, and state topics conflate while the ring is full
+    std::shared_ptr<DeliveryCredits> m_credits;
+    
+    // Subscription options used for every topic
+    SubscriptionOptions subscriptionOptions() const;
+    
+    // Broker that errors are reported to, set in onAdd()
+    std::weak_ptr<MCPBroker> m_broker;
+    
+    // Report an error to the broker (worker side only; the broker lookup
+    // must not run on the audio thread)
+    void reportError(const char* code, const char* message, const char* topic) const;
+    
+    // Error raised on the audio thread, kept in a preallocated slot until a
+    // worker forwards it: the audio thread fills the slot only while it is
+    // free and counts every occurrence
+    struct AudioError {
+        std::atomic<bool> ready{false};
+        std::atomic<uint32_t> count{0};
+        const char* code = nullptr;
+        char message[128];
+        char topic[64];
+    };
+    AudioError m_audioError;
+    
+    // Record an error on the audio thread without allocating or locking
+    void recordAudioError(const char* code, const char* message, const char* topic);
+    
+    // Report the audio thread's pending error (under m_producerMutex)
+    void forwardAudioError();
     
     // Current parameter values (accessed from audio thread)
     float m_parameter1{0.0f};
@@ -130,7 +178,11 @@ private:
     // Mutex for parameter access
     mutable std::mutex m_paramMutex;
     
-    // Message counts for statistics
+    // Serializes the producer side (counts and ring buffer pushes) across
+    // dispatch workers delivering different topics
+    mutable std::mutex m_producerMutex;
+    
+    // Message counts for statistics (guarded by m_producerMutex)
     std::unordered_map<std::string, int> m_messageCountsByTopic;
     std::atomic<int> m_totalMessagesReceived{0};
     std::atomic<int> m_messagesProcessed{0};
@@ -0,0 +1,313 @@
+#pragma once
+
+#include "IMCPSubscriber_V1.h"
+#include "MCPMessage_V1.h"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <thread>
+#include <string>
+#include <limits>
+#include <cstdint>
+
+namespace mcp {
+
+class MCPBroker;
+
+/**
+ * @brief A pre-allocated, sequenced ring of slots with one cursor per consumer.
+ *
+ * Alternative to the broker's queue for high fan-out streams. Every entry is
+ * written once into a slot and every consumer reads it in place, so adding
+ * consumers adds no copies, allocations or reference-count traffic. Each
+ * consumer advances its own cursor and reads everything that is available
+ * in one batch. The producer may not overwrite a slot until the slowest
+ * consumer has moved past it (gating).
+ *
+ * Thread Safety Requirements:
+ * - ONE producer thread calls tryPublish()/publish()
+ * - Each Consumer is polled by ONE thread at a time (different consumers may
+ *   be polled concurrently)
+ * - addConsumer()/removeConsumer() may be called from any thread
+ *
+ * Nothing takes a lock: the producer only waits (in publish()) while the log
+ * is full, and consumers join and leave without stalling it.
+ *
+ * @tparam T Slot type. Slots are default-constructed up front and assigned
+ *           in place when published.
+ */
+template <typename T>
+class SequencedLog {
+private:
+    // Sequence of a consumer slot that is not in use; never gates the producer
+    static const uint64_t INACTIVE = std::numeric_limits<uint64_t>::max();
+
+    // One consumer position per cache line to prevent false sharing. The
+    // vector's storage is only aligned to alignof(max_align_t), so each slot
+    // spans two cache lines with the position in the middle: whatever the
+    // base address, no other position or neighbouring heap data can share
+    // its line.
+    struct CursorSlot {
+        char leading[64];
+        std::atomic<uint64_t> next{INACTIVE};
+        char trailing[64 - sizeof(std::atomic<uint64_t>)];
+    };
+
+public:
+    /**
+     * @brief A consumer's position in the log.
+     *
+     * Obtained from addConsumer(); must not outlive the log.
+     */
+    class Consumer {
+    public:
+        /**
+         * @brief Read every available entry (up to maxBatch) in order.
+         *
+         * @param handler Called as handler(const T& value, uint64_t sequence,
+         *        bool endOfBatch) for each entry; the value must not be kept
+         *        beyond the call.
+         * @param maxBatch Maximum number of entries to read; 0 means no limit.
+         * @return std::size_t Number of entries read.
+         */
+        template <typename Handler>
+        std::size_t poll(Handler&& handler, std::size_t maxBatch = 0) {
+            uint64_t next = m_cursor->next.load(std::memory_order_relaxed);
+            uint64_t available = m_log->m_published.load(std::memory_order_acquire);
+            if (next >= available) {
+                return 0;
+            }
+
+            uint64_t end = available;
+            if (maxBatch > 0 && end - next > maxBatch) {
+                end = next + maxBatch;
+            }
+
+            for (uint64_t sequence = next; sequence < end; ++sequence) {
+                handler(static_cast<const T&>(m_log->m_slots[sequence & m_log->m_mask]),
+                        sequence, sequence + 1 == end);
+            }
+
+            // Release the slots to the producer only after they were read
+            m_cursor->next.store(end, std::memory_order_release);
+            return static_cast<std::size_t>(end - next);
+        }
+
+        /** @brief Number of entries published but not yet read by this consumer. */
+        uint64_t backlog() const {
+            return m_log->m_published.load(std::memory_order_acquire) -
+                   m_cursor->next.load(std::memory_order_relaxed);
+        }
+
+        /** @brief Sequence of the next entry this consumer will read. */
+        uint64_t position() const { return m_cursor->next.load(std::memory_order_relaxed); }
+
+    private:
+        friend class SequencedLog;
+
+        Consumer(SequencedLog* log, CursorSlot* cursor) : m_log(log), m_cursor(cursor) {}
+
+        SequencedLog* m_log;
+        CursorSlot* m_cursor;
+    };
+
+    /**
+     * @brief Constructs a log.
+     *
+     * @param capacity Number of slots, rounded up to a power of two.
+     * @param maxConsumers Maximum number of consumers attached at once.
+     */
+    explicit SequencedLog(std::size_t capacity = 1024, std::size_t maxConsumers = 16)
+        : m_cursors(maxConsumers), m_published(0), m_gate(0) {
+        std::size_t size = 1;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        m_slots.resize(size);
+        m_mask = size - 1;
+    }
+
+    /** @brief Number of slots. */
+    std::size_t capacity() const { return m_slots.size(); }
+
+    /** @brief Number of entries published so far (the next sequence). */
+    uint64_t published() const { return m_published.load(std::memory_order_acquire); }
+
+    /**
+     * @brief Attach a consumer that starts with the next published entry.
+     *
+     * @return std::unique_ptr<Consumer> The consumer, or nullptr if
+     *         maxConsumers are already attached.
+     */
+    std::unique_ptr<Consumer> addConsumer() {
+        for (auto& cursor : m_cursors) {
+            // Claim the slot at a position that gates every later refresh
+            uint64_t expected = INACTIVE;
+            if (!cursor.next.compare_exchange_strong(expected, m_published.load(std::memory_order_acquire))) {
+                continue;
+            }
+
+            // Pairs with the fence in refreshGate(): a refresh that missed the
+            // claim computed its gate from at most the position read here,
+            // so a producer still using that gate cannot overwrite anything
+            // from here on, and every later refresh sees this cursor
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            cursor.next.store(m_published.load(std::memory_order_acquire), std::memory_order_release);
+            return std::unique_ptr<Consumer>(new Consumer(this, &cursor));
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Detach a consumer so it no longer gates the producer.
+     *
+     * @param consumer The consumer returned by addConsumer().
+     */
+    void removeConsumer(std::unique_ptr<Consumer>& consumer) {
+        if (!consumer) {
+            return;
+        }
+        consumer->m_cursor->next.store(INACTIVE, std::memory_order_release);
+        consumer.reset();
+    }
+
+    /**
+     * @brief Write an entry if the slowest consumer left room for it.
+     *
+     * Only the producer thread may call this.
+     *
+     * @param value The value to copy into the next slot.
+     * @return true if published, false if the log is full.
+     */
+    bool tryPublish(const T& value) {
+        uint64_t sequence = m_published.load(std::memory_order_relaxed);
+        if (sequence - m_gate >= m_slots.size() && !refreshGate(sequence)) {
+            return false;
+        }
+
+        m_slots[sequence & m_mask] = value;
+        m_published.store(sequence + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Write an entry, yielding while the slowest consumer catches up.
+     *
+     * Only the producer thread may call this. Never call it from the audio thread.
+     *
+     * @param value The value to copy into the next slot.
+     */
+    void publish(const T& value) {
+        while (!tryPublish(value)) {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    // Recompute the slowest consumer position; true if the sequence now fits.
+    // Never blocks: consumers join and leave without a lock (see addConsumer())
+    bool refreshGate(uint64_t sequence) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint64_t gate = sequence;
+        for (const auto& cursor : m_cursors) {
+            uint64_t next = cursor.next.load(std::memory_order_acquire);
+            if (next < gate) {
+                gate = next;
+            }
+        }
+        m_gate = gate;
+        return sequence - m_gate < m_slots.size();
+    }
+
+    std::vector<T> m_slots;
+    std::size_t m_mask;
+    std::vector<CursorSlot> m_cursors;
+
+    // Written only by the producer
+    alignas(64) std::atomic<uint64_t> m_published;
+    uint64_t m_gate;
+};
+
+template <typename T>
+const uint64_t SequencedLog<T>::INACTIVE;
+
+/**
+ * @brief Sequenced log of MCP messages.
+ */
+using SequencedMessageLog = SequencedLog<std::shared_ptr<MCPMessage_V1>>;
+
+/**
+ * @brief Adapter that feeds a SequencedMessageLog to an IMCPSubscriber_V1.
+ *
+ * Each adapter owns one consumer cursor. Messages are passed to
+ * onMCPMessage() straight from the log's slots, optionally filtered by topic.
+ * The adapter can run its own polling thread (start()/stop()) or be drained
+ * manually from an existing thread with drain(). Exceptions thrown by the
+ * subscriber are reported to the broker given at construction (see
+ * MCPBroker::reportError()), which neither allocates nor locks.
+ */
+class SequencedLogSubscriber {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param log The log to consume; must outlive the adapter.
+     * @param subscriber The subscriber to call.
+     * @param topic Only deliver messages of this topic; empty delivers all.
+     * @param broker Broker that subscriber failures are reported to; if
+     *        empty (or gone), failures are only skipped.
+     */
+    SequencedLogSubscriber(SequencedMessageLog& log,
+                           std::shared_ptr<IMCPSubscriber_V1> subscriber,
+                           const std::string& topic = std::string(),
+                           std::weak_ptr<MCPBroker> broker = std::weak_ptr<MCPBroker>());
+
+    /**
+     * @brief Destructor. Stops the polling thread and detaches the cursor.
+     */
+    ~SequencedLogSubscriber();
+
+    /** @brief False if the log had no free consumer slot. */
+    bool isAttached() const { return m_consumer != nullptr; }
+
+    /**
+     * @brief Deliver everything available, in batches of at most maxBatch.
+     *
+     * Must not be called while the polling thread is running.
+     *
+     * @param maxBatch Maximum messages per batch; 0 means no limit.
+     * @return std::size_t Number of log entries consumed (filtered ones included).
+     */
+    std::size_t drain(std::size_t maxBatch = 0);
+
+    /**
+     * @brief Start a thread that polls the log and delivers continuously.
+     *
+     * The thread spins briefly, then yields, then sleeps while the log is idle.
+     */
+    void start();
+
+    /** @brief Stop the polling thread. */
+    void stop();
+
+    /** @brief Number of messages delivered to the subscriber so far. */
+    uint64_t getDeliveredCount() const { return m_delivered.load(std::memory_order_relaxed); }
+
+private:
+    // Deliver one batch (polling thread or drain())
+    std::size_t pollOnce(std::size_t maxBatch);
+
+    // Polling thread function
+    void run();
+
+    SequencedMessageLog& m_log;
+    std::weak_ptr<IMCPSubscriber_V1> m_subscriber;
+    std::string m_topic;
+    std::weak_ptr<MCPBroker> m_broker;
+    std::unique_ptr<SequencedMessageLog::Consumer> m_consumer;
+    std::thread m_thread;
+    std::atomic<bool> m_running;
+    std::atomic<uint64_t> m_delivered;
+};
+
+} // namespace mcp
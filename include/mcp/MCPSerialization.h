@@ -1,6 +1,7 @@
 #pragma once
 
 #include "MCPMessage_V1.h"
+#include "MCPTopic.h"
 #include <string>
 #include <memory>
 #include <vector>
@@ -23,6 +24,22 @@ public:
         : std::runtime_error(message) {}
 };
 
+/**
+ * @brief Top-level value type of a serialized payload.
+ */
+enum class PayloadType {
+    /** Any type (in a declaration), or not recognised (when inspecting a payload). */
+    ANY,
+    NIL,
+    BOOLEAN,
+    INTEGER,
+    FLOAT,
+    STRING,
+    BINARY,
+    ARRAY,
+    MAP
+};
+
 /**
  * @brief Namespace containing serialization helper functions
  */
@@ -76,6 +93,23 @@ std::shared_ptr<void> serializeToMsgPack(const T& obj, std::size_t& dataSize);
 template<typename T>
 T deserializeFromMsgPack(const void* data, std::size_t dataSize);
 
+/**
+ * @brief Encode an object as MessagePack directly into a caller-owned buffer
+ * 
+ * Unlike serializeToMsgPack() this performs no allocation, which makes it
+ * suitable for recycled message storage. The encoding is compatible with
+ * deserializeFromMsgPack(). Specializations exist for float, double, int,
+ * std::string and std::vector<float>.
+ * 
+ * @tparam T Type of object to encode
+ * @param obj Object to encode
+ * @param buffer Destination buffer
+ * @param capacity Size of the destination buffer in bytes
+ * @return std::size_t Number of bytes written, or 0 if the buffer is too small
+ */
+template<typename T>
+std::size_t encodeMsgPackInto(const T& obj, void* buffer, std::size_t capacity);
+
 /**
  * @brief Serialize object to JSON format
  * 
@@ -128,6 +162,48 @@ std::shared_ptr<MCPMessage_V1> createJSONMessage(
     int senderModuleId, 
     const T& data);
 
+/**
+ * @brief Create an MCPMessage_V1 with MessagePack serialized data on a topic literal
+ * 
+ * The message carries the topic's precomputed hash.
+ * 
+ * @tparam T Type of object to serialize
+ * @param topic Message topic
+ * @param senderModuleId Sender module ID
+ * @param data Data to serialize
+ * @return std::shared_ptr<MCPMessage_V1> The created message
+ */
+template<typename T>
+std::shared_ptr<MCPMessage_V1> createMsgPackMessage(
+    const TopicLiteral& topic, 
+    int senderModuleId, 
+    const T& data) {
+    auto message = createMsgPackMessage(topic.str(), senderModuleId, data);
+    message->topicHash = topic.hash();
+    return message;
+}
+
+/**
+ * @brief Create an MCPMessage_V1 with JSON serialized data on a topic literal
+ * 
+ * The message carries the topic's precomputed hash.
+ * 
+ * @tparam T Type of object to serialize
+ * @param topic Message topic
+ * @param senderModuleId Sender module ID
+ * @param data Data to serialize
+ * @return std::shared_ptr<MCPMessage_V1> The created message
+ */
+template<typename T>
+std::shared_ptr<MCPMessage_V1> createJSONMessage(
+    const TopicLiteral& topic, 
+    int senderModuleId, 
+    const T& data) {
+    auto message = createJSONMessage(topic.str(), senderModuleId, data);
+    message->topicHash = topic.hash();
+    return message;
+}
+
 /**
  * @brief Extract data from an MCPMessage_V1
  * 
@@ -138,5 +214,18 @@ std::shared_ptr<MCPMessage_V1> createJSONMessage(
 template<typename T>
 T extractMessageData(const MCPMessage_V1* message);
 
+/**
+ * @brief Read the top-level type of MessagePack data from its first byte
+ * 
+ * Does not decode or validate the rest of the payload, so it is cheap enough
+ * to run on every publish.
+ * 
+ * @param data The MessagePack data
+ * @param dataSize The size of the data in bytes
+ * @return PayloadType The type, or PayloadType::ANY if the data is empty or
+ *         starts with an extension type
+ */
+PayloadType peekMsgPackType(const void* data, std::size_t dataSize);
+
 } // namespace serialization
 } // namespace mcp 
\ No newline at end of file
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "MCPMessage_V1.h"
+#include <string>
+#include <memory>
+#include <vector>
+
+namespace mcp {
+
+/**
+ * @brief Reads and writes snapshot files of retained topic state.
+ *
+ * A snapshot holds one message per topic (topic, sender, data format and
+ * payload) in a compact binary file. Files are written and read through a
+ * memory mapping where the platform supports it. Restored messages point
+ * straight into the read-only mapping, which stays alive until the last of
+ * them is released, so loading a snapshot copies no payloads.
+ *
+ * The file layout is native-endian and meant for the machine that wrote it
+ * (a warm start after a patch reload), not for exchange.
+ */
+class Snapshot {
+public:
+    /**
+     * @brief Write messages to a snapshot file, replacing it.
+     *
+     * @param path The file to write.
+     * @param messages The messages to store; null entries are skipped.
+     * @return bool True if the file was written completely.
+     */
+    static bool write(const std::string& path,
+                      const std::vector<std::shared_ptr<const MCPMessage_V1>>& messages);
+
+    /**
+     * @brief Read the messages of a snapshot file.
+     *
+     * @param path The file to read.
+     * @param messages Receives the stored messages, in file order.
+     * @return bool True if the file exists and is a valid snapshot; nothing
+     *         is added to messages otherwise.
+     */
+    static bool read(const std::string& path,
+                     std::vector<std::shared_ptr<MCPMessage_V1>>& messages);
+};
+
+} // namespace mcp
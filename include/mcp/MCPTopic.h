@@ -0,0 +1,105 @@
+#pragma once
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+namespace mcp {
+
+/**
+ * @brief Stable 64-bit hash of a topic name (FNV-1a).
+ *
+ * Usable in constant expressions, so topic names written as literals are
+ * hashed by the compiler. Never returns 0, which marks "no hash" in
+ * MCPMessage_V1::topicHash.
+ *
+ * @param name The topic name.
+ * @param size Length of the name in characters.
+ * @return uint64_t The hash.
+ */
+constexpr uint64_t hashTopicName(const char* name, std::size_t size) {
+    uint64_t hash = 14695981039346656037ull;
+    for (std::size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8_t>(name[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash != 0 ? hash : 1;
+}
+
+/**
+ * @brief Runtime form of hashTopicName() for topic names held in strings.
+ */
+inline uint64_t hashTopicName(const std::string& name) {
+    return hashTopicName(name.data(), name.size());
+}
+
+/**
+ * @brief A topic name known at compile time, together with its hash.
+ *
+ * Declare topics once as constants and pass them to the broker and
+ * serialization overloads:
+ *
+ * @code
+ * constexpr mcp::TopicLiteral PARAMETER1("reference/parameter1");
+ * broker->subscribe(PARAMETER1, subscriber);
+ * broker->publish(mcp::serialization::createMsgPackMessage(PARAMETER1, moduleId, 0.5f));
+ * @endcode
+ *
+ * Messages created from a TopicLiteral carry its hash, which the broker
+ * uses in place of the name to find the topic's dispatch queue and
+ * subscribers once the topic has been registered or subscribed through a
+ * TopicLiteral (where hash collisions are checked).
+ */
+class TopicLiteral {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * Explicit, so plain string literals keep selecting the std::string
+     * overloads.
+     *
+     * @param name A string literal naming the topic.
+     */
+    template<std::size_t N>
+    explicit constexpr TopicLiteral(const char (&name)[N])
+        : m_name(name), m_size(N - 1), m_hash(hashTopicName(name, N - 1)) {}
+
+    /**
+     * @brief Constructor for a name of known length (used by the _topic literal).
+     *
+     * @param name The topic name; must outlive the TopicLiteral.
+     * @param size Length of the name in characters.
+     */
+    constexpr TopicLiteral(const char* name, std::size_t size)
+        : m_name(name), m_size(size), m_hash(hashTopicName(name, size)) {}
+
+    /** @brief The topic name (not necessarily null-terminated beyond size()). */
+    constexpr const char* data() const { return m_name; }
+
+    /** @brief Length of the topic name. */
+    constexpr std::size_t size() const { return m_size; }
+
+    /** @brief The topic's hash (see hashTopicName()). */
+    constexpr uint64_t hash() const { return m_hash; }
+
+    /** @brief The topic name as a string. */
+    std::string str() const { return std::string(m_name, m_size); }
+
+private:
+    const char* m_name;
+    std::size_t m_size;
+    uint64_t m_hash;
+};
+
+namespace literals {
+
+/**
+ * @brief Write "reference/parameter1"_topic for a TopicLiteral.
+ */
+constexpr TopicLiteral operator"" _topic(const char* name, std::size_t size) {
+    return TopicLiteral(name, size);
+}
+
+} // namespace literals
+
+} // namespace mcp
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "MCPMessage_V1.h"
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mcp {
+
+/**
+ * @brief Retention limits of a topic's history.
+ */
+struct HistoryConfig {
+    /** Maximum number of messages kept (at least 1). */
+    std::size_t maxMessages = 64;
+
+    /** Messages older than this are not returned; zero keeps them until overwritten. */
+    std::chrono::milliseconds maxAge{0};
+};
+
+/**
+ * @brief Bounded ring of the most recent messages dispatched on one topic.
+ *
+ * The broker appends every message of a topic with history enabled just
+ * before delivering it, so the ring is in dispatch order. The ring only holds
+ * shared references to the dispatched messages; every reader gets the same
+ * message objects, nothing is copied per consumer.
+ *
+ * Reads are lock-free: they never take a mutex and never wait for the
+ * dispatching worker. The slots are preallocated and each one is guarded by
+ * a sequence counter that is odd while the writer replaces its record; a
+ * reader that finds a slot odd, or holding a newer record than the one it
+ * came for, simply skips it, since that message was overwritten while it was
+ * reading. Readers pin a slot while they copy its message reference, and the
+ * writer waits only for readers already pinned on the slot it replaces, so
+ * appends never allocate. The returned vector is allocated, so do not call
+ * read() from the audio thread.
+ *
+ * Messages stay referenced while they are in the ring; a PreparedPublication
+ * created after history is enabled on its topic sizes its pool for that.
+ */
+class TopicHistory {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param config Retention limits.
+     */
+    explicit TopicHistory(const HistoryConfig& config);
+
+    /**
+     * @brief Append a dispatched message.
+     *
+     * Called by the broker with the topic in flight, so there is only ever
+     * one writer at a time.
+     *
+     * @param message The message being dispatched.
+     * @param publishTime The time at which the message was published.
+     */
+    void append(std::shared_ptr<MCPMessage_V1> message,
+                std::chrono::steady_clock::time_point publishTime);
+
+    /**
+     * @brief Read the most recent messages, oldest first.
+     *
+     * @param maxMessages Maximum number of messages to return; 0 returns all.
+     * @return std::vector<std::shared_ptr<const MCPMessage_V1>> The messages.
+     */
+    std::vector<std::shared_ptr<const MCPMessage_V1>> read(std::size_t maxMessages = 0) const;
+
+    /**
+     * @brief Read the messages published at or after a point in time, oldest first.
+     *
+     * @param since The earliest publish time to return.
+     * @return std::vector<std::shared_ptr<const MCPMessage_V1>> The messages.
+     */
+    std::vector<std::shared_ptr<const MCPMessage_V1>> readSince(
+        std::chrono::steady_clock::time_point since) const;
+
+    /** @brief Total number of messages appended so far. */
+    uint64_t getAppendedCount() const { return m_appended.load(std::memory_order_acquire); }
+
+    /** @brief The retention limits. */
+    const HistoryConfig& getConfig() const { return m_config; }
+
+private:
+    // One ring entry; the record fields are only written while version is
+    // odd and no reader is pinned
+    struct Slot {
+        std::atomic<uint64_t> version{0};
+        std::atomic<uint32_t> readers{0};
+        std::shared_ptr<const MCPMessage_V1> message;
+        std::chrono::steady_clock::time_point publishTime;
+        uint64_t sequence = 0;
+    };
+
+    // Collect records with sequence >= first that are within maxAge and since
+    std::vector<std::shared_ptr<const MCPMessage_V1>> collect(
+        uint64_t first, uint64_t end, std::chrono::steady_clock::time_point since) const;
+
+    HistoryConfig m_config;
+    std::unique_ptr<Slot[]> m_slots;
+    std::atomic<uint64_t> m_appended;
+};
+
+} // namespace mcp
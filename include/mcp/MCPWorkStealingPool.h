@@ -0,0 +1,113 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <functional>
+#include <cstdint>
+
+namespace mcp {
+
+/**
+ * @brief A fixed-size thread pool with one task deque per thread.
+ *
+ * Tasks submitted from a pool thread go to that thread's own deque; tasks
+ * from other threads are spread round-robin. A thread works through its own
+ * deque oldest first and, once that is empty, steals from the far end of the
+ * other threads' deques, so a burst of heavy work spreads across all cores.
+ *
+ * Tasks run in no particular order; use a Strand for ordered execution.
+ * Tasks still queued when the pool is destroyed are discarded.
+ *
+ * Thread-safe - submit() may be called from any thread, including from tasks.
+ */
+class WorkStealingPool {
+public:
+    /**
+     * @brief Start the pool threads.
+     *
+     * @param threadCount Number of threads; 0 uses the number of hardware threads.
+     */
+    explicit WorkStealingPool(std::size_t threadCount = 0);
+
+    /**
+     * @brief Stop the pool. Running tasks finish, queued tasks are discarded.
+     *
+     * May be called from a task running on the pool itself.
+     */
+    ~WorkStealingPool();
+
+    /**
+     * @brief Queue a task for execution on some pool thread.
+     *
+     * @param task The task to run.
+     */
+    void submit(std::function<void()> task);
+
+    /** @brief Number of pool threads. */
+    std::size_t getThreadCount() const;
+
+    /** @brief Number of tasks a thread took from another thread's deque. */
+    uint64_t getStealCount() const;
+
+private:
+    struct State;
+
+    std::shared_ptr<State> m_state;
+    std::vector<std::thread> m_threads;
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+};
+
+/**
+ * @brief Serial mailbox that runs its tasks one at a time, in post order.
+ *
+ * Tasks run on a WorkStealingPool, but never two of the same strand at once,
+ * so work posted to one strand stays ordered while different strands run in
+ * parallel. A strand on a single-thread pool acts as a dedicated thread.
+ *
+ * Thread-safe.
+ */
+class Strand : public std::enable_shared_from_this<Strand> {
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param pool The pool that runs the strand's tasks.
+     */
+    explicit Strand(std::shared_ptr<WorkStealingPool> pool);
+
+    /**
+     * @brief Queue a task behind every task posted earlier.
+     *
+     * @param task The task to run. Dropped if the strand is closed.
+     */
+    void post(std::function<void()> task);
+
+    /**
+     * @brief Discard queued tasks and drop every later post.
+     *
+     * A task that is already running finishes.
+     */
+    void close();
+
+    /** @brief Number of tasks queued and not yet started. */
+    std::size_t pending() const;
+
+private:
+    // Run queued tasks; reschedules itself after a batch so strands share the pool fairly
+    void drain();
+
+    std::shared_ptr<WorkStealingPool> m_pool;
+    mutable std::mutex m_mutex;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_scheduled;
+    bool m_closed;
+};
+
+} // namespace mcp
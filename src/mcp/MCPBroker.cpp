@@ -1,6 +1,12 @@
 #include "mcp/MCPBroker.h"
 #include "mcp/MCPMessage_V1.h"
+#include "mcp/MCPSerialization.h"
+#include "mcp/MCPPyramid.h"
 #include <algorithm>
+#include <limits>
+#include <cmath>
+#include <cstring>
+#include <typeinfo>
 
 namespace mcp {
 
@@ -41,12 +47,75 @@ void shutdownMCPBroker() {
     }
 }
 
-MCPBroker::MCPBroker() : m_threadRunning(true) {
-    // Start the worker thread for message processing
-    m_workerThread = std::thread(&MCPBroker::processMessageQueue, this);
+namespace {
+    // Maximum number of pool-size samples kept for the metrics
+    const std::size_t MAX_POOL_HISTORY = 256;
+    
+    // Topics tracked for content deduplication before expired ones are swept
+    const std::size_t MIN_LAST_PAYLOAD_LIMIT = 64;
+    
+    // Longest a core worker sleeps while a wakeup from a thread that must not
+    // block may be lost (see MCPBroker::wakeWorker())
+    const std::chrono::milliseconds LOST_WAKEUP_BOUND(10);
+    
+    // Longest a core worker sleeps with nothing scheduled
+    const std::chrono::hours MAX_IDLE_WAIT(1);
+    
+    // Fewest recipients worth handing to another thread in a parallel fan-out
+    const std::size_t MIN_FANOUT_CHUNK = 16;
+    
+    // Minimum time between two rounds of error summaries
+    const std::chrono::milliseconds DEFAULT_ERROR_REPORT_INTERVAL(1000);
+    
+    // Names a failed subscriber in error reports; a static string, so
+    // reporting allocates nothing
+    const char* subscriberName(const IMCPSubscriber_V1& subscriber) {
+        return typeid(subscriber).name();
+    }
+    
+    // Dispatch queue key of request timeouts, so they fire while a slow
+    // handler still holds its topic
+    const char* const REQUEST_TIMEOUT_KEY = "@request/timeouts";
+    
+    // Whether a message fits its topic's declaration; only looks at the
+    // header and the first payload byte
+    bool matchesDescriptor(const MCPMessage_V1& message, const TopicDescriptor& descriptor) {
+        if (!descriptor.dataFormat.empty() && message.dataFormat != descriptor.dataFormat) {
+            return false;
+        }
+        if (descriptor.maxPayloadSize > 0 && message.dataSize > descriptor.maxPayloadSize) {
+            return false;
+        }
+        if (descriptor.payloadType != PayloadType::ANY && message.dataFormat == DataFormat::MSGPACK) {
+            return serialization::peekMsgPackType(message.data.get(), message.dataSize) ==
+                   descriptor.payloadType;
+        }
+        return true;
+    }
+}
+
+MCPBroker::MCPBroker() : MCPBroker(DispatchMode::WORKER_THREADS) {}
+
+MCPBroker::MCPBroker(DispatchMode mode)
+    : m_nextCorrelationId(1), m_nextMailboxId(0), m_parallelFanout(0), m_activeWorkers(0), m_workersStarted(false), m_threadRunning(true),
+      m_dispatchMode(mode), m_nextScheduledSequence(0), m_creditsGranted(false),
+      m_errorSink(std::make_shared<ErrorSink>()),
+      m_errorReportInterval(DEFAULT_ERROR_REPORT_INTERVAL), m_conflationSwitches(0),
+      m_dedupMinSize(0), m_lastPayloadLimit(MIN_LAST_PAYLOAD_LIMIT) {
+    // The worker threads start with the first queued work (see startWorkers()),
+    // so creating the broker and loading a patch spawn no threads
+    m_errorSink->broker.store(this);
 }
 
 MCPBroker::~MCPBroker() {
+    // Strand tasks that are still running may report errors, but must not
+    // wake a broker that is going away
+    m_errorSink->detach();
+    
+    // Keep the retained state for the next start (already saved if
+    // clearAllRegistries() ran first)
+    saveShutdownSnapshot();
+    
     // First clear all registries to prevent callbacks to destroyed objects
     {
         std::lock_guard<std::mutex> lock(m_registryMutex);
@@ -55,50 +124,134 @@ MCPBroker::~MCPBroker() {
     
     {
         std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+        for (auto& topicSubscriptions : m_subscriptions) {
+            closeSubscriptions(topicSubscriptions.second.begin(), topicSubscriptions.second.end());
+        }
+        m_subscriptionsByHash.clear();
         m_subscriptions.clear();
+        
+        // Credit grants must not call into the destroyed broker
+        for (const auto& weakCredits : m_creditAccounts) {
+            if (auto credits = weakCredits.lock()) {
+                credits->clearWakeup(this);
+            }
+        }
+        m_creditAccounts.clear();
     }
     
-    // Signal the worker thread to stop
+    // Signal the worker threads to stop
+    std::vector<std::unique_ptr<Worker>> workers;
     {
         std::lock_guard<std::mutex> lock(m_queueMutex);
         m_threadRunning = false;
         
-        // Clear any pending messages
-        while (!m_messageQueue.empty()) {
-            m_messageQueue.pop();
-        }
+        // Clear any pending messages and timers
+        m_messageQueue.clear();
+        m_scheduledTasks = decltype(m_scheduledTasks)();
+        m_creditWaiters.clear();
+        
+        // No worker can be spawned or reaped once m_threadRunning is false
+        workers.swap(m_workers);
     }
     
-    // Wake up the worker thread so it can exit
-    m_queueCondition.notify_one();
+    // Wake up the worker threads so they can exit
+    m_queueCondition.notify_all();
     
-    // Wait for the worker thread to finish
-    if (m_workerThread.joinable()) {
-        m_workerThread.join();
+    // Wait for the worker threads to finish
+    for (auto& worker : workers) {
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
     }
+    
+    // Nothing can answer now
+    cancelPendingRequests();
 }
 
 bool MCPBroker::registerContext(const std::string& topic, 
                                std::shared_ptr<IMCPProvider_V1> provider) {
     if (!topic.empty() && provider) {
         std::lock_guard<std::mutex> lock(m_registryMutex);
-        
-        // Check if the provider is already registered for this topic
-        auto& providers = m_topicRegistry[topic];
-        for (const auto& weakProvider : providers) {
-            if (auto existingProvider = weakProvider.lock()) {
-                if (existingProvider == provider) {
-                    // Provider already registered for this topic
-                    return false;
-                }
+        return addProvider(topic, provider);
+    }
+    return false;
+}
+
+std::size_t MCPBroker::registerContexts(const std::vector<std::string>& topics,
+                                        std::shared_ptr<IMCPProvider_V1> provider) {
+    if (!provider) {
+        return 0;
+    }
+    
+    std::size_t registered = 0;
+    std::lock_guard<std::mutex> lock(m_registryMutex);
+    for (const auto& topic : topics) {
+        if (!topic.empty() && addProvider(topic, provider)) {
+            registered++;
+        }
+    }
+    return registered;
+}
+
+bool MCPBroker::addProvider(const std::string& topic,
+                            const std::shared_ptr<IMCPProvider_V1>& provider) {
+    // Check if the provider is already registered for this topic
+    auto& providers = m_topicRegistry[topic];
+    for (const auto& weakProvider : providers) {
+        if (auto existingProvider = weakProvider.lock()) {
+            if (existingProvider == provider) {
+                // Provider already registered for this topic
+                return false;
             }
         }
-        
-        // Add the provider to the topic
-        providers.push_back(provider);
-        return true;
     }
-    return false;
+    
+    // Add the provider to the topic
+    providers.push_back(provider);
+    return true;
+}
+
+bool MCPBroker::registerContext(const std::string& topic,
+                               std::shared_ptr<IMCPProvider_V1> provider,
+                               const TopicDescriptor& descriptor) {
+    if (!registerContext(topic, provider)) {
+        return false;
+    }
+    
+    bool declared = false;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        auto inserted = m_topicDescriptors.emplace(topic, descriptor);
+        declared = inserted.second || inserted.first->second == descriptor;
+        if (inserted.second) {
+            m_messageQueue.prepareTopic(topic);
+        }
+    }
+    if (!declared) {
+        unregisterContext(topic, provider);
+        return false;
+    }
+    
+    setTopicKind(topic, descriptor.kind);
+    return true;
+}
+
+bool MCPBroker::registerContext(const TopicLiteral& topic,
+                               std::shared_ptr<IMCPProvider_V1> provider) {
+    if (topic.size() == 0 || !provider || !claimTopicHash(topic)) {
+        return false;
+    }
+    return registerContext(topic.str(), provider);
+}
+
+bool MCPBroker::getTopicDescriptor(const std::string& topic, TopicDescriptor& descriptor) const {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    auto it = m_topicDescriptors.find(topic);
+    if (it == m_topicDescriptors.end()) {
+        return false;
+    }
+    descriptor = it->second;
+    return true;
 }
 
 bool MCPBroker::unregisterContext(const std::string& topic, 
@@ -135,25 +288,209 @@ bool MCPBroker::unregisterContext(const std::string& topic,
 
 bool MCPBroker::subscribe(const std::string& topic, 
                          std::shared_ptr<IMCPSubscriber_V1> subscriber) {
+    return subscribe(topic, subscriber, SubscriptionOptions());
+}
+
+bool MCPBroker::subscribe(const std::string& topic,
+                         std::shared_ptr<IMCPSubscriber_V1> subscriber,
+                         const SubscriptionOptions& options) {
     if (!topic.empty() && subscriber) {
         std::lock_guard<std::mutex> lock(m_subscriptionMutex);
-        
-        // Check if the subscriber is already subscribed to this topic
-        auto& subscribers = m_subscriptions[topic];
-        for (const auto& weakSubscriber : subscribers) {
-            if (auto existingSubscriber = weakSubscriber.lock()) {
-                if (existingSubscriber == subscriber) {
-                    // Subscriber already registered for this topic
-                    return false;
-                }
+        QueueUpdates updates;
+        bool added = addSubscription(topic, subscriber, options, updates);
+        applyQueueUpdates(updates);
+        return added;
+    }
+    return false;
+}
+
+std::size_t MCPBroker::subscribeMany(const std::vector<std::string>& topics,
+                                     std::shared_ptr<IMCPSubscriber_V1> subscriber,
+                                     const SubscriptionOptions& options) {
+    if (!subscriber) {
+        return 0;
+    }
+    
+    std::size_t subscribed = 0;
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    QueueUpdates updates;
+    for (const auto& topic : topics) {
+        if (!topic.empty() && addSubscription(topic, subscriber, options, updates)) {
+            subscribed++;
+        }
+    }
+    applyQueueUpdates(updates);
+    return subscribed;
+}
+
+bool MCPBroker::addSubscription(const std::string& topic,
+                                const std::shared_ptr<IMCPSubscriber_V1>& subscriber,
+                                const SubscriptionOptions& options,
+                                QueueUpdates& updates) {
+    // Check if the subscriber is already subscribed to this topic
+    auto& subscriptions = m_subscriptions[topic];
+    if (!m_topicHashes.empty() && subscriptions.empty()) {
+        auto hashIt = m_topicHashes.find(hashTopicName(topic));
+        if (hashIt != m_topicHashes.end() && hashIt->second == topic) {
+            m_subscriptionsByHash[hashIt->first] = &subscriptions;
+        }
+    }
+    for (const auto& subscription : subscriptions) {
+        if (auto existingSubscriber = subscription.subscriber.lock()) {
+            if (existingSubscriber == subscriber) {
+                // Subscriber already registered for this topic
+                return false;
+            }
+        }
+    }
+    
+    Subscription subscription;
+    subscription.subscriber = subscriber;
+    subscription.options = options;
+    subscription.deadline = effectiveDeadline(options);
+    subscription.strand = createStrand(options);
+    if (!options.group.empty()) {
+        subscription.load = std::make_shared<std::atomic<uint32_t>>(0);
+    }
+    if (options.credits) {
+        subscription.gate = std::make_shared<CreditGate>(
+            options.credits, options.creditPolicy, options.maxHeldMessages);
+        registerCreditWakeup(options.credits);
+    }
+    if (options.deadbandAbsolute > 0.0 || options.deadbandRelative > 0.0) {
+        subscription.deadband = std::make_shared<Deadband>();
+        subscription.deadband->absolute = options.deadbandAbsolute;
+        subscription.deadband->relative = options.deadbandRelative;
+    }
+    if (options.minInterval.count() > 0) {
+        subscription.rateLimit = std::make_shared<RateLimit>();
+        subscription.rateLimit->interval = options.minInterval;
+    }
+    if (auto batched = std::dynamic_pointer_cast<IMCPSubscriber_V2>(subscriber)) {
+        subscription.mailbox = std::make_shared<Mailbox>();
+        subscription.mailbox->subscriber = batched;
+        subscription.mailbox->queueKey = "@batch/" + std::to_string(m_nextMailboxId++);
+    }
+    std::shared_ptr<Strand> strand = subscription.strand;
+    
+    // Keep the list in fan-out order: latency class first, then earliest
+    // deadline; equal keys stay in registration order
+    auto position = std::upper_bound(subscriptions.begin(), subscriptions.end(), subscription,
+        [](const Subscription& a, const Subscription& b) {
+            if (a.options.latencyClass != b.options.latencyClass) {
+                return a.options.latencyClass < b.options.latencyClass;
+            }
+            return a.deadline < b.deadline;
+        });
+    subscriptions.insert(position, std::move(subscription));
+    
+    updates.deadlines.emplace_back(topic, topicDeadline(subscriptions));
+    
+    // Replay ahead of anything still queued on the topic; everything
+    // dispatched so far is in the snapshot and nothing later is
+    if (options.replayHistory) {
+        std::vector<std::shared_ptr<const MCPMessage_V1>> messages;
+        auto historyIt = m_histories.find(topic);
+        if (historyIt != m_histories.end()) {
+            messages = historyIt->second->read();
+        } else {
+            auto retainedIt = m_retainedState.find(topic);
+            if (retainedIt != m_retainedState.end() && retainedIt->second) {
+                messages.push_back(retainedIt->second);
             }
         }
         
-        // Add the subscriber to the topic
-        subscribers.push_back(subscriber);
-        return true;
+        std::weak_ptr<IMCPSubscriber_V1> weakSubscriber = subscriber;
+        std::shared_ptr<ErrorSink> errors = m_errorSink;
+        if (!messages.empty() && strand) {
+            // Every later live message is posted to the strand behind the replay
+            strand->post([weakSubscriber, messages, errors]() {
+                replayHistory(weakSubscriber, messages, *errors);
+            });
+        } else if (!messages.empty()) {
+            updates.replays.emplace_back(topic, [weakSubscriber, messages, errors]() {
+                replayHistory(weakSubscriber, messages, *errors);
+            });
+        }
+    }
+    return true;
+}
+
+void MCPBroker::applyQueueUpdates(QueueUpdates& updates) {
+    if (updates.deadlines.empty() && updates.replays.empty()) {
+        return;
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        for (const auto& deadline : updates.deadlines) {
+            m_messageQueue.setTopicDeadline(deadline.first, deadline.second);
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        for (auto& replay : updates.replays) {
+            m_messageQueue.pushTask(replay.first, std::move(replay.second), now, true);
+        }
+        if (!updates.replays.empty()) {
+            startWorkers(now);
+        }
+    }
+    if (!updates.replays.empty()) {
+        m_queueCondition.notify_one();
+    }
+}
+
+bool MCPBroker::subscribe(const TopicLiteral& topic,
+                         std::shared_ptr<IMCPSubscriber_V1> subscriber,
+                         const SubscriptionOptions& options) {
+    if (topic.size() == 0 || !subscriber || !claimTopicHash(topic)) {
+        return false;
+    }
+    return subscribe(topic.str(), subscriber, options);
+}
+
+bool MCPBroker::claimTopicHash(const TopicLiteral& topic) {
+    std::string name = topic.str();
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    auto inserted = m_topicHashes.emplace(topic.hash(), name);
+    if (!inserted.second) {
+        return inserted.first->second == name;
+    }
+    
+    // The dispatch queue outlives clearAllRegistries(), so it may still hold
+    // a colliding name from before
+    bool indexed = false;
+    {
+        std::lock_guard<std::mutex> queueLock(m_queueMutex);
+        indexed = m_messageQueue.indexTopicHash(name, topic.hash());
+    }
+    if (!indexed) {
+        m_topicHashes.erase(inserted.first);
+        return false;
+    }
+    
+    auto topicIt = m_subscriptions.find(name);
+    if (topicIt != m_subscriptions.end()) {
+        m_subscriptionsByHash[topic.hash()] = &topicIt->second;
+    }
+    return true;
+}
+
+std::vector<MCPBroker::Subscription>* MCPBroker::findSubscriptions(const MCPMessage_V1& message) {
+    if (message.topicHash != 0 && !m_subscriptionsByHash.empty()) {
+        auto it = m_subscriptionsByHash.find(message.topicHash);
+        if (it != m_subscriptionsByHash.end()) {
+            return it->second;
+        }
+    }
+    auto topicIt = m_subscriptions.find(message.topic);
+    return topicIt != m_subscriptions.end() ? &topicIt->second : nullptr;
+}
+
+void MCPBroker::unindexSubscriptions(const std::string& topic) {
+    if (!m_subscriptionsByHash.empty()) {
+        m_subscriptionsByHash.erase(hashTopicName(topic));
     }
-    return false;
 }
 
 bool MCPBroker::unsubscribe(const std::string& topic, 
@@ -164,21 +501,26 @@ bool MCPBroker::unsubscribe(const std::string& topic,
         // Find the topic in the subscriptions
         auto topicIt = m_subscriptions.find(topic);
         if (topicIt != m_subscriptions.end()) {
-            auto& subscribers = topicIt->second;
+            auto& subscriptions = topicIt->second;
             
-            // Find and remove the subscriber
-            auto it = std::remove_if(subscribers.begin(), subscribers.end(), 
-                [&subscriber](const std::weak_ptr<IMCPSubscriber_V1>& weakSubscriber) {
-                    auto existingSubscriber = weakSubscriber.lock();
-                    return !existingSubscriber || existingSubscriber == subscriber;
+            // Find the subscriber; stable_partition (unlike remove_if) keeps
+            // the removed subscriptions intact at the end for closing
+            auto it = std::stable_partition(subscriptions.begin(), subscriptions.end(), 
+                [&subscriber](const Subscription& subscription) {
+                    auto existingSubscriber = subscription.subscriber.lock();
+                    return existingSubscriber && existingSubscriber != subscriber;
                 });
             
-            if (it != subscribers.end()) {
-                subscribers.erase(it, subscribers.end());
+            if (it != subscriptions.end()) {
+                closeSubscriptions(it, subscriptions.end());
+                subscriptions.erase(it, subscriptions.end());
+                updateTopicDeadline(topic, subscriptions);
                 
                 // Remove the topic if no subscribers left
-                if (subscribers.empty()) {
+                if (subscriptions.empty()) {
+                    unindexSubscriptions(topic);
                     m_subscriptions.erase(topicIt);
+                    m_groupCursors.erase(topic);
                 }
                 
                 return true;
@@ -199,21 +541,26 @@ bool MCPBroker::unsubscribeAll(std::shared_ptr<IMCPSubscriber_V1> subscriber) {
     // Iterate through all topics
     auto topicIt = m_subscriptions.begin();
     while (topicIt != m_subscriptions.end()) {
-        auto& subscribers = topicIt->second;
+        auto& subscriptions = topicIt->second;
         
-        // Find and remove the subscriber from each topic
-        auto it = std::remove_if(subscribers.begin(), subscribers.end(),
-            [&subscriber](const std::weak_ptr<IMCPSubscriber_V1>& weakSubscriber) {
-                auto existingSubscriber = weakSubscriber.lock();
-                return !existingSubscriber || existingSubscriber == subscriber;
+        // Find the subscriber in each topic, keeping the removed
+        // subscriptions intact at the end for closing
+        auto it = std::stable_partition(subscriptions.begin(), subscriptions.end(),
+            [&subscriber](const Subscription& subscription) {
+                auto existingSubscriber = subscription.subscriber.lock();
+                return existingSubscriber && existingSubscriber != subscriber;
             });
         
-        if (it != subscribers.end()) {
+        if (it != subscriptions.end()) {
             unsubscribedAny = true;
-            subscribers.erase(it, subscribers.end());
+            closeSubscriptions(it, subscriptions.end());
+            subscriptions.erase(it, subscriptions.end());
+            updateTopicDeadline(topicIt->first, subscriptions);
             
             // Remove the topic if no subscribers left
-            if (subscribers.empty()) {
+            if (subscriptions.empty()) {
+                unindexSubscriptions(topicIt->first);
+                m_groupCursors.erase(topicIt->first);
                 topicIt = m_subscriptions.erase(topicIt);
                 continue;
             }
@@ -225,6 +572,306 @@ bool MCPBroker::unsubscribeAll(std::shared_ptr<IMCPSubscriber_V1> subscriber) {
     return unsubscribedAny;
 }
 
+std::shared_ptr<Strand> MCPBroker::createStrand(const SubscriptionOptions& options) {
+    switch (options.executor) {
+        case CallbackExecutor::SHARED_POOL: {
+            std::shared_ptr<WorkStealingPool> pool = options.pool;
+            if (!pool) {
+                if (!m_callbackPool) {
+                    m_callbackPool = std::make_shared<WorkStealingPool>();
+                }
+                pool = m_callbackPool;
+            }
+            return std::make_shared<Strand>(pool);
+        }
+        case CallbackExecutor::DEDICATED_THREAD:
+            return std::make_shared<Strand>(std::make_shared<WorkStealingPool>(1));
+        case CallbackExecutor::INLINE:
+        default:
+            return nullptr;
+    }
+}
+
+void MCPBroker::closeSubscriptions(std::vector<Subscription>::iterator first,
+                                   std::vector<Subscription>::iterator last) {
+    std::vector<std::string> mailboxKeys;
+    for (; first != last; ++first) {
+        if (first->strand) {
+            first->strand->close();
+        }
+        if (first->gate) {
+            first->gate->close();
+        }
+        if (first->rateLimit) {
+            first->rateLimit->closed = true;
+        }
+        if (first->mailbox) {
+            std::lock_guard<std::mutex> lock(first->mailbox->mutex);
+            first->mailbox->closed = true;
+            first->mailbox->pending.clear();
+            mailboxKeys.push_back(first->mailbox->queueKey);
+        }
+    }
+    
+    // A drain still queued runs against the closed mailbox, then its
+    // sub-queue goes
+    if (!mailboxKeys.empty()) {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        for (const auto& key : mailboxKeys) {
+            m_messageQueue.removeTopic(key);
+        }
+    }
+}
+
+void MCPBroker::selectGroupMembers(const std::string& topic,
+                                   const std::vector<Subscription>& subscriptions,
+                                   std::vector<bool>& skipped) {
+    bool grouped = std::any_of(subscriptions.begin(), subscriptions.end(),
+        [](const Subscription& subscription) { return !subscription.options.group.empty(); });
+    if (!grouped) {
+        return;
+    }
+    
+    // Live members of each group, in fan-out order; every member starts out skipped
+    skipped.assign(subscriptions.size(), false);
+    std::map<std::string, std::vector<std::size_t>> groups;
+    for (std::size_t i = 0; i < subscriptions.size(); ++i) {
+        const Subscription& subscription = subscriptions[i];
+        if (subscription.options.group.empty()) {
+            continue;
+        }
+        skipped[i] = true;
+        if (!subscription.subscriber.expired()) {
+            groups[subscription.options.group].push_back(i);
+        }
+    }
+    
+    auto& cursors = m_groupCursors[topic];
+    for (const auto& group : groups) {
+        const std::vector<std::size_t>& members = group.second;
+        std::size_t& cursor = cursors[group.first];
+        std::size_t start = cursor % members.size();
+        std::size_t chosen = start;
+        
+        // Least loaded wins; scanning from the cursor makes ties take turns
+        if (subscriptions[members.front()].options.balancing == GroupBalancing::LEAST_LOADED) {
+            uint32_t lowest = std::numeric_limits<uint32_t>::max();
+            for (std::size_t k = 0; k < members.size(); ++k) {
+                std::size_t candidate = (start + k) % members.size();
+                uint32_t load = subscriptions[members[candidate]].load->load(std::memory_order_relaxed);
+                if (load < lowest) {
+                    lowest = load;
+                    chosen = candidate;
+                }
+            }
+        }
+        
+        skipped[members[chosen]] = false;
+        cursor = chosen + 1;
+    }
+}
+
+std::shared_ptr<WorkStealingPool> MCPBroker::getCallbackPool() {
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    if (!m_callbackPool) {
+        m_callbackPool = std::make_shared<WorkStealingPool>();
+    }
+    return m_callbackPool;
+}
+
+void MCPBroker::reportError(const char* source, const char* code, ErrorSeverity severity,
+                            const char* message, const char* topic, const char* subscriber) noexcept {
+    m_errorSink->report(source, code, severity, message, topic, subscriber);
+}
+
+void MCPBroker::ErrorSink::report(const char* source, const char* code, ErrorSeverity severity,
+                                  const char* message, const char* topic, const char* subscriber) noexcept {
+    if (!collector.report(source, code, severity, message, topic, subscriber)) {
+        return;
+    }
+    
+    // Wake a sleeping worker for the first report of a round (never blocks,
+    // see wakeWorker()). Sequentially consistent with detach():
+    // either it sees this reporter waking or this sees the broker gone
+    waking.fetch_add(1);
+    if (MCPBroker* attached = broker.load()) {
+        attached->wakeWorker();
+    }
+    waking.fetch_sub(1);
+}
+
+void MCPBroker::ErrorSink::detach() noexcept {
+    broker.store(nullptr);
+    while (waking.load() != 0) {
+        std::this_thread::yield();
+    }
+}
+
+void MCPBroker::setErrorReportInterval(std::chrono::milliseconds interval) {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_errorReportInterval = interval;
+        m_nextErrorReport = std::chrono::steady_clock::now();
+    }
+    m_queueCondition.notify_all();
+}
+
+void MCPBroker::flushErrorReports(std::unique_lock<std::mutex>& lock) {
+    auto now = std::chrono::steady_clock::now();
+    if (now < m_nextErrorReport) {
+        return;
+    }
+    m_nextErrorReport = now + m_errorReportInterval;
+    
+    // publish() takes the queue lock itself
+    lock.unlock();
+    std::vector<ErrorReport> reports;
+    m_errorSink->collector.collect(reports);
+    
+    // Summaries nobody listens to are dropped rather than dispatched
+    bool listened = false;
+    if (!reports.empty()) {
+        std::lock_guard<std::mutex> subscriptionLock(m_subscriptionMutex);
+        auto it = m_subscriptions.find(ERROR_REPORTS_TOPIC.str());
+        listened = it != m_subscriptions.end() && !it->second.empty();
+    }
+    for (std::size_t i = 0; listened && i < reports.size(); ++i) {
+        try {
+            publish(serialization::createMsgPackMessage(ERROR_REPORTS_TOPIC, 0, reports[i]));
+        } catch (const MCPSerializationError& e) {
+            // Nothing sensible left to report to
+        }
+    }
+    lock.lock();
+}
+
+MCPBroker::CachedPayload MCPBroker::cachePayload(const MCPMessage_V1& message, uint64_t hash) {
+    // Payloads are compared with the cache's own copy, so a publisher's
+    // buffer may be freed or reused in place (e.g. by a PreparedPublication)
+    CachedPayload cached;
+    {
+        std::lock_guard<std::mutex> lock(m_contentCacheMutex);
+        cached.blob = m_contentCache.find(hash, message.data.get(), message.dataSize);
+        if (cached.blob || message.dataSize > m_contentCache.getCapacity()) {
+            cached.seen = cached.blob != nullptr;
+            return cached;
+        }
+    }
+    
+    // First sighting: copied without a lock, and kept to recognize the
+    // content by while the publisher's buffer is dispatched
+    std::shared_ptr<void> blob = ContentCache::copy(message.data.get(), message.dataSize);
+    std::lock_guard<std::mutex> lock(m_contentCacheMutex);
+    cached.blob = m_contentCache.insert(hash, std::move(blob), message.dataSize);
+    return cached;
+}
+
+bool MCPBroker::deduplicatePayload(std::shared_ptr<MCPMessage_V1>& message, const CachedPayload& cached) {
+    const std::shared_ptr<void>& blob = cached.blob;
+    auto lastIt = m_lastPayloads.find(message->topic);
+    
+    if (cached.seen && lastIt != m_lastPayloads.end() && lastIt->second.lock() == blob) {
+        auto kindIt = m_topicKinds.find(message->topic);
+        if (kindIt != m_topicKinds.end() && kindIt->second == TopicKind::STATE) {
+            m_dedupStats.suppressed++;
+            return false;
+        }
+    }
+    
+    if (cached.seen && blob != message->data) {
+        // The publisher's message is left untouched; only the copy is queued
+        auto shared = std::make_shared<MCPMessage_V1>(*message);
+        shared->data = blob;
+        message = shared;
+        m_dedupStats.shared++;
+    }
+    
+    if (lastIt != m_lastPayloads.end()) {
+        lastIt->second = blob;
+        return true;
+    }
+    
+    // Topics whose blob left the cache have nothing left to compare with
+    if (m_lastPayloads.size() >= m_lastPayloadLimit) {
+        for (auto it = m_lastPayloads.begin(); it != m_lastPayloads.end();) {
+            it = it->second.expired() ? m_lastPayloads.erase(it) : std::next(it);
+        }
+        m_lastPayloadLimit = std::max(MIN_LAST_PAYLOAD_LIMIT, 2 * m_lastPayloads.size());
+    }
+    m_lastPayloads.emplace(message->topic, blob);
+    return true;
+}
+
+void MCPBroker::setContentDedup(const ContentDedupConfig& config) {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_dedupConfig = config;
+    m_dedupMinSize.store(config.minPayloadSize, std::memory_order_relaxed);
+    m_lastPayloads.clear();
+    
+    std::lock_guard<std::mutex> cacheLock(m_contentCacheMutex);
+    m_contentCache.clear();
+    m_contentCache.setCapacity(config.cacheCapacity);
+}
+
+ContentDedupStats MCPBroker::getContentDedupStats() const {
+    ContentDedupStats stats;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        stats = m_dedupStats;
+    }
+    std::lock_guard<std::mutex> cacheLock(m_contentCacheMutex);
+    stats.cachedPayloads = m_contentCache.getEntryCount();
+    stats.cachedBytes = m_contentCache.getSize();
+    return stats;
+}
+
+void MCPBroker::setParallelFanout(std::size_t minSubscribers) {
+    m_parallelFanout.store(minSubscribers, std::memory_order_relaxed);
+}
+
+std::size_t MCPBroker::getParallelFanout() const {
+    return m_parallelFanout.load(std::memory_order_relaxed);
+}
+
+std::chrono::microseconds MCPBroker::effectiveDeadline(const SubscriptionOptions& options) {
+    if (options.deadline.count() > 0) {
+        return options.deadline;
+    }
+    
+    switch (options.latencyClass) {
+        case LatencyClass::REALTIME:
+            return std::chrono::microseconds(1000);
+        case LatencyClass::INTERACTIVE:
+            return std::chrono::microseconds(16000);
+        case LatencyClass::NORMAL:
+            return std::chrono::microseconds(50000);
+        case LatencyClass::BACKGROUND:
+        default:
+            return std::chrono::microseconds(250000);
+    }
+}
+
+void MCPBroker::updateTopicDeadline(const std::string& topic,
+                                    const std::vector<Subscription>& subscriptions) {
+    std::chrono::microseconds deadline = topicDeadline(subscriptions);
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_messageQueue.setTopicDeadline(topic, deadline);
+}
+
+std::chrono::microseconds MCPBroker::topicDeadline(const std::vector<Subscription>& subscriptions) {
+    // The topic's messages must be dispatched in time for its tightest
+    // subscriber, so a topic only background subscribers listen to yields to
+    // NORMAL ones; topics without subscribers keep the default
+    if (subscriptions.empty()) {
+        return effectiveDeadline(SubscriptionOptions());
+    }
+    std::chrono::microseconds deadline = std::chrono::microseconds::max();
+    for (const auto& subscription : subscriptions) {
+        deadline = std::min(deadline, subscription.deadline);
+    }
+    return deadline;
+}
+
 std::vector<std::string> MCPBroker::getAvailableTopics() const {
     std::lock_guard<std::mutex> lock(m_registryMutex);
     std::vector<std::string> topics;
@@ -293,108 +940,1558 @@ bool MCPBroker::publish(std::shared_ptr<MCPMessage_V1> message) {
         return false;
     }
     
-    // Queue the message for processing by the worker thread
+    // Hash, look up and copy large payloads before taking the queue lock
+    std::size_t dedupMinSize = m_dedupMinSize.load(std::memory_order_relaxed);
+    bool deduplicate = dedupMinSize > 0 && message->dataSize >= dedupMinSize;
+    CachedPayload cachedPayload;
+    if (deduplicate) {
+        cachedPayload = cachePayload(*message, ContentCache::hash(message->data.get(), message->dataSize));
+    }
+    
+    // Queue the message for processing by the worker threads
+    std::vector<ConflationEvent> conflationEvents;
     {
         std::lock_guard<std::mutex> lock(m_queueMutex);
         
-        // Only queue the message if the worker thread is running
+        // Only queue the message if the worker threads are running
         if (!m_threadRunning) {
             return false;
         }
         
-        m_messageQueue.push(message);
+        // Reject messages that do not match the topic's declaration
+        if (!m_topicDescriptors.empty()) {
+            auto it = m_topicDescriptors.find(message->topic);
+            if (it != m_topicDescriptors.end() && !matchesDescriptor(*message, it->second)) {
+                return false;
+            }
+        }
+        
+        // An unchanged STATE payload is dropped; known content travels as
+        // a reference to the cached blob
+        if (deduplicate && m_dedupConfig.minPayloadSize > 0 && !deduplicatePayload(message, cachedPayload)) {
+            return true;
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        m_messageQueue.push(message, now);
+        startWorkers(now);
+        evaluateConflation(now, conflationEvents);
+        
+        // Workers may all be busy in long callbacks, so check for backlog here too
+        maybeScaleUp(now);
     }
     
-    // Notify the worker thread that there's a new message
+    // Notify a worker thread that there's a new message
     m_queueCondition.notify_one();
     
+    reportConflation(conflationEvents);
     return true;
 }
 
-void MCPBroker::processMessageQueue() {
-    while (true) {
-        std::shared_ptr<MCPMessage_V1> message;
+bool MCPBroker::registerRequestHandler(const std::string& topic,
+                                       std::shared_ptr<IMCPRequestHandler_V1> handler) {
+    if (topic.empty() || !handler) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    auto it = m_requestHandlers.find(topic);
+    if (it != m_requestHandlers.end() && !it->second.expired()) {
+        return false;
+    }
+    m_requestHandlers[topic] = handler;
+    return true;
+}
+
+bool MCPBroker::unregisterRequestHandler(const std::string& topic,
+                                         std::shared_ptr<IMCPRequestHandler_V1> handler) {
+    std::lock_guard<std::mutex> lock(m_requestMutex);
+    auto it = m_requestHandlers.find(topic);
+    if (it == m_requestHandlers.end() || it->second.lock() != handler) {
+        return false;
+    }
+    m_requestHandlers.erase(it);
+    return true;
+}
+
+bool MCPBroker::request(std::shared_ptr<MCPMessage_V1> request,
+                        std::function<void(const Reply&)> callback,
+                        std::chrono::milliseconds timeout) {
+    if (!request || request->topic.empty() || !callback) {
+        return false;
+    }
+    
+    std::weak_ptr<IMCPRequestHandler_V1> handler;
+    uint64_t correlationId = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        auto it = m_requestHandlers.find(request->topic);
+        if (it == m_requestHandlers.end() || it->second.expired()) {
+            return false;
+        }
+        handler = it->second;
+        correlationId = m_nextCorrelationId++;
+        m_pendingRequests[correlationId] = std::move(callback);
+    }
+    request->correlationId = correlationId;
+    
+    // The handler runs in the topic's order like a published message would
+    auto task = [this, handler, request, correlationId]() {
+        Reply reply;
+        auto target = handler.lock();
+        if (!target) {
+            reply.status = ReplyStatus::NO_HANDLER;
+            completeRequest(correlationId, reply);
+            return;
+        }
+        
+        try {
+            reply.message = target->onMCPRequest(request.get());
+        } catch (const std::exception& e) {
+            reportError(request->topic.c_str(), ErrorCode::HANDLER_FAILED, ErrorSeverity::WARNING,
+                        e.what(), request->topic.c_str());
+            reply.status = ReplyStatus::FAILED;
+            completeRequest(correlationId, reply);
+            return;
+        }
+        
+        // No reply yet: the handler answers later through reply()
+        if (reply.message) {
+            reply.message->correlationId = correlationId;
+            reply.status = ReplyStatus::OK;
+            completeRequest(correlationId, reply);
+        }
+    };
+    
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (m_threadRunning) {
+            auto now = std::chrono::steady_clock::now();
+            m_messageQueue.pushTask(request->topic, std::move(task), now);
+            startWorkers(now);
+            maybeScaleUp(now);
+            queued = true;
+        }
+    }
+    if (!queued) {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_pendingRequests.erase(correlationId);
+        return false;
+    }
+    m_queueCondition.notify_one();
+    
+    scheduleTask(REQUEST_TIMEOUT_KEY, std::chrono::steady_clock::now() + timeout, [this, correlationId]() {
+        Reply reply;
+        reply.status = ReplyStatus::TIMEOUT;
+        completeRequest(correlationId, reply);
+    });
+    return true;
+}
+
+std::future<Reply> MCPBroker::request(std::shared_ptr<MCPMessage_V1> request,
+                                      std::chrono::milliseconds timeout) {
+    auto promise = std::make_shared<std::promise<Reply>>();
+    std::future<Reply> future = promise->get_future();
+    
+    bool sent = this->request(request, [promise](const Reply& reply) {
+        promise->set_value(reply);
+    }, timeout);
+    
+    if (!sent) {
+        Reply reply;
+        reply.status = ReplyStatus::NO_HANDLER;
+        promise->set_value(reply);
+    }
+    return future;
+}
+
+bool MCPBroker::reply(std::shared_ptr<MCPMessage_V1> reply) {
+    if (!reply || reply->correlationId == 0) {
+        return false;
+    }
+    
+    Reply answer;
+    answer.status = ReplyStatus::OK;
+    answer.message = reply;
+    return completeRequest(reply->correlationId, answer);
+}
+
+bool MCPBroker::completeRequest(uint64_t correlationId, const Reply& reply) {
+    std::function<void(const Reply&)> callback;
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        auto it = m_pendingRequests.find(correlationId);
+        if (it == m_pendingRequests.end()) {
+            return false;
+        }
+        callback = std::move(it->second);
+        m_pendingRequests.erase(it);
+    }
+    
+    try {
+        callback(reply);
+    } catch (const std::exception& e) {
+        // A failing callback must not take down the worker
+        const char* topic = reply.message ? reply.message->topic.c_str() : nullptr;
+        reportError(topic ? topic : "mcp.broker", ErrorCode::HANDLER_FAILED, ErrorSeverity::WARNING,
+                    e.what(), topic);
+    }
+    return true;
+}
+
+void MCPBroker::cancelPendingRequests() {
+    std::unordered_map<uint64_t, std::function<void(const Reply&)>> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        pending.swap(m_pendingRequests);
+    }
+    
+    Reply reply;
+    reply.status = ReplyStatus::CANCELLED;
+    for (auto& request : pending) {
+        try {
+            request.second(reply);
+        } catch (const std::exception& e) {
+            // Keep cancelling the others
+            reportError("mcp.broker", ErrorCode::HANDLER_FAILED, ErrorSeverity::WARNING, e.what());
+        }
+    }
+}
+
+bool MCPBroker::registerEndpoint(int moduleId, std::shared_ptr<IMCPSubscriber_V1> subscriber) {
+    if (!subscriber) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_endpointMutex);
+    auto it = m_endpoints.find(moduleId);
+    if (it != m_endpoints.end() && !it->second.subscriber.expired()) {
+        return false;
+    }
+    
+    Endpoint& endpoint = m_endpoints[moduleId];
+    endpoint.subscriber = subscriber;
+    endpoint.queueKey = "@module/" + std::to_string(moduleId);
+    return true;
+}
+
+bool MCPBroker::unregisterEndpoint(int moduleId) {
+    std::string queueKey;
+    {
+        std::lock_guard<std::mutex> lock(m_endpointMutex);
+        auto it = m_endpoints.find(moduleId);
+        if (it == m_endpoints.end()) {
+            return false;
+        }
+        queueKey = it->second.queueKey;
+        m_endpoints.erase(it);
+    }
+    
+    // Messages already sent still run; the sub-queue goes once they have
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_messageQueue.removeTopic(queueKey);
+    return true;
+}
+
+bool MCPBroker::sendTo(int moduleId, std::shared_ptr<MCPMessage_V1> message) {
+    // Validate the message like publish() does
+    if (!message || message->topic.empty() || !message->data) {
+        return false;
+    }
+    
+    std::weak_ptr<IMCPSubscriber_V1> target;
+    std::string queueKey;
+    {
+        std::lock_guard<std::mutex> lock(m_endpointMutex);
+        auto it = m_endpoints.find(moduleId);
+        if (it == m_endpoints.end()) {
+            return false;
+        }
+        queueKey = it->second.queueKey;
+        target = it->second.subscriber;
+        if (target.expired()) {
+            m_endpoints.erase(it);
+        }
+    }
+    
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (target.expired()) {
+            m_messageQueue.removeTopic(queueKey);
+            return false;
+        }
+        if (!m_threadRunning) {
+            return false;
+        }
+        
+        auto now = std::chrono::steady_clock::now();
+        m_messageQueue.pushTask(queueKey, [this, target, message]() {
+            if (auto subscriber = target.lock()) {
+                try {
+                    subscriber->onMCPMessage(message.get());
+                } catch (const std::exception& e) {
+                    // A failing target must not take down the worker
+                    m_errorSink->report(message->topic.c_str(), ErrorCode::SUBSCRIBER_FAILED, ErrorSeverity::WARNING,
+                                        e.what(), message->topic.c_str(), subscriberName(*subscriber));
+                }
+            }
+        }, now);
+        startWorkers(now);
+        maybeScaleUp(now);
+    }
+    
+    m_queueCondition.notify_one();
+    return true;
+}
+
+void MCPBroker::processMessageQueue(Worker* self) {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    
+    while (true) {
+        // Take the next message from a topic no other worker is dispatching
+        if (dispatchNext(lock)) {
+            continue;
+        }
+        
+        // Check if we should exit
+        if (!m_threadRunning) {
+            break;
+        }
+        
+        auto hasWork = [this] {
+            return m_messageQueue.readyCount() > 0 || m_creditsGranted.load() || !m_threadRunning;
+        };
+        
+        if (m_activeWorkers > m_poolConfig.minWorkers) {
+            // Surplus worker - retire after staying idle for the configured period
+            if (!m_queueCondition.wait_for(lock, m_poolConfig.idleRetireTime, hasWork) &&
+                m_activeWorkers > m_poolConfig.minWorkers) {
+                m_poolStats.workersRetired++;
+                break;
+            }
+        } else if (!hasWork()) {
+            // Core worker - wait without a predicate so a config change can
+            // turn it into a surplus worker on the next iteration; core
+            // workers also wake up for the earliest scheduled task
+            auto now = std::chrono::steady_clock::now();
+            auto wakeUp = now + MAX_IDLE_WAIT;
+            if (!m_scheduledTasks.empty()) {
+                wakeUp = std::min(wakeUp, m_scheduledTasks.top().due);
+            }
+            if (!m_creditWaiters.empty()) {
+                // Bounds the wait on a grant whose wakeup lost the race (see wakeWorker())
+                wakeUp = std::min(wakeUp, now + LOST_WAKEUP_BOUND);
+            }
+            if (m_errorSink->collector.pending()) {
+                wakeUp = std::min(wakeUp, m_nextErrorReport);
+            } else {
+                // A first report whose wakeup lost the race waits at most one round
+                wakeUp = std::min(wakeUp, now + std::min<std::chrono::steady_clock::duration>(
+                                                    m_errorReportInterval, MAX_IDLE_WAIT));
+            }
+            m_queueCondition.wait_until(lock, wakeUp);
+        }
+    }
+    
+    m_activeWorkers--;
+    self->finished = true;
+    if (m_threadRunning) {
+        recordPoolSize(std::chrono::steady_clock::now());
+    }
+}
+
+bool MCPBroker::dispatchNext(std::unique_lock<std::mutex>& lock) {
+    if (m_errorSink->collector.pending()) {
+        flushErrorReports(lock);
+    }
+    if (m_creditsGranted.load()) {
+        releaseCreditWaiters(std::chrono::steady_clock::now());
+    }
+    if (!m_scheduledTasks.empty()) {
+        moveDueTasks(std::chrono::steady_clock::now());
+    }
+    
+    DispatchEntry entry;
+    DispatchQueue::TopicQueue* topicQueue = nullptr;
+    if (!m_messageQueue.tryPop(entry, topicQueue)) {
+        return false;
+    }
+    
+    maybeScaleUp(std::chrono::steady_clock::now());
+    lock.unlock();
+    
+    try {
+        if (entry.task) {
+            entry.task();
+        } else {
+            deliverMessage(entry.message, entry.enqueueTime);
+        }
+    } catch (const std::exception& e) {
+        // Report and continue processing
+        const char* topic = entry.message ? entry.message->topic.c_str() : "mcp.broker";
+        reportError(topic, ErrorCode::DISPATCH_FAILED, ErrorSeverity::CRITICAL, e.what(),
+                    entry.message ? topic : nullptr);
+    }
+    
+    // Release the message before re-taking the lock
+    entry.message.reset();
+    entry.task = nullptr;
+    
+    lock.lock();
+    m_messageQueue.complete(topicQueue);
+    
+    std::vector<ConflationEvent> conflationEvents;
+    evaluateConflation(std::chrono::steady_clock::now(), conflationEvents);
+    if (!conflationEvents.empty()) {
+        lock.unlock();
+        reportConflation(conflationEvents);
+        lock.lock();
+    }
+    return true;
+}
+
+std::size_t MCPBroker::pump(std::size_t maxMessages) {
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    std::size_t dispatched = 0;
+    while ((maxMessages == 0 || dispatched < maxMessages) && dispatchNext(lock)) {
+        ++dispatched;
+    }
+    return dispatched;
+}
+
+std::size_t MCPBroker::pump(std::chrono::microseconds timeBudget) {
+    auto deadline = std::chrono::steady_clock::now() + timeBudget;
+    
+    std::unique_lock<std::mutex> lock(m_queueMutex);
+    std::size_t dispatched = 0;
+    while (std::chrono::steady_clock::now() < deadline && dispatchNext(lock)) {
+        ++dispatched;
+    }
+    return dispatched;
+}
+
+bool MCPBroker::scheduleTask(const std::string& topic, std::chrono::steady_clock::time_point due,
+                             std::function<void()> task) {
+    bool earliest = false;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (!m_threadRunning) {
+            return false;
+        }
+        
+        earliest = m_scheduledTasks.empty() || due < m_scheduledTasks.top().due;
+        m_scheduledTasks.push(ScheduledTask{due, m_nextScheduledSequence++, topic, std::move(task)});
+        startWorkers(std::chrono::steady_clock::now());
+    }
+    
+    // Idle core workers sleep until the previous earliest due time
+    if (earliest) {
+        m_queueCondition.notify_all();
+    }
+    return true;
+}
+
+void MCPBroker::moveDueTasks(std::chrono::steady_clock::time_point now) {
+    while (!m_scheduledTasks.empty() && m_scheduledTasks.top().due <= now) {
+        // priority_queue::top() is const, so the task has to be copied out
+        ScheduledTask scheduled = m_scheduledTasks.top();
+        m_scheduledTasks.pop();
+        m_messageQueue.pushTask(scheduled.topic, std::move(scheduled.task), now);
+    }
+}
+
+void MCPBroker::startWorkers(std::chrono::steady_clock::time_point now) {
+    if (m_workersStarted || !m_threadRunning || m_dispatchMode == DispatchMode::MANUAL_PUMP) {
+        return;
+    }
+    m_workersStarted = true;
+    while (m_activeWorkers < m_poolConfig.minWorkers) {
+        spawnWorker(now);
+    }
+}
+
+void MCPBroker::maybeScaleUp(std::chrono::steady_clock::time_point now) {
+    if (!m_threadRunning || m_dispatchMode == DispatchMode::MANUAL_PUMP ||
+        m_activeWorkers >= m_poolConfig.maxWorkers) {
+        return;
+    }
+    
+    // Only spawn if there is work another worker could actually take
+    if (m_messageQueue.readyCount() == 0) {
+        return;
+    }
+    
+    bool queueDeep = m_messageQueue.size() >= m_poolConfig.scaleUpQueueDepth;
+    bool messageOld = m_messageQueue.oldestReadyAge(now) >= m_poolConfig.scaleUpMessageAge;
+    if (!queueDeep && !messageOld) {
+        return;
+    }
+    
+    // Hysteresis - at most one spawn per cooldown period
+    if (now - m_lastSpawn < m_poolConfig.scaleUpCooldown) {
+        return;
+    }
+    
+    spawnWorker(now);
+}
+
+void MCPBroker::spawnWorker(std::chrono::steady_clock::time_point now) {
+    // Reap workers that have retired since the last spawn
+    auto it = m_workers.begin();
+    while (it != m_workers.end()) {
+        if ((*it)->finished) {
+            if ((*it)->thread.joinable()) {
+                (*it)->thread.join();
+            }
+            it = m_workers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    
+    std::unique_ptr<Worker> worker(new Worker());
+    Worker* self = worker.get();
+    worker->thread = std::thread(&MCPBroker::processMessageQueue, this, self);
+    m_workers.push_back(std::move(worker));
+    
+    m_activeWorkers++;
+    m_poolStats.workersSpawned++;
+    m_lastSpawn = now;
+    recordPoolSize(now);
+}
+
+void MCPBroker::recordPoolSize(std::chrono::steady_clock::time_point now) {
+    m_poolStats.peakWorkers = std::max(m_poolStats.peakWorkers, m_activeWorkers);
+    
+    m_poolHistory.push_back(WorkerPoolSample{now, m_activeWorkers});
+    if (m_poolHistory.size() > MAX_POOL_HISTORY) {
+        m_poolHistory.pop_front();
+    }
+}
+
+void MCPBroker::setWorkerPoolConfig(const WorkerPoolConfig& config) {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        
+        m_poolConfig = config;
+        m_poolConfig.minWorkers = std::max<std::size_t>(1, m_poolConfig.minWorkers);
+        m_poolConfig.maxWorkers = std::max(m_poolConfig.minWorkers, m_poolConfig.maxWorkers);
+        
+        // Start any missing core workers right away
+        auto now = std::chrono::steady_clock::now();
+        startWorkers(now);
+        while (m_workersStarted && m_threadRunning && m_activeWorkers < m_poolConfig.minWorkers) {
+            spawnWorker(now);
+        }
+    }
+    
+    // Let idle workers re-evaluate whether they are now surplus
+    m_queueCondition.notify_all();
+}
+
+void MCPBroker::evaluateConflation(std::chrono::steady_clock::time_point now,
+                                   std::vector<ConflationEvent>& events) {
+    if (!m_conflationConfig.enabled || now - m_lastLoadSample < m_conflationConfig.sampleWindow) {
+        return;
+    }
+    
+    double windowSeconds = std::chrono::duration<double>(now - m_lastLoadSample).count();
+    m_lastLoadSample = now;
+    
+    for (const auto& load : m_messageQueue.sampleLoad()) {
+        auto kindIt = m_topicKinds.find(load.topic);
+        if (kindIt == m_topicKinds.end() || kindIt->second != TopicKind::STATE) {
+            continue;
+        }
+        
+        bool switchOn = false;
+        bool switchOff = false;
+        if (!load.coalescing) {
+            // Overloaded: publishing outpaces dispatch and the backlog keeps growing
+            switchOn = load.backlog >= m_conflationConfig.backlogThreshold &&
+                       load.produced > load.consumed * m_conflationConfig.overloadRatio;
+        } else {
+            // Recovered: every value was dispatched before the next one arrived
+            switchOff = load.coalesced == 0 && load.backlog == 0;
+        }
+        
+        if (!switchOn && !switchOff) {
+            continue;
+        }
+        
+        m_messageQueue.setCoalescing(load.topic, switchOn);
+        if (switchOn) {
+            m_conflatingTopics.insert(load.topic);
+        } else {
+            m_conflatingTopics.erase(load.topic);
+        }
+        m_conflationSwitches++;
+        
+        ConflationEvent event;
+        event.topic = load.topic;
+        event.conflating = switchOn;
+        event.produceRate = load.produced / windowSeconds;
+        event.consumeRate = load.consumed / windowSeconds;
+        event.backlog = load.backlog;
+        events.push_back(std::move(event));
+    }
+}
+
+void MCPBroker::reportConflation(const std::vector<ConflationEvent>& events) {
+    if (events.empty()) {
+        return;
+    }
+    
+    std::function<void(const ConflationEvent&)> listener;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        listener = m_conflationListener;
+    }
+    
+    if (listener) {
+        for (const auto& event : events) {
+            try {
+                listener(event);
+            } catch (const std::exception& e) {
+                // A faulty listener must not take down the publisher or the worker
+                reportError("mcp.broker", ErrorCode::HANDLER_FAILED, ErrorSeverity::WARNING,
+                            e.what(), event.topic.c_str());
+            }
+        }
+    }
+}
+
+void MCPBroker::setSchedulingPolicy(SchedulingPolicy policy) {
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_messageQueue.setSchedulingPolicy(policy);
+    }
+    m_queueCondition.notify_all();
+}
+
+SchedulingPolicy MCPBroker::getSchedulingPolicy() const {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_messageQueue.getSchedulingPolicy();
+}
+
+void MCPBroker::setTopicWeight(const std::string& topic, uint32_t weight) {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_messageQueue.setTopicWeight(topic, weight);
+}
+
+void MCPBroker::setTopicKind(const std::string& topic, TopicKind kind) {
+    {
+        std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+        if (kind == TopicKind::STATE) {
+            m_retainedState.emplace(topic, nullptr);
+        } else {
+            m_retainedState.erase(topic);
+        }
+    }
+    
+    std::vector<ConflationEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_topicKinds[topic] = kind;
+        
+        // An EVENT topic must never stay coalesced
+        if (kind == TopicKind::EVENT && m_conflatingTopics.erase(topic) > 0) {
+            m_messageQueue.setCoalescing(topic, false);
+            m_conflationSwitches++;
+            
+            ConflationEvent event;
+            event.topic = topic;
+            events.push_back(std::move(event));
+        }
+    }
+    reportConflation(events);
+}
+
+TopicKind MCPBroker::getTopicKind(const std::string& topic) const {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    auto it = m_topicKinds.find(topic);
+    return it != m_topicKinds.end() ? it->second : TopicKind::EVENT;
+}
+
+void MCPBroker::setAdaptiveConflation(const AdaptiveConflationConfig& config) {
+    std::vector<ConflationEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_conflationConfig = config;
+        m_lastLoadSample = std::chrono::steady_clock::now();
+        
+        // Start a fresh window so stale counters don't trigger a switch
+        m_messageQueue.sampleLoad();
+        
+        if (!config.enabled) {
+            for (const auto& topic : m_conflatingTopics) {
+                m_messageQueue.setCoalescing(topic, false);
+                m_conflationSwitches++;
+                
+                ConflationEvent event;
+                event.topic = topic;
+                events.push_back(std::move(event));
+            }
+            m_conflatingTopics.clear();
+        }
+    }
+    reportConflation(events);
+}
+
+void MCPBroker::setConflationListener(std::function<void(const ConflationEvent&)> listener) {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    m_conflationListener = std::move(listener);
+}
+
+bool MCPBroker::isTopicConflating(const std::string& topic) const {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_conflatingTopics.count(topic) > 0;
+}
+
+uint64_t MCPBroker::getConflationSwitchCount() const {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_conflationSwitches;
+}
+
+WorkerPoolConfig MCPBroker::getWorkerPoolConfig() const {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_poolConfig;
+}
+
+WorkerPoolStats MCPBroker::getWorkerPoolStats() const {
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    
+    WorkerPoolStats stats = m_poolStats;
+    stats.currentWorkers = m_activeWorkers;
+    stats.history.assign(m_poolHistory.begin(), m_poolHistory.end());
+    return stats;
+}
+
+void MCPBroker::enableHistory(const std::string& topic, const HistoryConfig& config) {
+    if (topic.empty()) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    m_histories[topic] = std::make_shared<TopicHistory>(config);
+}
+
+bool MCPBroker::disableHistory(const std::string& topic) {
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    return m_histories.erase(topic) > 0;
+}
+
+std::shared_ptr<const TopicHistory> MCPBroker::getTopicHistory(const std::string& topic) const {
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    auto it = m_histories.find(topic);
+    return it != m_histories.end() ? it->second : nullptr;
+}
+
+std::vector<std::shared_ptr<const MCPMessage_V1>> MCPBroker::getHistory(
+    const std::string& topic, std::size_t maxMessages) const {
+    auto history = getTopicHistory(topic);
+    if (!history) {
+        return std::vector<std::shared_ptr<const MCPMessage_V1>>();
+    }
+    return history->read(maxMessages);
+}
+
+std::shared_ptr<const MCPMessage_V1> MCPBroker::getRetainedValue(const std::string& topic) const {
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    auto it = m_retainedState.find(topic);
+    return it != m_retainedState.end() ? it->second : nullptr;
+}
+
+bool MCPBroker::saveSnapshot(const std::string& path) const {
+    std::vector<std::shared_ptr<const MCPMessage_V1>> values;
+    {
+        std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+        for (const auto& retained : m_retainedState) {
+            if (retained.second) {
+                values.push_back(retained.second);
+            }
+        }
+    }
+    return Snapshot::write(path, values);
+}
+
+void MCPBroker::saveShutdownSnapshot() const {
+    std::string path;
+    std::vector<std::shared_ptr<const MCPMessage_V1>> values;
+    {
+        std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+        if (m_snapshotPath.empty()) {
+            return;
+        }
+        path = m_snapshotPath;
+        for (const auto& retained : m_retainedState) {
+            if (retained.second) {
+                values.push_back(retained.second);
+            }
+        }
+    }
+    
+    if (!values.empty()) {
+        Snapshot::write(path, values);
+    }
+}
+
+bool MCPBroker::loadSnapshot(const std::string& path) {
+    std::vector<std::shared_ptr<MCPMessage_V1>> values;
+    if (!Snapshot::read(path, values)) {
+        return false;
+    }
+    
+    for (const auto& value : values) {
+        setTopicKind(value->topic, TopicKind::STATE);
+    }
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    for (const auto& value : values) {
+        m_retainedState[value->topic] = value;
+    }
+    return true;
+}
+
+bool MCPBroker::enableSnapshot(const std::string& path) {
+    {
+        std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+        m_snapshotPath = path;
+    }
+    return loadSnapshot(path);
+}
+
+bool MCPBroker::defineDerivedTopic(const DerivedTopicSpec& spec) {
+    if (spec.topic.empty() || spec.sourceTopic.empty() || spec.operators.empty()) {
+        return false;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    if (m_derivedTopics.count(spec.topic) > 0) {
+        return false;
+    }
+    
+    // Walk up the source chain; reaching the new topic would close a cycle
+    std::string source = spec.sourceTopic;
+    while (true) {
+        if (source == spec.topic) {
+            return false;
+        }
+        auto it = m_derivedTopics.find(source);
+        if (it == m_derivedTopics.end()) {
+            break;
+        }
+        source = it->second->getSpec().sourceTopic;
+    }
+    
+    auto derivedTopic = std::make_shared<DerivedTopic>(spec);
+    m_derivedTopics[spec.topic] = derivedTopic;
+    m_derivedBySource[spec.sourceTopic].push_back(derivedTopic);
+    return true;
+}
+
+bool MCPBroker::removeDerivedTopic(const std::string& topic) {
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    auto it = m_derivedTopics.find(topic);
+    if (it == m_derivedTopics.end()) {
+        return false;
+    }
+    
+    auto sourceIt = m_derivedBySource.find(it->second->getSpec().sourceTopic);
+    if (sourceIt != m_derivedBySource.end()) {
+        auto& derivedTopics = sourceIt->second;
+        derivedTopics.erase(std::remove(derivedTopics.begin(), derivedTopics.end(), it->second),
+                            derivedTopics.end());
+        if (derivedTopics.empty()) {
+            m_derivedBySource.erase(sourceIt);
+        }
+    }
+    
+    m_derivedTopics.erase(it);
+    return true;
+}
+
+std::vector<std::string> MCPBroker::getDerivedTopics() const {
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    std::vector<std::string> topics;
+    for (const auto& entry : m_derivedTopics) {
+        topics.push_back(entry.first);
+    }
+    return topics;
+}
+
+void MCPBroker::runDerivedTopics(const std::vector<std::shared_ptr<DerivedTopic>>& derivedTopics,
+                                 const std::shared_ptr<MCPMessage_V1>& message) {
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& derivedTopic : derivedTopics) {
+        std::vector<DerivedTopicTimer> timers;
+        std::shared_ptr<MCPMessage_V1> result;
+        try {
+            result = derivedTopic->process(message, now, timers);
+        } catch (const std::exception& e) {
+            // A failing operator drops this message for this derived topic only
+            const std::string& derived = derivedTopic->getSpec().topic;
+            reportError(derived.c_str(), ErrorCode::DISPATCH_FAILED, ErrorSeverity::WARNING,
+                        e.what(), message->topic.c_str());
+        }
         
-        // Wait for a message or shutdown signal
-        {
-            std::unique_lock<std::mutex> lock(m_queueMutex);
-            
-            m_queueCondition.wait(lock, [this] {
-                return !m_messageQueue.empty() || !m_threadRunning;
-            });
-            
-            // Check if we should exit
-            if (!m_threadRunning && m_messageQueue.empty()) {
-                break;
+        scheduleDerivedTimers(derivedTopic, timers);
+        if (result) {
+            publish(result);
+        }
+    }
+}
+
+void MCPBroker::scheduleDerivedTimers(const std::shared_ptr<DerivedTopic>& derivedTopic,
+                                      const std::vector<DerivedTopicTimer>& timers) {
+    std::weak_ptr<DerivedTopic> weakDerived = derivedTopic;
+    for (const auto& timer : timers) {
+        // Fire on the source topic so the flush is ordered with the chain's other runs
+        scheduleTask(derivedTopic->getSpec().sourceTopic, timer.due, [this, weakDerived, timer]() {
+            auto derived = weakDerived.lock();
+            if (!derived) {
+                return;
             }
             
-            // Get the next message
-            if (!m_messageQueue.empty()) {
-                message = m_messageQueue.front();
-                m_messageQueue.pop();
+            std::vector<DerivedTopicTimer> rearm;
+            auto result = derived->fire(timer, std::chrono::steady_clock::now(), rearm);
+            scheduleDerivedTimers(derived, rearm);
+            if (result) {
+                publish(result);
             }
+        });
+    }
+}
+
+void MCPBroker::replayHistory(const std::weak_ptr<IMCPSubscriber_V1>& subscriber,
+                              const std::vector<std::shared_ptr<const MCPMessage_V1>>& messages,
+                              ErrorSink& errors) {
+    auto target = subscriber.lock();
+    if (!target) {
+        return;
+    }
+    
+    // Batched subscribers get the whole snapshot in one call
+    if (auto batched = std::dynamic_pointer_cast<IMCPSubscriber_V2>(target)) {
+        std::vector<const MCPMessage_V1*> batch;
+        batch.reserve(messages.size());
+        for (const auto& message : messages) {
+            batch.push_back(message.get());
         }
-        
-        // Process the message if we got one
-        if (message) {
-            try {
-                deliverMessage(message);
-            } catch (const std::exception& e) {
-                // Log error but continue processing
-                // In a real implementation, this would log to a proper error reporting system
-                // For now, we just catch and continue to avoid crashing the worker thread
-            }
+        try {
+            batched->onMCPMessages(batch.data(), batch.size());
+        } catch (const std::exception& e) {
+            // A failing callback must not take down the worker
+            const char* topic = messages.front()->topic.c_str();
+            errors.report(topic, ErrorCode::SUBSCRIBER_FAILED, ErrorSeverity::WARNING,
+                          e.what(), topic, subscriberName(*target));
+        }
+        return;
+    }
+    
+    for (const auto& message : messages) {
+        try {
+            target->onMCPMessage(message.get());
+        } catch (const std::exception& e) {
+            // A failing callback must not cut the replay short
+            const char* topic = message->topic.c_str();
+            errors.report(topic, ErrorCode::SUBSCRIBER_FAILED, ErrorSeverity::WARNING,
+                          e.what(), topic, subscriberName(*target));
         }
     }
 }
 
-void MCPBroker::deliverMessage(std::shared_ptr<MCPMessage_V1> message) {
-    // Get a copy of the subscribers to avoid holding the lock during callbacks
-    std::vector<std::shared_ptr<IMCPSubscriber_V1>> subscribers;
+void MCPBroker::deliverMessage(std::shared_ptr<MCPMessage_V1> message,
+                               std::chrono::steady_clock::time_point publishTime) {
+    // Get a copy of the recipients to avoid holding the lock during callbacks
+    std::vector<Recipient> recipients;
+    std::vector<std::shared_ptr<DerivedTopic>> derivedTopics;
+    
+    // Requested resolutions, parallel to recipients (pyramid topics only)
+    std::vector<std::size_t> resolutions;
+    bool decimate = false;
     
     {
         std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+        // The per-topic features are looked up by name only while in use
+        bool pyramid = !m_pyramidTopics.empty() && m_pyramidTopics.count(message->topic) > 0;
         
-        // Find subscribers for this topic
-        auto topicIt = m_subscriptions.find(message->topic);
-        if (topicIt != m_subscriptions.end()) {
-            const auto& weakSubscribers = topicIt->second;
+        if (!m_derivedBySource.empty()) {
+            auto derivedIt = m_derivedBySource.find(message->topic);
+            if (derivedIt != m_derivedBySource.end()) {
+                derivedTopics = derivedIt->second;
+            }
+        }
+        
+        // Record before taking the subscriber snapshot so a replaying
+        // subscribe sees the message either in history or live, never both
+        if (!m_histories.empty()) {
+            auto historyIt = m_histories.find(message->topic);
+            if (historyIt != m_histories.end()) {
+                historyIt->second->append(message, publishTime);
+            }
+        }
+        if (!m_retainedState.empty()) {
+            auto retainedIt = m_retainedState.find(message->topic);
+            if (retainedIt != m_retainedState.end()) {
+                retainedIt->second = message;
+            }
+        }
+        
+        // Find subscribers for this topic (already in fan-out order)
+        std::vector<Subscription>* topicSubscriptions = findSubscriptions(*message);
+        if (topicSubscriptions) {
+            const auto& subscriptions = *topicSubscriptions;
+            
+            // Group members that are not picked for this message
+            std::vector<bool> skipped;
+            selectGroupMembers(message->topic, subscriptions, skipped);
             
             // Lock all weak pointers to get shared_ptr
-            for (const auto& weakSubscriber : weakSubscribers) {
-                if (auto subscriber = weakSubscriber.lock()) {
-                    subscribers.push_back(subscriber);
+            bool expired = false;
+            for (std::size_t i = 0; i < subscriptions.size(); ++i) {
+                const Subscription& subscription = subscriptions[i];
+                auto subscriber = subscription.subscriber.lock();
+                if (!subscriber) {
+                    expired = true;
+                    continue;
+                }
+                if (!skipped.empty() && skipped[i]) {
+                    continue;
+                }
+                
+                Recipient recipient;
+                recipient.subscriber = std::move(subscriber);
+                recipient.strand = subscription.strand;
+                recipient.load = subscription.load;
+                recipient.gate = subscription.gate;
+                recipient.deadband = subscription.deadband;
+                recipient.rateLimit = subscription.rateLimit;
+                recipient.mailbox = subscription.mailbox;
+                recipients.push_back(std::move(recipient));
+                if (pyramid) {
+                    resolutions.push_back(subscription.options.targetResolution);
+                    decimate = decimate || subscription.options.targetResolution > 0;
                 }
             }
             
             // Clean up expired subscribers if needed
-            if (subscribers.size() != weakSubscribers.size()) {
-                auto& mutableSubscribers = topicIt->second;
-                mutableSubscribers.erase(
-                    std::remove_if(mutableSubscribers.begin(), mutableSubscribers.end(),
-                        [](const std::weak_ptr<IMCPSubscriber_V1>& weakSubscriber) {
-                            return weakSubscriber.expired();
-                        }),
-                    mutableSubscribers.end()
-                );
+            if (expired) {
+                auto& mutableSubscriptions = *topicSubscriptions;
+                auto it = std::stable_partition(mutableSubscriptions.begin(), mutableSubscriptions.end(),
+                    [](const Subscription& subscription) {
+                        return !subscription.subscriber.expired();
+                    });
+                closeSubscriptions(it, mutableSubscriptions.end());
+                mutableSubscriptions.erase(it, mutableSubscriptions.end());
                 
                 // Remove the topic if no subscribers left
-                if (mutableSubscribers.empty()) {
-                    m_subscriptions.erase(topicIt);
+                if (mutableSubscriptions.empty()) {
+                    unindexSubscriptions(message->topic);
+                    m_subscriptions.erase(message->topic);
+                    m_groupCursors.erase(message->topic);
+                }
+            }
+        }
+    }
+    
+    // Subscribers that asked for a resolution get a decimated level instead
+    std::vector<std::shared_ptr<MCPMessage_V1>> levelMessages;
+    if (decimate) {
+        levelMessages = decimateForSubscribers(message, resolutions);
+    }
+    
+    // Numeric value of the message a deadband subscriber would get, decoded
+    // once per distinct message (level messages are shared between subscribers)
+    const MCPMessage_V1* decoded = nullptr;
+    bool numeric = false;
+    double value = 0.0;
+    
+    // Deliver the message to each recipient, latency-critical ones first;
+    // near-duplicates are suppressed per deadband, rate-limited recipients
+    // keep only the newest message until their interval has passed, and
+    // recipients without credit get the message held or dropped instead
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+    std::size_t parallelFanout = m_parallelFanout.load(std::memory_order_relaxed);
+    bool parallel = parallelFanout > 0 && recipients.size() >= parallelFanout;
+    std::vector<std::size_t> parallelRecipients;
+    for (std::size_t i = 0; i < recipients.size(); ++i) {
+        const std::shared_ptr<MCPMessage_V1>& delivered = levelMessages.empty() ? message : levelMessages[i];
+        const Recipient& recipient = recipients[i];
+        if (recipient.deadband) {
+            if (decoded != delivered.get()) {
+                decoded = delivered.get();
+                numeric = false;
+                try {
+                    value = serialization::extractMessageData<double>(decoded);
+                    numeric = true;
+                } catch (const MCPSerializationError& e) {
+                    // Not a number - deadbands do not apply
+                }
+            }
+            if (numeric && !recipient.deadband->pass(value)) {
+                continue;
+            }
+        }
+        if (recipient.rateLimit && !recipient.rateLimit->admit(delivered, now)) {
+            if (!recipient.rateLimit->timerArmed) {
+                scheduleTrailingDelivery(message->topic, recipient);
+            }
+            continue;
+        }
+        
+        // Plain inline recipients of a large fan-out are delivered in parallel below
+        if (parallel && !recipient.strand && !recipient.mailbox && !recipient.gate) {
+            parallelRecipients.push_back(i);
+            continue;
+        }
+        admitAndDeliver(message->topic, recipient, delivered);
+    }
+    if (!parallelRecipients.empty()) {
+        deliverParallel(recipients, parallelRecipients, message, levelMessages);
+    }
+    
+    // Derived topics are computed once per message, not once per subscriber
+    if (!derivedTopics.empty()) {
+        runDerivedTopics(derivedTopics, message);
+    }
+}
+
+void MCPBroker::deliverParallel(const std::vector<Recipient>& recipients,
+                                const std::vector<std::size_t>& indices,
+                                const std::shared_ptr<MCPMessage_V1>& message,
+                                const std::vector<std::shared_ptr<MCPMessage_V1>>& levelMessages) {
+    auto deliverRange = [&](std::size_t first, std::size_t last) {
+        for (std::size_t j = first; j < last; ++j) {
+            std::size_t i = indices[j];
+            deliverTo(recipients[i], levelMessages.empty() ? message : levelMessages[i]);
+        }
+    };
+    
+    // One chunk per hardware thread at most
+    std::shared_ptr<WorkStealingPool> pool = getCallbackPool();
+    std::size_t chunks = std::min(pool->getThreadCount(),
+                                  (indices.size() + MIN_FANOUT_CHUNK - 1) / MIN_FANOUT_CHUNK);
+    if (chunks <= 1) {
+        deliverRange(0, indices.size());
+        return;
+    }
+    std::size_t chunkSize = (indices.size() + chunks - 1) / chunks;
+    
+    // Chunks are claimed by index, by the dispatching thread and by helpers
+    // on the callback pool alike. The pool also runs SHARED_POOL callbacks,
+    // so a helper may start late or never; the dispatching thread then runs
+    // the remaining chunks itself and only waits for chunks a helper is
+    // already running. The state outlives this frame for helpers that start
+    // after the last chunk was claimed; they leave without touching the frame.
+    struct Fanout {
+        std::atomic<std::size_t> next{0};
+        std::mutex mutex;
+        std::condition_variable done;
+        std::size_t helping = 0;
+    };
+    auto fanout = std::make_shared<Fanout>();
+    auto claimChunks = [&, chunks, chunkSize](Fanout& state) {
+        std::size_t chunk;
+        while ((chunk = state.next.fetch_add(1)) < chunks) {
+            std::size_t first = chunk * chunkSize;
+            deliverRange(first, std::min(first + chunkSize, indices.size()));
+        }
+    };
+    
+    for (std::size_t helper = 1; helper < chunks; ++helper) {
+        pool->submit([fanout, chunks, &claimChunks]() {
+            {
+                std::lock_guard<std::mutex> lock(fanout->mutex);
+                if (fanout->next.load() >= chunks) {
+                    return;
+                }
+                fanout->helping++;
+            }
+            claimChunks(*fanout);
+            std::lock_guard<std::mutex> lock(fanout->mutex);
+            if (--fanout->helping == 0) {
+                fanout->done.notify_one();
+            }
+        });
+    }
+    
+    claimChunks(*fanout);
+    
+    std::unique_lock<std::mutex> lock(fanout->mutex);
+    fanout->done.wait(lock, [&fanout]() { return fanout->helping == 0; });
+}
+
+bool MCPBroker::Deadband::pass(double value) const {
+    if (!hasLast) {
+        return true;
+    }
+    double band = std::max(absolute, relative * std::fabs(last));
+    return std::fabs(value - last) > band;
+}
+
+void MCPBroker::Deadband::delivered(const MCPMessage_V1& message) {
+    // Decoded again rather than carried along, since held and trailing
+    // messages reach the subscriber long after they passed
+    try {
+        last = serialization::extractMessageData<double>(&message);
+        hasLast = true;
+    } catch (const MCPSerializationError& e) {
+        // Not a number - deadbands do not apply
+    }
+}
+
+bool MCPBroker::RateLimit::admit(const std::shared_ptr<MCPMessage_V1>& message,
+                                 std::chrono::steady_clock::time_point now) {
+    if (!hasLast || now - last >= interval) {
+        hasLast = true;
+        last = now;
+        trailing.reset();
+        return true;
+    }
+    trailing = message;
+    return false;
+}
+
+void MCPBroker::admitAndDeliver(const std::string& topic, const Recipient& recipient,
+                                const std::shared_ptr<MCPMessage_V1>& message) {
+    if (recipient.gate && !recipient.gate->admit(message)) {
+        if (recipient.gate->claimRetry()) {
+            waitForCredit(topic, recipient);
+        }
+        return;
+    }
+    deliverTo(recipient, message);
+}
+
+void MCPBroker::deliverTo(const Recipient& recipient, const std::shared_ptr<MCPMessage_V1>& message) {
+    if (recipient.load) {
+        recipient.load->fetch_add(1, std::memory_order_relaxed);
+    }
+    
+    // Messages that were rate-limited, held or dropped on the way never get
+    // here, so the deadband compares against what the subscriber last got
+    if (recipient.deadband) {
+        recipient.deadband->delivered(*message);
+    }
+    
+    if (recipient.mailbox) {
+        deliverBatched(recipient, message);
+        return;
+    }
+    
+    // Off-thread subscribers only get a task posted to their strand
+    if (recipient.strand) {
+        std::weak_ptr<IMCPSubscriber_V1> weakSubscriber = recipient.subscriber;
+        std::shared_ptr<std::atomic<uint32_t>> load = recipient.load;
+        std::shared_ptr<ErrorSink> errors = m_errorSink;
+        recipient.strand->post([weakSubscriber, message, load, errors]() {
+            if (auto subscriber = weakSubscriber.lock()) {
+                try {
+                    subscriber->onMCPMessage(message.get());
+                } catch (const std::exception& e) {
+                    // Report, and keep the load count balanced below
+                    errors->report(message->topic.c_str(), ErrorCode::SUBSCRIBER_FAILED, ErrorSeverity::WARNING,
+                                   e.what(), message->topic.c_str(), subscriberName(*subscriber));
                 }
             }
+            if (load) {
+                load->fetch_sub(1, std::memory_order_relaxed);
+            }
+        });
+        return;
+    }
+    
+    try {
+        recipient.subscriber->onMCPMessage(message.get());
+    } catch (const std::exception& e) {
+        // Report and continue delivering to other subscribers
+        m_errorSink->report(message->topic.c_str(), ErrorCode::SUBSCRIBER_FAILED, ErrorSeverity::WARNING,
+                            e.what(), message->topic.c_str(), subscriberName(*recipient.subscriber));
+    }
+    if (recipient.load) {
+        recipient.load->fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+void MCPBroker::deliverBatched(const Recipient& recipient, const std::shared_ptr<MCPMessage_V1>& message) {
+    std::shared_ptr<Mailbox> mailbox = recipient.mailbox;
+    std::shared_ptr<std::atomic<uint32_t>> load = recipient.load;
+    {
+        std::lock_guard<std::mutex> lock(mailbox->mutex);
+        if (mailbox->closed) {
+            if (load) {
+                load->fetch_sub(1, std::memory_order_relaxed);
+            }
+            return;
+        }
+        mailbox->pending.push_back(message);
+        
+        // A drain is already waiting and will pick this message up
+        if (mailbox->scheduled) {
+            return;
+        }
+        mailbox->scheduled = true;
+    }
+    
+    std::shared_ptr<ErrorSink> errors = m_errorSink;
+    auto drain = [mailbox, load, errors]() { drainMailbox(*mailbox, load, *errors); };
+    if (recipient.strand) {
+        recipient.strand->post(drain);
+        return;
+    }
+    
+    // Inline subscribers are drained as their own queue entry, so messages
+    // dispatched meanwhile join the batch
+    bool queued = false;
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        
+        // Checked again under the queue lock, so a drain never recreates the
+        // sub-queue of a mailbox that closeSubscriptions() already released
+        bool closed = false;
+        {
+            std::lock_guard<std::mutex> mailboxLock(mailbox->mutex);
+            closed = mailbox->closed;
+        }
+        if (closed) {
+            return;
+        }
+        if (m_threadRunning) {
+            auto now = std::chrono::steady_clock::now();
+            m_messageQueue.pushTask(mailbox->queueKey, drain, now);
+            startWorkers(now);
+            maybeScaleUp(now);
+            queued = true;
         }
     }
+    if (queued) {
+        m_queueCondition.notify_one();
+    } else {
+        drain();
+    }
+}
+
+void MCPBroker::drainMailbox(Mailbox& mailbox, const std::shared_ptr<std::atomic<uint32_t>>& load,
+                             ErrorSink& errors) {
+    std::vector<std::shared_ptr<MCPMessage_V1>> messages;
+    {
+        std::lock_guard<std::mutex> lock(mailbox.mutex);
+        messages.swap(mailbox.pending);
+        mailbox.scheduled = false;
+    }
+    if (messages.empty()) {
+        return;
+    }
     
-    // Deliver the message to each subscriber
-    for (const auto& subscriber : subscribers) {
+    if (auto subscriber = mailbox.subscriber.lock()) {
+        std::vector<const MCPMessage_V1*> batch;
+        batch.reserve(messages.size());
+        for (const auto& message : messages) {
+            batch.push_back(message.get());
+        }
         try {
-            subscriber->onMCPMessage(message.get());
+            subscriber->onMCPMessages(batch.data(), batch.size());
         } catch (const std::exception& e) {
-            // Log error but continue delivering to other subscribers
-            // In a real implementation, this would log to a proper error reporting system
+            // Report, and keep the load count balanced below
+            const char* topic = messages.front()->topic.c_str();
+            errors.report(topic, ErrorCode::SUBSCRIBER_FAILED, ErrorSeverity::WARNING,
+                          e.what(), topic, subscriberName(*subscriber));
+        }
+    }
+    if (load) {
+        load->fetch_sub(static_cast<uint32_t>(messages.size()), std::memory_order_relaxed);
+    }
+}
+
+void MCPBroker::waitForCredit(const std::string& topic, const Recipient& recipient) {
+    // Runs in the topic's order, so released messages stay ahead of later ones
+    std::weak_ptr<IMCPSubscriber_V1> weakSubscriber = recipient.subscriber;
+    std::shared_ptr<Strand> strand = recipient.strand;
+    std::shared_ptr<std::atomic<uint32_t>> load = recipient.load;
+    std::shared_ptr<CreditGate> gate = recipient.gate;
+    std::shared_ptr<Mailbox> mailbox = recipient.mailbox;
+    
+    std::function<void()> retry = [this, topic, weakSubscriber, strand, load, gate, mailbox]() {
+        Recipient released;
+        released.subscriber = weakSubscriber.lock();
+        if (!released.subscriber) {
+            gate->close();
+            return;
+        }
+        released.strand = strand;
+        released.load = load;
+        released.gate = gate;
+        released.mailbox = mailbox;
+        
+        std::vector<std::shared_ptr<MCPMessage_V1>> messages;
+        bool stillHeld = gate->release(messages);
+        for (const auto& message : messages) {
+            deliverTo(released, message);
+        }
+        if (stillHeld) {
+            waitForCredit(topic, released);
         }
+    };
+    
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (!m_threadRunning) {
+            return;
+        }
+        
+        // A grant that came before the waiter was listed may have raised its
+        // wakeup already, so credit available now is used right away
+        if (gate->getCredits()->available() == 0) {
+            m_creditWaiters.push_back(CreditWaiter{topic, gate, std::move(retry)});
+            return;
+        }
+        m_messageQueue.pushTask(topic, std::move(retry), std::chrono::steady_clock::now());
+    }
+    m_queueCondition.notify_one();
+}
+
+void MCPBroker::registerCreditWakeup(const std::shared_ptr<DeliveryCredits>& credits) {
+    // Accounts of subscribers that are gone are dropped on the way
+    bool registered = false;
+    auto kept = m_creditAccounts.begin();
+    for (auto& account : m_creditAccounts) {
+        auto existing = account.lock();
+        if (!existing) {
+            continue;
+        }
+        registered = registered || existing == credits;
+        *kept++ = std::move(account);
+    }
+    m_creditAccounts.erase(kept, m_creditAccounts.end());
+    if (registered) {
+        return;
+    }
+    m_creditAccounts.push_back(credits);
+    
+    // Runs on the granting thread (possibly the audio thread): only flag the
+    // workers, the waiters are queued by the next dispatch
+    credits->setWakeup(this, [this]() {
+        m_creditsGranted.store(true);
+        wakeWorker();
+    });
+}
+
+void MCPBroker::wakeWorker() noexcept {
+    // Passing through the mutex orders the notification after the last look
+    // a worker took at its flags under it, so that worker is already waiting.
+    // If the mutex is busy the notification may race with a worker that is
+    // about to wait, which then wakes at its bound instead
+    if (m_queueMutex.try_lock()) {
+        m_queueMutex.unlock();
+    }
+    m_queueCondition.notify_one();
+}
+
+void MCPBroker::releaseCreditWaiters(std::chrono::steady_clock::time_point now) {
+    m_creditsGranted.store(false);
+    
+    auto waiting = m_creditWaiters.begin();
+    for (auto& waiter : m_creditWaiters) {
+        if (waiter.gate->getCredits()->available() > 0) {
+            m_messageQueue.pushTask(waiter.topic, std::move(waiter.retry), now);
+        } else {
+            *waiting++ = std::move(waiter);
+        }
+    }
+    m_creditWaiters.erase(waiting, m_creditWaiters.end());
+}
+
+void MCPBroker::scheduleTrailingDelivery(const std::string& topic, const Recipient& recipient) {
+    // Runs in the topic's order, so a newer message that got through first
+    // has already cleared the trailing one
+    std::shared_ptr<RateLimit> rateLimit = recipient.rateLimit;
+    std::weak_ptr<IMCPSubscriber_V1> weakSubscriber = recipient.subscriber;
+    Recipient detached = recipient;
+    detached.subscriber.reset();
+    
+    rateLimit->timerArmed = true;
+    bool scheduled = scheduleTask(topic, rateLimit->last + rateLimit->interval,
+                                  [this, topic, rateLimit, weakSubscriber, detached]() {
+        rateLimit->timerArmed = false;
+        if (rateLimit->closed || !rateLimit->trailing) {
+            return;
+        }
+        
+        Recipient trailing = detached;
+        trailing.subscriber = weakSubscriber.lock();
+        if (!trailing.subscriber) {
+            return;
+        }
+        std::shared_ptr<MCPMessage_V1> message = std::move(rateLimit->trailing);
+        rateLimit->trailing.reset();
+        rateLimit->last = std::chrono::steady_clock::now();
+        admitAndDeliver(topic, trailing, message);
+    });
+    if (!scheduled) {
+        // Without workers the next message after the interval goes through instead
+        rateLimit->timerArmed = false;
+    }
+}
+
+std::vector<std::shared_ptr<MCPMessage_V1>> MCPBroker::decimateForSubscribers(
+    const std::shared_ptr<MCPMessage_V1>& message, const std::vector<std::size_t>& resolutions) {
+    std::vector<std::shared_ptr<MCPMessage_V1>> delivered(resolutions.size(), message);
+    
+    std::vector<float> samples;
+    try {
+        samples = serialization::extractMessageData<std::vector<float>>(message.get());
+    } catch (const MCPSerializationError& e) {
+        // Not a float array - everybody gets the message as published
+        return delivered;
+    }
+    
+    // Only build down to the coarsest resolution anybody asked for
+    std::size_t coarsest = samples.size();
+    for (std::size_t resolution : resolutions) {
+        if (resolution > 0) {
+            coarsest = std::min(coarsest, resolution);
+        }
+    }
+    MinMaxPyramid pyramid(samples, coarsest);
+    
+    // Encode each level once and share it between subscribers
+    std::vector<std::shared_ptr<MCPMessage_V1>> encoded(pyramid.getLevelCount());
+    for (std::size_t i = 0; i < resolutions.size(); ++i) {
+        if (resolutions[i] == 0) {
+            continue;
+        }
+        
+        int level = pyramid.selectLevel(resolutions[i]);
+        if (level < 0) {
+            continue;
+        }
+        
+        auto& levelMessage = encoded[level];
+        if (!levelMessage) {
+            levelMessage = serialization::createMsgPackMessage(message->topic, message->senderModuleId,
+                                                               pyramid.getLevel(level));
+            levelMessage->messageId = message->messageId;
+            levelMessage->priority = message->priority;
+            levelMessage->timestamp = message->timestamp;
+        }
+        delivered[i] = levelMessage;
     }
+    return delivered;
+}
+
+void MCPBroker::enablePyramid(const std::string& topic) {
+    if (topic.empty()) {
+        return;
+    }
+    
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    m_pyramidTopics.insert(topic);
+}
+
+bool MCPBroker::disablePyramid(const std::string& topic) {
+    std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+    return m_pyramidTopics.erase(topic) > 0;
 }
 
 int MCPBroker::getVersion() const {
@@ -408,25 +2505,61 @@ std::shared_ptr<IMCPBroker> getMCPBroker() {
 
 // Add this method to MCPBroker
 void MCPBroker::clearAllRegistries() {
+    // Keep the retained state for the next start before it is reset
+    saveShutdownSnapshot();
+    
     // Clear topic registry
     {
         std::lock_guard<std::mutex> lock(m_registryMutex);
         m_topicRegistry.clear();
     }
     
-    // Clear subscriptions
+    // Clear directed-message targets
+    {
+        std::lock_guard<std::mutex> lock(m_endpointMutex);
+        m_endpoints.clear();
+    }
+    
+    // Clear subscriptions and retained history
     {
         std::lock_guard<std::mutex> lock(m_subscriptionMutex);
+        for (auto& topicSubscriptions : m_subscriptions) {
+            closeSubscriptions(topicSubscriptions.second.begin(), topicSubscriptions.second.end());
+        }
+        m_subscriptionsByHash.clear();
+        m_topicHashes.clear();
         m_subscriptions.clear();
+        m_groupCursors.clear();
+        m_histories.clear();
+        for (auto& retained : m_retainedState) {
+            retained.second.reset();
+        }
+        m_derivedTopics.clear();
+        m_derivedBySource.clear();
+        m_pyramidTopics.clear();
     }
     
-    // Clear message queue
+    // Clear message queue, pending timers and topic declarations
     {
         std::lock_guard<std::mutex> lock(m_queueMutex);
-        while (!m_messageQueue.empty()) {
-            m_messageQueue.pop();
-        }
+        m_messageQueue.clear();
+        m_conflatingTopics.clear();
+        m_topicDescriptors.clear();
+        m_scheduledTasks = decltype(m_scheduledTasks)();
+        m_creditWaiters.clear();
+        m_lastPayloads.clear();
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_contentCacheMutex);
+        m_contentCache.clear();
+    }
+    
+    // Requests lost their handlers and timeouts
+    {
+        std::lock_guard<std::mutex> lock(m_requestMutex);
+        m_requestHandlers.clear();
     }
+    cancelPendingRequests();
 }
 
 } // namespace mcp 
\ No newline at end of file
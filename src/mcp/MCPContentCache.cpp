@@ -0,0 +1,102 @@
+#include "mcp/MCPContentCache.h"
+#include <algorithm>
+#include <cstring>
+
+namespace mcp {
+
+ContentCache::ContentCache(std::size_t capacity) : m_capacity(capacity), m_size(0) {}
+
+uint64_t ContentCache::hash(const void* data, std::size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint64_t hash = 0x9e3779b97f4a7c15ull ^ size;
+
+    std::size_t offset = 0;
+    for (; offset + sizeof(uint64_t) <= size; offset += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+    if (offset < size) {
+        uint64_t word = 0;
+        std::memcpy(&word, bytes + offset, size - offset);
+        hash = (hash ^ word) * 0xff51afd7ed558ccdull;
+        hash ^= hash >> 32;
+    }
+
+    // Final avalanche (murmur3 fmix64)
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+    return hash;
+}
+
+std::shared_ptr<void> ContentCache::find(uint64_t hash, const void* data, std::size_t size) {
+    auto it = m_index.find(hash);
+    if (it == m_index.end()) {
+        return nullptr;
+    }
+
+    const Entry& entry = *it->second;
+    if (entry.size != size || (size > 0 && std::memcmp(entry.data.get(), data, size) != 0)) {
+        return nullptr;
+    }
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return entry.data;
+}
+
+std::shared_ptr<void> ContentCache::copy(const void* data, std::size_t size) {
+    std::shared_ptr<void> blob(new uint8_t[std::max<std::size_t>(1, size)],
+                               [](void* p) { delete[] static_cast<uint8_t*>(p); });
+    if (size > 0) {
+        std::memcpy(blob.get(), data, size);
+    }
+    return blob;
+}
+
+std::shared_ptr<void> ContentCache::insert(uint64_t hash, const void* data, std::size_t size) {
+    if (size > m_capacity) {
+        return insert(hash, nullptr, size);
+    }
+    return insert(hash, copy(data, size), size);
+}
+
+std::shared_ptr<void> ContentCache::insert(uint64_t hash, std::shared_ptr<void> blob, std::size_t size) {
+    auto it = m_index.find(hash);
+    if (it != m_index.end()) {
+        m_size -= it->second->size;
+        m_entries.erase(it->second);
+        m_index.erase(it);
+    }
+    if (!blob || size > m_capacity) {
+        return nullptr;
+    }
+
+    m_entries.push_front(Entry{hash, blob, size});
+    m_index[hash] = m_entries.begin();
+    m_size += size;
+    evict();
+    return blob;
+}
+
+void ContentCache::setCapacity(std::size_t capacity) {
+    m_capacity = capacity;
+    evict();
+}
+
+void ContentCache::clear() {
+    m_entries.clear();
+    m_index.clear();
+    m_size = 0;
+}
+
+void ContentCache::evict() {
+    while (m_size > m_capacity && !m_entries.empty()) {
+        const Entry& oldest = m_entries.back();
+        m_size -= oldest.size;
+        m_index.erase(oldest.hash);
+        m_entries.pop_back();
+    }
+}
+
+} // namespace mcp
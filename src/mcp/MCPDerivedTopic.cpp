@@ -0,0 +1,91 @@
+#include "mcp/MCPDerivedTopic.h"
+
+namespace mcp {
+
+DerivedTopic::DerivedTopic(const DerivedTopicSpec& spec)
+    : m_spec(spec), m_stages(spec.operators.size()) {}
+
+std::shared_ptr<MCPMessage_V1> DerivedTopic::process(const std::shared_ptr<MCPMessage_V1>& message,
+                                                     std::chrono::steady_clock::time_point now,
+                                                     std::vector<DerivedTopicTimer>& timers) {
+    return runFrom(0, message, now, timers);
+}
+
+std::shared_ptr<MCPMessage_V1> DerivedTopic::fire(const DerivedTopicTimer& timer,
+                                                  std::chrono::steady_clock::time_point now,
+                                                  std::vector<DerivedTopicTimer>& timers) {
+    if (timer.stage >= m_stages.size()) {
+        return nullptr;
+    }
+
+    StageState& state = m_stages[timer.stage];
+    state.timerArmed = false;
+    if (!state.pending) {
+        return nullptr;
+    }
+
+    // Newer messages arrived since the timer was armed - wait for the rest of the quiet period
+    auto quietUntil = state.pendingSince + m_spec.operators[timer.stage].period;
+    if (now < quietUntil) {
+        state.timerArmed = true;
+        timers.push_back(DerivedTopicTimer{timer.stage, quietUntil});
+        return nullptr;
+    }
+
+    std::shared_ptr<MCPMessage_V1> message = std::move(state.pending);
+    state.pending.reset();
+    return runFrom(timer.stage + 1, std::move(message), now, timers);
+}
+
+std::shared_ptr<MCPMessage_V1> DerivedTopic::runFrom(std::size_t stage,
+                                                     std::shared_ptr<MCPMessage_V1> message,
+                                                     std::chrono::steady_clock::time_point now,
+                                                     std::vector<DerivedTopicTimer>& timers) {
+    for (; stage < m_spec.operators.size() && message; ++stage) {
+        const StreamOperator& op = m_spec.operators[stage];
+        StageState& state = m_stages[stage];
+
+        switch (op.kind) {
+            case StreamOperator::Kind::MAP:
+                message = op.mapFunction ? op.mapFunction(*message) : nullptr;
+                break;
+
+            case StreamOperator::Kind::FILTER:
+                if (!op.filterFunction || !op.filterFunction(*message)) {
+                    message.reset();
+                }
+                break;
+
+            case StreamOperator::Kind::THROTTLE:
+                if (state.forwarded && now - state.lastForward < op.period) {
+                    message.reset();
+                } else {
+                    state.forwarded = true;
+                    state.lastForward = now;
+                }
+                break;
+
+            case StreamOperator::Kind::DEBOUNCE:
+                state.pending = std::move(message);
+                state.pendingSince = now;
+                if (!state.timerArmed) {
+                    state.timerArmed = true;
+                    timers.push_back(DerivedTopicTimer{stage, now + op.period});
+                }
+                return nullptr;
+        }
+    }
+
+    return message ? retarget(*message) : nullptr;
+}
+
+std::shared_ptr<MCPMessage_V1> DerivedTopic::retarget(const MCPMessage_V1& message) const {
+    // Share the payload; only the envelope is new
+    auto derived = std::make_shared<MCPMessage_V1>(m_spec.topic, m_spec.senderModuleId,
+                                                   message.dataFormat, message.data, message.dataSize,
+                                                   message.messageId, message.priority);
+    derived->timestamp = message.timestamp;
+    return derived;
+}
+
+} // namespace mcp
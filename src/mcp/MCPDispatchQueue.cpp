@@ -0,0 +1,336 @@
+#include "mcp/MCPDispatchQueue.h"
+
+namespace mcp {
+
+struct DispatchQueue::TopicQueue {
+    std::string name;
+    std::deque<DispatchEntry> entries;
+    bool inFlight = false;
+
+    // Erase once drained (see removeTopic())
+    bool removed = false;
+
+    bool ready = false;
+    bool coalescing = false;
+    bool hasDeadline = false;
+    std::chrono::steady_clock::duration deadline{};
+
+    // Deficit round-robin: messages per turn and messages left in this turn
+    uint32_t weight = 1;
+    uint32_t deficit = 0;
+
+    // Load counters for the current sampling window
+    uint64_t produced = 0;
+    uint64_t consumed = 0;
+    uint64_t coalesced = 0;
+};
+
+DispatchQueue::DispatchQueue()
+    : m_policy(SchedulingPolicy::EARLIEST_DEADLINE), m_size(0), m_nextSequence(0),
+      m_defaultDeadline(std::chrono::milliseconds(50)) {}
+
+DispatchQueue::~DispatchQueue() = default;
+
+void DispatchQueue::push(std::shared_ptr<MCPMessage_V1> message,
+                         std::chrono::steady_clock::time_point now) {
+    TopicQueue* slot = topicQueueFor(*message);
+    slot->produced++;
+
+    // Replace the pending value in place, keeping its queue position
+    if (slot->coalescing && !slot->entries.empty() && !slot->entries.back().task) {
+        slot->entries.back().message = std::move(message);
+        slot->coalesced++;
+        return;
+    }
+
+    DispatchEntry entry;
+    entry.message = std::move(message);
+    entry.sequence = m_nextSequence++;
+    entry.enqueueTime = now;
+    entry.deadline = now + (slot->hasDeadline ? slot->deadline : m_defaultDeadline);
+
+    slot->entries.push_back(std::move(entry));
+    ++m_size;
+
+    markReadyIfIdle(slot);
+}
+
+void DispatchQueue::pushTask(const std::string& topic, std::function<void()> task,
+                             std::chrono::steady_clock::time_point now, bool front) {
+    TopicQueue* slot = topicQueueFor(topic);
+
+    DispatchEntry entry;
+    entry.task = std::move(task);
+    entry.sequence = m_nextSequence++;
+    entry.enqueueTime = now;
+    entry.deadline = now + (slot->hasDeadline ? slot->deadline : m_defaultDeadline);
+
+    if (front) {
+        slot->entries.push_front(std::move(entry));
+    } else {
+        slot->entries.push_back(std::move(entry));
+    }
+    ++m_size;
+
+    markReadyIfIdle(slot);
+}
+
+void DispatchQueue::prepareTopic(const std::string& topic) {
+    topicQueueFor(topic);
+}
+
+void DispatchQueue::removeTopic(const std::string& topic) {
+    auto it = m_topics.find(topic);
+    if (it == m_topics.end()) {
+        return;
+    }
+
+    TopicQueue* topicQueue = it->second.get();
+    if (topicQueue->inFlight || !topicQueue->entries.empty()) {
+        topicQueue->removed = true;
+        return;
+    }
+    eraseTopic(topicQueue);
+}
+
+bool DispatchQueue::indexTopicHash(const std::string& topic, uint64_t hash) {
+    TopicQueue* topicQueue = topicQueueFor(topic);
+    auto inserted = m_topicsByHash.emplace(hash, topicQueue);
+    return inserted.first->second == topicQueue;
+}
+
+void DispatchQueue::setTopicDeadline(const std::string& topic,
+                                     std::chrono::steady_clock::duration deadline) {
+    TopicQueue* topicQueue = topicQueueFor(topic);
+    topicQueue->hasDeadline = true;
+    topicQueue->deadline = deadline;
+}
+
+void DispatchQueue::setDefaultDeadline(std::chrono::steady_clock::duration deadline) {
+    m_defaultDeadline = deadline;
+}
+
+void DispatchQueue::setSchedulingPolicy(SchedulingPolicy policy) {
+    if (policy == m_policy) {
+        return;
+    }
+
+    // Collect the ready topics, then re-enter them under the new policy
+    std::vector<TopicQueue*> ready;
+    while (!m_ready.empty()) {
+        ready.push_back(m_ready.top().queue);
+        m_ready.pop();
+    }
+    ready.insert(ready.end(), m_roundRobin.begin(), m_roundRobin.end());
+    m_roundRobin.clear();
+
+    m_policy = policy;
+    for (TopicQueue* topicQueue : ready) {
+        topicQueue->ready = false;
+        topicQueue->deficit = 0;
+        markReadyIfIdle(topicQueue);
+    }
+}
+
+void DispatchQueue::setTopicWeight(const std::string& topic, uint32_t weight) {
+    topicQueueFor(topic)->weight = weight > 0 ? weight : 1;
+}
+
+void DispatchQueue::setCoalescing(const std::string& topic, bool coalescing) {
+    auto it = m_topics.find(topic);
+    if (it == m_topics.end()) {
+        return;
+    }
+
+    TopicQueue* topicQueue = it->second.get();
+    topicQueue->coalescing = coalescing;
+    if (!coalescing || topicQueue->entries.size() <= 1) {
+        return;
+    }
+
+    // Collapse the message backlog into the newest value at the oldest
+    // message position; tasks are kept in place
+    std::deque<DispatchEntry> collapsed;
+    DispatchEntry* kept = nullptr;
+    std::size_t dropped = 0;
+    for (auto& entry : topicQueue->entries) {
+        if (entry.task) {
+            collapsed.push_back(std::move(entry));
+        } else if (!kept) {
+            collapsed.push_back(std::move(entry));
+            kept = &collapsed.back();
+        } else {
+            kept->message = std::move(entry.message);
+            ++dropped;
+        }
+    }
+    topicQueue->entries.swap(collapsed);
+    topicQueue->coalesced += dropped;
+    m_size -= dropped;
+}
+
+std::vector<TopicLoad> DispatchQueue::sampleLoad() {
+    std::vector<TopicLoad> loads;
+    for (auto& topic : m_topics) {
+        TopicQueue* topicQueue = topic.second.get();
+        if (topicQueue->produced == 0 && topicQueue->consumed == 0 && !topicQueue->coalescing) {
+            continue;
+        }
+
+        TopicLoad load;
+        load.topic = topic.first;
+        load.produced = topicQueue->produced;
+        load.consumed = topicQueue->consumed;
+        load.coalesced = topicQueue->coalesced;
+        load.backlog = topicQueue->entries.size();
+        load.coalescing = topicQueue->coalescing;
+        loads.push_back(std::move(load));
+
+        topicQueue->produced = 0;
+        topicQueue->consumed = 0;
+        topicQueue->coalesced = 0;
+    }
+    return loads;
+}
+
+bool DispatchQueue::tryPop(DispatchEntry& entry, TopicQueue*& topicQueue) {
+    while (!m_ready.empty() || !m_roundRobin.empty()) {
+        TopicQueue* candidate = nullptr;
+        if (m_policy == SchedulingPolicy::DEFICIT_ROUND_ROBIN) {
+            candidate = m_roundRobin.front();
+            m_roundRobin.pop_front();
+        } else {
+            candidate = m_ready.top().queue;
+            m_ready.pop();
+        }
+        candidate->ready = false;
+
+        // A topic may have been emptied by clear() after it became ready
+        if (candidate->entries.empty()) {
+            continue;
+        }
+
+        // A topic starting a new turn gets its weight in messages
+        if (candidate->deficit == 0) {
+            candidate->deficit = candidate->weight;
+        }
+        candidate->deficit--;
+
+        entry = std::move(candidate->entries.front());
+        candidate->entries.pop_front();
+        candidate->inFlight = true;
+        candidate->consumed++;
+        --m_size;
+
+        topicQueue = candidate;
+        return true;
+    }
+    return false;
+}
+
+void DispatchQueue::complete(TopicQueue* topicQueue) {
+    if (!topicQueue) {
+        return;
+    }
+    topicQueue->inFlight = false;
+    if (topicQueue->removed && topicQueue->entries.empty()) {
+        eraseTopic(topicQueue);
+        return;
+    }
+    markReadyIfIdle(topicQueue);
+}
+
+std::chrono::steady_clock::duration DispatchQueue::oldestReadyAge(
+    std::chrono::steady_clock::time_point now) const {
+    if (m_ready.empty() && m_roundRobin.empty()) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+
+    const TopicQueue* oldest = m_policy == SchedulingPolicy::DEFICIT_ROUND_ROBIN
+        ? m_roundRobin.front() : m_ready.top().queue;
+    if (oldest->entries.empty()) {
+        return std::chrono::steady_clock::duration::zero();
+    }
+    return now - oldest->entries.front().enqueueTime;
+}
+
+void DispatchQueue::clear() {
+    while (!m_ready.empty()) {
+        m_ready.pop();
+    }
+    m_roundRobin.clear();
+    m_topicsByHash.clear();
+
+    // In-flight topics are erased by complete()
+    for (auto it = m_topics.begin(); it != m_topics.end();) {
+        TopicQueue* topicQueue = it->second.get();
+        if (topicQueue->inFlight) {
+            topicQueue->entries.clear();
+            topicQueue->ready = false;
+            topicQueue->removed = true;
+            ++it;
+        } else {
+            it = m_topics.erase(it);
+        }
+    }
+    m_size = 0;
+}
+
+DispatchQueue::TopicQueue* DispatchQueue::topicQueueFor(const std::string& topic) {
+    auto& slot = m_topics[topic];
+    if (!slot) {
+        slot.reset(new TopicQueue());
+        slot->name = topic;
+    }
+    slot->removed = false;
+    return slot.get();
+}
+
+DispatchQueue::TopicQueue* DispatchQueue::topicQueueFor(const MCPMessage_V1& message) {
+    if (message.topicHash != 0) {
+        auto it = m_topicsByHash.find(message.topicHash);
+        if (it != m_topicsByHash.end()) {
+            return it->second;
+        }
+    }
+    return topicQueueFor(message.topic);
+}
+
+void DispatchQueue::eraseTopic(TopicQueue* topicQueue) {
+    for (auto it = m_topicsByHash.begin(); it != m_topicsByHash.end();) {
+        if (it->second == topicQueue) {
+            it = m_topicsByHash.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    std::string name = topicQueue->name;
+    m_topics.erase(name);
+}
+
+void DispatchQueue::markReadyIfIdle(TopicQueue* topicQueue) {
+    if (topicQueue->inFlight || topicQueue->ready) {
+        return;
+    }
+    if (topicQueue->entries.empty()) {
+        // An idle topic does not bank unused turn credit
+        topicQueue->deficit = 0;
+        return;
+    }
+    topicQueue->ready = true;
+
+    if (m_policy == SchedulingPolicy::DEFICIT_ROUND_ROBIN) {
+        // Continue an unfinished turn, otherwise wait for the next round
+        if (topicQueue->deficit > 0) {
+            m_roundRobin.push_front(topicQueue);
+        } else {
+            m_roundRobin.push_back(topicQueue);
+        }
+        return;
+    }
+
+    const DispatchEntry& head = topicQueue->entries.front();
+    m_ready.push(ReadyTopic{head.deadline, head.sequence, topicQueue});
+}
+
+} // namespace mcp
@@ -0,0 +1,143 @@
+#include "mcp/MCPErrorReports.h"
+#include <chrono>
+#include <cstring>
+
+namespace mcp {
+
+namespace {
+    std::size_t boundedLength(const char* text, std::size_t limit) {
+        std::size_t length = 0;
+        while (length < limit && text[length] != '\0') {
+            ++length;
+        }
+        return length;
+    }
+
+    // Copy a possibly null string, truncated to the buffer and null-terminated
+    void copyTruncated(char* buffer, std::size_t capacity, const char* text) {
+        std::size_t length = text ? boundedLength(text, capacity - 1) : 0;
+        if (length > 0) {
+            std::memcpy(buffer, text, length);
+        }
+        buffer[length] = '\0';
+    }
+
+    // Append a string to a null-terminated buffer holding length characters,
+    // truncated to the buffer; returns the new length
+    std::size_t appendTruncated(char* buffer, std::size_t capacity, std::size_t length, const char* text) {
+        std::size_t added = boundedLength(text, capacity - 1 - length);
+        std::memcpy(buffer + length, text, added);
+        length += added;
+        buffer[length] = '\0';
+        return length;
+    }
+
+    // Key of a (source, code) pair; never 0, which marks a free slot
+    uint64_t errorKey(const char* source, const char* code, std::size_t sourceLimit, std::size_t codeLimit) {
+        uint64_t sourceHash = hashTopicName(source, boundedLength(source, sourceLimit));
+        uint64_t codeHash = hashTopicName(code, boundedLength(code, codeLimit));
+        uint64_t key = sourceHash ^ (codeHash * 0x9e3779b97f4a7c15ull);
+        return key != 0 ? key : 1;
+    }
+}
+
+ErrorCollector::ErrorCollector() : m_pending(false), m_dropped(0) {
+    for (Slot& slot : m_slots) {
+        slot.key.store(0, std::memory_order_relaxed);
+        slot.ready.store(false, std::memory_order_relaxed);
+        slot.count.store(0, std::memory_order_relaxed);
+        slot.total.store(0, std::memory_order_relaxed);
+        slot.severity = ErrorSeverity::WARNING;
+        slot.source[0] = slot.code[0] = slot.message[0] = slot.topic[0] = '\0';
+    }
+}
+
+bool ErrorCollector::report(const char* source, const char* code, ErrorSeverity severity,
+                            const char* message, const char* topic, const char* subscriber) noexcept {
+    if (!source) {
+        source = "";
+    }
+    if (!code) {
+        code = "";
+    }
+
+    // Keys are compared on the truncated strings, like the stored ones
+    uint64_t key = errorKey(source, code, MAX_SOURCE - 1, MAX_CODE - 1);
+
+    // Open addressing with linear probing; slots are never freed, so a key
+    // found once stays at the same slot
+    for (std::size_t probe = 0; probe < CAPACITY; ++probe) {
+        Slot& slot = m_slots[(key + probe) % CAPACITY];
+        uint64_t current = slot.key.load(std::memory_order_acquire);
+        if (current == 0) {
+            if (slot.key.compare_exchange_strong(current, key, std::memory_order_acq_rel)) {
+                slot.severity = severity;
+                copyTruncated(slot.source, MAX_SOURCE, source);
+                copyTruncated(slot.code, MAX_CODE, code);
+                copyTruncated(slot.message, MAX_MESSAGE, message);
+                if (subscriber) {
+                    std::size_t length = boundedLength(slot.message, MAX_MESSAGE - 1);
+                    length = appendTruncated(slot.message, MAX_MESSAGE, length, " (subscriber ");
+                    length = appendTruncated(slot.message, MAX_MESSAGE, length, subscriber);
+                    appendTruncated(slot.message, MAX_MESSAGE, length, ")");
+                }
+                copyTruncated(slot.topic, MAX_TOPIC, topic);
+                slot.ready.store(true, std::memory_order_release);
+                current = key;
+            }
+        }
+        if (current != key) {
+            continue;
+        }
+
+        slot.total.fetch_add(1, std::memory_order_relaxed);
+        slot.count.fetch_add(1, std::memory_order_release);
+        return !m_pending.exchange(true, std::memory_order_acq_rel);
+    }
+
+    m_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+bool ErrorCollector::pending() const noexcept {
+    return m_pending.load(std::memory_order_acquire);
+}
+
+std::size_t ErrorCollector::collect(std::vector<ErrorReport>& reports) {
+    // Cleared first, so reports racing with the sweep raise it again
+    m_pending.store(false, std::memory_order_release);
+
+    uint64_t timestamp = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+
+    std::size_t added = 0;
+    for (Slot& slot : m_slots) {
+        // Counts of a slot still being claimed are picked up next time
+        if (!slot.ready.load(std::memory_order_acquire)) {
+            continue;
+        }
+        uint64_t count = slot.count.exchange(0, std::memory_order_acq_rel);
+        if (count == 0) {
+            continue;
+        }
+
+        ErrorReport report;
+        report.source = slot.source;
+        report.code = slot.code;
+        report.severity = slot.severity;
+        report.message = slot.message;
+        report.topic = slot.topic;
+        report.count = count;
+        report.total = slot.total.load(std::memory_order_relaxed);
+        report.timestamp = timestamp;
+        reports.push_back(std::move(report));
+        ++added;
+    }
+    return added;
+}
+
+uint64_t ErrorCollector::getDroppedCount() const noexcept {
+    return m_dropped.load(std::memory_order_relaxed);
+}
+
+} // namespace mcp
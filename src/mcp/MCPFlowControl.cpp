@@ -0,0 +1,138 @@
+#include "mcp/MCPFlowControl.h"
+#include <algorithm>
+
+namespace mcp {
+
+DeliveryCredits::DeliveryCredits(uint32_t initial)
+    : m_available(initial), m_dropped(0), m_conflated(0), m_waiting(false),
+      m_wakeupOwner(nullptr) {
+    m_wakeupLock.clear();
+}
+
+void DeliveryCredits::grant(uint32_t count) {
+    // Sequentially consistent with acquireOrWait(): either its second look
+    // sees these credits or this sees its waiting flag
+    m_available.fetch_add(count);
+    if (!m_waiting.load() || !m_waiting.exchange(false)) {
+        return;
+    }
+
+    while (m_wakeupLock.test_and_set(std::memory_order_acquire)) {
+    }
+    if (m_wakeup) {
+        m_wakeup();
+    }
+    m_wakeupLock.clear(std::memory_order_release);
+}
+
+bool DeliveryCredits::tryAcquire() {
+    uint32_t available = m_available.load();
+    while (available > 0) {
+        if (m_available.compare_exchange_weak(available, available - 1)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DeliveryCredits::acquireOrWait() {
+    if (tryAcquire()) {
+        return true;
+    }
+
+    // Look again after raising the flag, so a grant in between is not missed
+    m_waiting.store(true);
+    return tryAcquire();
+}
+
+void DeliveryCredits::setWakeup(const void* owner, std::function<void()> wakeup) {
+    while (m_wakeupLock.test_and_set(std::memory_order_acquire)) {
+    }
+    m_wakeup.swap(wakeup);
+    m_wakeupOwner = owner;
+    m_wakeupLock.clear(std::memory_order_release);
+}
+
+void DeliveryCredits::clearWakeup(const void* owner) {
+    std::function<void()> previous;
+    while (m_wakeupLock.test_and_set(std::memory_order_acquire)) {
+    }
+    if (m_wakeupOwner == owner) {
+        m_wakeup.swap(previous);
+        m_wakeupOwner = nullptr;
+    }
+    m_wakeupLock.clear(std::memory_order_release);
+}
+
+CreditGate::CreditGate(std::shared_ptr<DeliveryCredits> credits, CreditPolicy policy,
+                       std::size_t maxHeld)
+    : m_credits(credits), m_policy(policy), m_maxHeld(std::max<std::size_t>(1, maxHeld)),
+      m_retryPending(false), m_closed(false) {}
+
+bool CreditGate::admit(const std::shared_ptr<MCPMessage_V1>& message) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_closed) {
+        return false;
+    }
+    if (m_held.empty() && m_credits->acquireOrWait()) {
+        return true;
+    }
+
+    switch (m_policy) {
+        case CreditPolicy::DROP:
+            m_credits->m_dropped.fetch_add(1, std::memory_order_relaxed);
+            break;
+        case CreditPolicy::CONFLATE:
+            if (!m_held.empty()) {
+                m_credits->m_conflated.fetch_add(m_held.size(), std::memory_order_relaxed);
+                m_held.clear();
+            }
+            m_held.push_back(message);
+            break;
+        case CreditPolicy::HOLD:
+        default:
+            if (m_held.size() >= m_maxHeld) {
+                m_held.pop_front();
+                m_credits->m_dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+            m_held.push_back(message);
+            break;
+    }
+    return false;
+}
+
+bool CreditGate::release(std::vector<std::shared_ptr<MCPMessage_V1>>& released) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    while (!m_held.empty() && m_credits->acquireOrWait()) {
+        released.push_back(std::move(m_held.front()));
+        m_held.pop_front();
+    }
+
+    if (m_held.empty()) {
+        m_retryPending = false;
+        return false;
+    }
+    return true;
+}
+
+bool CreditGate::claimRetry() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_held.empty() || m_retryPending) {
+        return false;
+    }
+    m_retryPending = true;
+    return true;
+}
+
+void CreditGate::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    m_held.clear();
+}
+
+std::size_t CreditGate::heldCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_held.size();
+}
+
+} // namespace mcp
@@ -0,0 +1,133 @@
+#include "mcp/MCPPreparedPublication.h"
+#include "mcp/MCPBroker.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+namespace mcp {
+
+namespace {
+    // Messages of a topic that the broker itself keeps referenced
+    std::size_t retainedByBroker(const std::shared_ptr<IMCPBroker>& broker, const std::string& topic) {
+        auto mcpBroker = std::dynamic_pointer_cast<MCPBroker>(broker);
+        if (!mcpBroker) {
+            return 0;
+        }
+
+        std::size_t retained = 0;
+        if (auto history = mcpBroker->getTopicHistory(topic)) {
+            retained += history->getConfig().maxMessages;
+        }
+        if (mcpBroker->getTopicKind(topic) == TopicKind::STATE) {
+            retained += 1;
+        }
+        return retained;
+    }
+}
+
+PreparedPublication::PreparedPublication(std::shared_ptr<IMCPBroker> broker,
+                                         const std::string& topic,
+                                         int senderModuleId,
+                                         const std::string& dataFormat,
+                                         std::size_t maxPayloadSize,
+                                         std::size_t initialSlots,
+                                         std::size_t maxSlots)
+    : m_broker(broker),
+      m_topic(topic),
+      m_topicHash(0),
+      m_senderModuleId(senderModuleId),
+      m_dataFormat(dataFormat),
+      m_maxPayloadSize(maxPayloadSize),
+      m_maxSlots(std::max<std::size_t>(1, maxSlots) + retainedByBroker(broker, topic)),
+      m_nextSlot(0),
+      m_nextMessageId(1),
+      m_published(0),
+      m_replaced(0) {
+    // Reserve the whole pool so growing it never reallocates the slot array
+    m_slots.reserve(m_maxSlots);
+    for (std::size_t i = 0; i < std::min(initialSlots, m_maxSlots); ++i) {
+        m_slots.push_back(createSlot());
+    }
+}
+
+PreparedPublication::PreparedPublication(std::shared_ptr<IMCPBroker> broker,
+                                         const TopicLiteral& topic,
+                                         int senderModuleId,
+                                         const std::string& dataFormat,
+                                         std::size_t maxPayloadSize,
+                                         std::size_t initialSlots,
+                                         std::size_t maxSlots)
+    : PreparedPublication(broker, topic.str(), senderModuleId, dataFormat,
+                          maxPayloadSize, initialSlots, maxSlots) {
+    m_topicHash = topic.hash();
+    for (auto& slot : m_slots) {
+        slot->topicHash = m_topicHash;
+    }
+}
+
+bool PreparedPublication::publishBytes(const void* payload, std::size_t size) {
+    if (!payload || size == 0 || size > m_maxPayloadSize) {
+        return false;
+    }
+
+    std::shared_ptr<MCPMessage_V1>* slot = acquireSlot();
+    if (!slot) {
+        return false;
+    }
+
+    std::memcpy((*slot)->data.get(), payload, size);
+    return commit(*slot, size);
+}
+
+std::shared_ptr<MCPMessage_V1>* PreparedPublication::acquireSlot() {
+    // Round-robin so the message released longest ago is tried first
+    for (std::size_t i = 0; i < m_slots.size(); ++i) {
+        std::size_t index = (m_nextSlot + i) % m_slots.size();
+        auto& slot = m_slots[index];
+
+        // Free once the broker and every subscriber dropped the message and its data
+        if (slot.use_count() == 1 && slot->data.use_count() == 1) {
+            // Pairs with the release in the last owner's shared_ptr destructor
+            std::atomic_thread_fence(std::memory_order_acquire);
+            m_nextSlot = (index + 1) % m_slots.size();
+            return &slot;
+        }
+    }
+
+    if (m_slots.size() < m_maxSlots) {
+        m_slots.push_back(createSlot());
+        m_nextSlot = 0;
+        return &m_slots.back();
+    }
+
+    // Every pooled message is still held (e.g. by a credit gate holding
+    // messages); leave the oldest to its holders rather than drop the publish
+    auto& slot = m_slots[m_nextSlot];
+    slot = createSlot();
+    m_nextSlot = (m_nextSlot + 1) % m_slots.size();
+    m_replaced++;
+    return &slot;
+}
+
+std::shared_ptr<MCPMessage_V1> PreparedPublication::createSlot() const {
+    std::shared_ptr<void> buffer(new uint8_t[std::max<std::size_t>(1, m_maxPayloadSize)],
+                                 [](void* p) { delete[] static_cast<uint8_t*>(p); });
+    auto message = std::make_shared<MCPMessage_V1>(m_topic, m_senderModuleId, m_dataFormat, buffer, 0);
+    message->topicHash = m_topicHash;
+    return message;
+}
+
+bool PreparedPublication::commit(std::shared_ptr<MCPMessage_V1>& slot, std::size_t size) {
+    slot->dataSize = size;
+    slot->messageId = m_nextMessageId++;
+    slot->timestamp = std::chrono::steady_clock::now();
+
+    if (!m_broker || !m_broker->publish(slot)) {
+        return false;
+    }
+    m_published++;
+    return true;
+}
+
+} // namespace mcp
@@ -0,0 +1,101 @@
+#include "mcp/MCPPyramid.h"
+#include <algorithm>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define MCP_PYRAMID_SSE 1
+#endif
+
+namespace mcp {
+
+MinMaxPyramid::MinMaxPyramid(const std::vector<float>& samples, std::size_t minResolution) {
+    minResolution = std::max<std::size_t>(1, minResolution);
+    if (samples.size() <= minResolution) {
+        return;
+    }
+
+    // The raw samples act as level -1 with min == max == mean
+    const float* minIn = samples.data();
+    const float* maxIn = samples.data();
+    const float* meanIn = samples.data();
+    std::size_t count = samples.size();
+    uint32_t binSize = 1;
+
+    while (count > minResolution) {
+        MinMaxLevel level;
+        std::size_t bins = (count + 1) / 2;
+        level.min.resize(bins);
+        level.max.resize(bins);
+        level.mean.resize(bins);
+        level.binSize = binSize * 2;
+        level.sourceSize = static_cast<uint32_t>(samples.size());
+
+        decimate(minIn, maxIn, meanIn, count, level.min.data(), level.max.data(), level.mean.data());
+        m_levels.push_back(std::move(level));
+
+        const MinMaxLevel& built = m_levels.back();
+        minIn = built.min.data();
+        maxIn = built.max.data();
+        meanIn = built.mean.data();
+        count = bins;
+        binSize = built.binSize;
+    }
+}
+
+int MinMaxPyramid::selectLevel(std::size_t targetResolution) const {
+    int selected = -1;
+    for (std::size_t i = 0; i < m_levels.size(); ++i) {
+        if (m_levels[i].size() < targetResolution) {
+            break;
+        }
+        selected = static_cast<int>(i);
+    }
+    return selected;
+}
+
+void MinMaxPyramid::decimate(const float* minIn, const float* maxIn, const float* meanIn,
+                             std::size_t count,
+                             float* minOut, float* maxOut, float* meanOut) {
+    std::size_t pairs = count / 2;
+    std::size_t i = 0;
+
+#ifdef MCP_PYRAMID_SSE
+    // 8 input bins -> 4 output bins per iteration: split into even and odd
+    // lanes, then combine lane-wise
+    const __m128 half = _mm_set1_ps(0.5f);
+    for (; i + 4 <= pairs; i += 4) {
+        __m128 minA = _mm_loadu_ps(minIn + 2 * i);
+        __m128 minB = _mm_loadu_ps(minIn + 2 * i + 4);
+        __m128 maxA = _mm_loadu_ps(maxIn + 2 * i);
+        __m128 maxB = _mm_loadu_ps(maxIn + 2 * i + 4);
+        __m128 meanA = _mm_loadu_ps(meanIn + 2 * i);
+        __m128 meanB = _mm_loadu_ps(meanIn + 2 * i + 4);
+
+        __m128 minEven = _mm_shuffle_ps(minA, minB, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 minOdd = _mm_shuffle_ps(minA, minB, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 maxEven = _mm_shuffle_ps(maxA, maxB, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 maxOdd = _mm_shuffle_ps(maxA, maxB, _MM_SHUFFLE(3, 1, 3, 1));
+        __m128 meanEven = _mm_shuffle_ps(meanA, meanB, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 meanOdd = _mm_shuffle_ps(meanA, meanB, _MM_SHUFFLE(3, 1, 3, 1));
+
+        _mm_storeu_ps(minOut + i, _mm_min_ps(minEven, minOdd));
+        _mm_storeu_ps(maxOut + i, _mm_max_ps(maxEven, maxOdd));
+        _mm_storeu_ps(meanOut + i, _mm_mul_ps(_mm_add_ps(meanEven, meanOdd), half));
+    }
+#endif
+
+    // Scalar path for the remainder (or everything without SSE)
+    for (; i < pairs; ++i) {
+        minOut[i] = std::min(minIn[2 * i], minIn[2 * i + 1]);
+        maxOut[i] = std::max(maxIn[2 * i], maxIn[2 * i + 1]);
+        meanOut[i] = (meanIn[2 * i] + meanIn[2 * i + 1]) * 0.5f;
+    }
+
+    if (count % 2 != 0) {
+        minOut[pairs] = minIn[count - 1];
+        maxOut[pairs] = maxIn[count - 1];
+        meanOut[pairs] = meanIn[count - 1];
+    }
+}
+
+} // namespace mcp
@@ -61,10 +61,12 @@ void MCPReferenceProvider::onAdd() {
         return;
     }
     
-    // Register for all topics
-    for (const auto& topic : m_topics) {
-        broker->registerContext(topic, selfPtr);
-        std::cout << "Provider " << getId() << " registered for topic: " << topic << std::endl;
+    // Register for all topics under one registry lock; only failures are
+    // logged so loading a large patch stays quiet
+    std::size_t registered = broker->registerContexts(m_topics, selfPtr);
+    if (registered < m_topics.size()) {
+        std::cerr << "Provider " << getId() << " registered for " << registered
+                  << " of " << m_topics.size() << " topics" << std::endl;
     }
     
     // Start publishing thread with 1 second interval
@@ -238,8 +240,11 @@ void MCPReferenceProvider::publishThreadFunc() {
             }
         }
         catch (const std::exception& e) {
-            std::cerr << "Error in publisher thread: " << e.what() << std::endl;
-            // Continue running despite error
+            // Report and continue running despite the error
+            if (auto broker = MCPBroker::getInstance()) {
+                broker->reportError("mcp.reference-provider", ErrorCode::DISPATCH_FAILED,
+                                    ErrorSeverity::WARNING, e.what());
+            }
         }
         
         // Wait for the specified interval or until stopped
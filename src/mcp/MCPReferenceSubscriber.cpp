@@ -1,10 +1,14 @@
 #include "mcp/MCPReferenceSubscriber.h"
 #include <iostream>
+#include <cmath>
+#include <cstring>
 
 namespace mcp {
 
+const uint32_t MCPReferenceSubscriber::QUEUE_CAPACITY;
+
 MCPReferenceSubscriber::MCPReferenceSubscriber(int id)
-    : rack::Module(id) {
+    : rack::Module(id), m_credits(std::make_shared<DeliveryCredits>(QUEUE_CAPACITY)) {
     // Initialize with default topics
     m_subscribedTopics = {
         "reference/parameter1", 
@@ -22,6 +26,13 @@ MCPReferenceSubscriber::~MCPReferenceSubscriber() {
     // This avoids using shared_from_this during destruction, which can cause bad_weak_ptr
 }
 
+SubscriptionOptions MCPReferenceSubscriber::subscriptionOptions() const {
+    SubscriptionOptions options;
+    options.credits = m_credits;
+    options.creditPolicy = CreditPolicy::CONFLATE;
+    return options;
+}
+
 void MCPReferenceSubscriber::onAdd() {
     rack::Module::onAdd();
     
@@ -31,6 +42,7 @@ void MCPReferenceSubscriber::onAdd() {
         std::cerr << "Failed to get broker instance" << std::endl;
         return;
     }
+    m_broker = broker;
     
     // Create a shared_ptr to this
     auto selfPtr = std::dynamic_pointer_cast<IMCPSubscriber_V1>(rack::Module::shared_from_this());
@@ -39,13 +51,12 @@ void MCPReferenceSubscriber::onAdd() {
         return;
     }
     
-    // Subscribe to all topics
-    for (const auto& topic : m_subscribedTopics) {
-        if (broker->subscribe(topic, selfPtr)) {
-            std::cout << "Subscriber " << getId() << " subscribed to topic: " << topic << std::endl;
-        } else {
-            std::cerr << "Failed to subscribe to topic: " << topic << std::endl;
-        }
+    // Subscribe to all topics under one subscription lock; only failures
+    // are logged so loading a large patch stays quiet
+    std::size_t subscribed = broker->subscribeMany(m_subscribedTopics, selfPtr, subscriptionOptions());
+    if (subscribed < m_subscribedTopics.size()) {
+        std::cerr << "Subscriber " << getId() << " subscribed to " << subscribed
+                  << " of " << m_subscribedTopics.size() << " topics" << std::endl;
     }
 }
 
@@ -90,6 +101,8 @@ void MCPReferenceSubscriber::process(float* outputs, int frames) {
     
     // Process up to MAX_MESSAGES_PER_CYCLE messages per audio cycle
     while (messagesProcessedThisCycle < MAX_MESSAGES_PER_CYCLE && m_messageQueue.pop(message)) {
+        // The slot is free again; let the broker fill it
+        m_credits->grant();
         hasNewMessages = true;
         m_messagesProcessed.fetch_add(1);
         messagesProcessedThisCycle++;
@@ -118,7 +131,7 @@ void MCPReferenceSubscriber::process(float* outputs, int frames) {
                 }
             }
         } catch (const std::runtime_error& e) {
-            std::cerr << "Error processing message data: " << e.what() << std::endl;
+            recordAudioError(ErrorCode::SERIALIZATION_FAILED, e.what(), message.topic.c_str());
         }
     }
     
@@ -191,6 +204,12 @@ void MCPReferenceSubscriber::onMCPMessage(const MCPMessage_V1* message) {
         std::cerr << "Warning: onMCPMessage() called from audio thread!" << std::endl;
     }
     
+    // With more than one dispatch worker, callbacks for different topics can
+    // run at the same time; the ring buffer has a single producer, so
+    // producers take turns (the audio thread never takes this lock)
+    std::lock_guard<std::mutex> producerLock(m_producerMutex);
+    forwardAudioError();
+    
     // Count received messages
     m_totalMessagesReceived.fetch_add(1);
     
@@ -215,7 +234,8 @@ void MCPReferenceSubscriber::onMCPMessage(const MCPMessage_V1* message) {
             std::vector<float> value = serialization::extractMessageData<std::vector<float>>(message);
             receivedMsg.data = value;
         } else {
-            // Unknown topic, ignore
+            // Unknown topic, ignore and return the unused credit
+            m_credits->grant();
             return;
         }
         
@@ -225,8 +245,50 @@ void MCPReferenceSubscriber::onMCPMessage(const MCPMessage_V1* message) {
             m_queueOverflows.fetch_add(1);
         }
     } catch (const MCPSerializationError& e) {
-        std::cerr << "Error deserializing message: " << e.what() << std::endl;
+        reportError(ErrorCode::SERIALIZATION_FAILED, e.what(), message->topic.c_str());
+        m_credits->grant();
+    }
+}
+
+void MCPReferenceSubscriber::reportError(const char* code, const char* message, const char* topic) const {
+    if (auto broker = m_broker.lock()) {
+        broker->reportError("mcp.reference-subscriber", code, ErrorSeverity::WARNING, message, topic);
+    }
+}
+
+void MCPReferenceSubscriber::recordAudioError(const char* code, const char* message, const char* topic) {
+    if (!m_audioError.ready.load(std::memory_order_acquire)) {
+        m_audioError.code = code;
+        std::strncpy(m_audioError.message, message, sizeof(m_audioError.message) - 1);
+        m_audioError.message[sizeof(m_audioError.message) - 1] = '\0';
+        std::strncpy(m_audioError.topic, topic, sizeof(m_audioError.topic) - 1);
+        m_audioError.topic[sizeof(m_audioError.topic) - 1] = '\0';
+        m_audioError.ready.store(true, std::memory_order_release);
+    }
+    m_audioError.count.fetch_add(1, std::memory_order_relaxed);
+}
+
+void MCPReferenceSubscriber::forwardAudioError() {
+    if (!m_audioError.ready.load(std::memory_order_acquire)) {
+        return;
     }
+    
+    // Every occurrence is reported, so the broker's counts stay right
+    uint32_t count = m_audioError.count.exchange(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < count; ++i) {
+        reportError(m_audioError.code, m_audioError.message, m_audioError.topic);
+    }
+    m_audioError.ready.store(false, std::memory_order_release);
+}
+
+int MCPReferenceSubscriber::getMessageCount(const std::string& topic) const {
+    std::lock_guard<std::mutex> producerLock(m_producerMutex);
+    auto it = m_messageCountsByTopic.find(topic);
+    return it != m_messageCountsByTopic.end() ? it->second : 0;
+}
+
+int MCPReferenceSubscriber::getTotalMessagesReceived() const {
+    return m_totalMessagesReceived.load();
 }
 
 bool MCPReferenceSubscriber::subscribeToTopic(const std::string& topic) {
@@ -249,7 +311,7 @@ bool MCPReferenceSubscriber::subscribeToTopic(const std::string& topic) {
     }
     
     // Subscribe
-    if (broker->subscribe(topic, selfPtr)) {
+    if (broker->subscribe(topic, selfPtr, subscriptionOptions())) {
         m_subscribedTopics.push_back(topic);
         std::cout << "Subscriber " << getId() << " subscribed to topic: " << topic << std::endl;
         return true;
@@ -0,0 +1,108 @@
+#include "mcp/MCPSequencedLog.h"
+#include "mcp/MCPBroker.h"
+#include <chrono>
+#include <typeinfo>
+
+namespace mcp {
+
+namespace {
+    // Idle polls before the adapter thread starts yielding, then sleeping
+    const int SPIN_POLLS = 64;
+    const int YIELD_POLLS = 1024;
+}
+
+SequencedLogSubscriber::SequencedLogSubscriber(SequencedMessageLog& log,
+                                               std::shared_ptr<IMCPSubscriber_V1> subscriber,
+                                               const std::string& topic,
+                                               std::weak_ptr<MCPBroker> broker)
+    : m_log(log),
+      m_subscriber(subscriber),
+      m_topic(topic),
+      m_broker(broker),
+      m_consumer(log.addConsumer()),
+      m_running(false),
+      m_delivered(0) {}
+
+SequencedLogSubscriber::~SequencedLogSubscriber() {
+    stop();
+    m_log.removeConsumer(m_consumer);
+}
+
+std::size_t SequencedLogSubscriber::drain(std::size_t maxBatch) {
+    std::size_t total = 0;
+    std::size_t consumed = 0;
+    while ((consumed = pollOnce(maxBatch)) > 0) {
+        total += consumed;
+    }
+    return total;
+}
+
+void SequencedLogSubscriber::start() {
+    if (!m_consumer || m_running.exchange(true)) {
+        return;
+    }
+    m_thread = std::thread(&SequencedLogSubscriber::run, this);
+}
+
+void SequencedLogSubscriber::stop() {
+    if (!m_running.exchange(false)) {
+        return;
+    }
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+std::size_t SequencedLogSubscriber::pollOnce(std::size_t maxBatch) {
+    if (!m_consumer) {
+        return 0;
+    }
+
+    // Keep the subscriber alive for the whole batch
+    auto subscriber = m_subscriber.lock();
+    uint64_t delivered = 0;
+
+    std::size_t consumed = m_consumer->poll(
+        [&](const std::shared_ptr<MCPMessage_V1>& message, uint64_t, bool) {
+            if (!subscriber || !message || (!m_topic.empty() && message->topic != m_topic)) {
+                return;
+            }
+            try {
+                subscriber->onMCPMessage(message.get());
+                delivered++;
+            } catch (const std::exception& e) {
+                // A failing callback must not stall the cursor
+                if (auto broker = m_broker.lock()) {
+                    broker->reportError("mcp.sequenced-log", ErrorCode::SUBSCRIBER_FAILED,
+                                        ErrorSeverity::WARNING, e.what(), message->topic.c_str(),
+                                        typeid(*subscriber).name());
+                }
+            }
+        },
+        maxBatch);
+
+    m_delivered.fetch_add(delivered, std::memory_order_relaxed);
+    return consumed;
+}
+
+void SequencedLogSubscriber::run() {
+    int idlePolls = 0;
+    while (m_running.load(std::memory_order_acquire)) {
+        if (pollOnce(0) > 0) {
+            idlePolls = 0;
+            continue;
+        }
+
+        // Back off gradually so an idle log costs almost nothing
+        ++idlePolls;
+        if (idlePolls < SPIN_POLLS) {
+            continue;
+        } else if (idlePolls < YIELD_POLLS) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+}
+
+} // namespace mcp
@@ -1,5 +1,7 @@
 #include "mcp/MCPSerialization.h"
 #include "mcp/MCPMessage_V1.h"
+#include "mcp/MCPPyramid.h"
+#include "mcp/MCPErrorReports.h"
 
 // Include msgpack11
 #include "../external/msgpack11/msgpack11.hpp"
@@ -35,6 +37,23 @@ namespace {
         const uint8_t* byteData = static_cast<const uint8_t*>(data);
         return std::vector<uint8_t>(byteData, byteData + dataSize);
     }
+    
+    // Write an integral value in big-endian byte order (MessagePack wire order)
+    template<typename U>
+    uint8_t* writeBigEndian(uint8_t* out, U value) {
+        for (int i = static_cast<int>(sizeof(U)) - 1; i >= 0; --i) {
+            *out++ = static_cast<uint8_t>(value >> (8 * i));
+        }
+        return out;
+    }
+    
+    // Write a MessagePack float64, the encoding msgpack11 uses for doubles
+    uint8_t* writeFloat64(uint8_t* out, double value) {
+        uint64_t bits = 0;
+        std::memcpy(&bits, &value, sizeof(bits));
+        *out++ = 0xcb;
+        return writeBigEndian(out, bits);
+    }
 }
 
 // MessagePack Serialization
@@ -178,6 +197,97 @@ std::vector<float> convertFromMsgPack<std::vector<float>>(const msgpack11::MsgPa
     return result;
 }
 
+// Allocation-free MessagePack encoding (float specialization)
+template<>
+std::size_t encodeMsgPackInto<float>(const float& value, void* buffer, std::size_t capacity) {
+    if (!buffer || capacity < 9) {
+        return 0;
+    }
+    writeFloat64(static_cast<uint8_t*>(buffer), static_cast<double>(value));
+    return 9;
+}
+
+// Allocation-free MessagePack encoding (double specialization)
+template<>
+std::size_t encodeMsgPackInto<double>(const double& value, void* buffer, std::size_t capacity) {
+    if (!buffer || capacity < 9) {
+        return 0;
+    }
+    writeFloat64(static_cast<uint8_t*>(buffer), value);
+    return 9;
+}
+
+// Allocation-free MessagePack encoding (int specialization, always int32)
+template<>
+std::size_t encodeMsgPackInto<int>(const int& value, void* buffer, std::size_t capacity) {
+    if (!buffer || capacity < 5) {
+        return 0;
+    }
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    *out++ = 0xd2;
+    writeBigEndian(out, static_cast<uint32_t>(static_cast<int32_t>(value)));
+    return 5;
+}
+
+// Allocation-free MessagePack encoding (string specialization)
+template<>
+std::size_t encodeMsgPackInto<std::string>(const std::string& value, void* buffer, std::size_t capacity) {
+    const std::size_t length = value.size();
+    if (!buffer || length > 0xffffffffu) {
+        return 0;
+    }
+    
+    std::size_t header = length <= 0x1f ? 1 : (length <= 0xff ? 2 : (length <= 0xffff ? 3 : 5));
+    if (capacity < header + length) {
+        return 0;
+    }
+    
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    if (length <= 0x1f) {
+        *out++ = static_cast<uint8_t>(0xa0 | length);
+    } else if (length <= 0xff) {
+        *out++ = 0xd9;
+        *out++ = static_cast<uint8_t>(length);
+    } else if (length <= 0xffff) {
+        *out++ = 0xda;
+        out = writeBigEndian(out, static_cast<uint16_t>(length));
+    } else {
+        *out++ = 0xdb;
+        out = writeBigEndian(out, static_cast<uint32_t>(length));
+    }
+    std::memcpy(out, value.data(), length);
+    return header + length;
+}
+
+// Allocation-free MessagePack encoding (vector<float> specialization)
+template<>
+std::size_t encodeMsgPackInto<std::vector<float>>(const std::vector<float>& value, void* buffer, std::size_t capacity) {
+    const std::size_t count = value.size();
+    if (!buffer || count > 0xffffffffu) {
+        return 0;
+    }
+    
+    std::size_t header = count <= 15 ? 1 : (count <= 0xffff ? 3 : 5);
+    if (capacity < header + count * 9) {
+        return 0;
+    }
+    
+    uint8_t* out = static_cast<uint8_t*>(buffer);
+    if (count <= 15) {
+        *out++ = static_cast<uint8_t>(0x90 | count);
+    } else if (count <= 0xffff) {
+        *out++ = 0xdc;
+        out = writeBigEndian(out, static_cast<uint16_t>(count));
+    } else {
+        *out++ = 0xdd;
+        out = writeBigEndian(out, static_cast<uint32_t>(count));
+    }
+    for (float item : value) {
+        out = writeFloat64(out, static_cast<double>(item));
+    }
+    return header + count * 9;
+}
+
 // JSON Serialization - placeholder for now
 template<typename T>
 std::shared_ptr<void> serializeToJSON(const T& value, std::size_t& dataSize) {
@@ -325,5 +435,191 @@ template float deserializeFromMsgPack<float>(const void* data, std::size_t dataS
 template std::shared_ptr<MCPMessage_V1> createMsgPackMessage<float>(const std::string& topic, int senderModuleId, const float& value);
 template float extractMessageData<float>(const MCPMessage_V1* message);
 
+// Template specializations for MinMaxLevel (float32 items keep decimated levels compact)
+namespace {
+    msgpack11::MsgPack floatArray(const std::vector<float>& values) {
+        msgpack11::MsgPack::array array;
+        array.reserve(values.size());
+        for (float value : values) {
+            array.push_back(msgpack11::MsgPack(value));
+        }
+        return msgpack11::MsgPack(array);
+    }
+    
+    std::vector<float> floatArrayFrom(const msgpack11::MsgPack& msgpack) {
+        if (!msgpack.is_array()) {
+            throw MCPSerializationError("Expected array type in MessagePack data");
+        }
+        
+        std::vector<float> result;
+        result.reserve(msgpack.array_items().size());
+        for (const auto& item : msgpack.array_items()) {
+            if (!item.is_number()) {
+                throw MCPSerializationError("Expected number type in array");
+            }
+            result.push_back(static_cast<float>(item.number_value()));
+        }
+        return result;
+    }
+}
+
+template<>
+msgpack11::MsgPack convertToMsgPack<MinMaxLevel>(const MinMaxLevel& value) {
+    msgpack11::MsgPack::object object;
+    object[msgpack11::MsgPack("min")] = floatArray(value.min);
+    object[msgpack11::MsgPack("max")] = floatArray(value.max);
+    object[msgpack11::MsgPack("mean")] = floatArray(value.mean);
+    object[msgpack11::MsgPack("binSize")] = msgpack11::MsgPack(value.binSize);
+    object[msgpack11::MsgPack("sourceSize")] = msgpack11::MsgPack(value.sourceSize);
+    return msgpack11::MsgPack(object);
+}
+
+template<>
+MinMaxLevel convertFromMsgPack<MinMaxLevel>(const msgpack11::MsgPack& msgpack) {
+    if (!msgpack.is_object()) {
+        throw MCPSerializationError("Expected map type in MessagePack data");
+    }
+    
+    MinMaxLevel level;
+    level.min = floatArrayFrom(msgpack["min"]);
+    level.max = floatArrayFrom(msgpack["max"]);
+    level.mean = floatArrayFrom(msgpack["mean"]);
+    if (!msgpack["binSize"].is_number() || !msgpack["sourceSize"].is_number()) {
+        throw MCPSerializationError("Expected number type for level sizes");
+    }
+    level.binSize = msgpack["binSize"].uint32_value();
+    level.sourceSize = msgpack["sourceSize"].uint32_value();
+    return level;
+}
+
+// Explicit instantiations for MinMaxLevel
+template std::shared_ptr<void> serializeToMsgPack<MinMaxLevel>(const MinMaxLevel& value, std::size_t& dataSize);
+template MinMaxLevel deserializeFromMsgPack<MinMaxLevel>(const void* data, std::size_t dataSize);
+template std::shared_ptr<MCPMessage_V1> createMsgPackMessage<MinMaxLevel>(const std::string& topic, int senderModuleId, const MinMaxLevel& value);
+template MinMaxLevel extractMessageData<MinMaxLevel>(const MCPMessage_V1* message);
+
+namespace {
+    const char* severityName(ErrorSeverity severity) {
+        switch (severity) {
+            case ErrorSeverity::INFO:
+                return "info";
+            case ErrorSeverity::CRITICAL:
+                return "critical";
+            case ErrorSeverity::WARNING:
+            default:
+                return "warning";
+        }
+    }
+    
+    ErrorSeverity severityFrom(const std::string& name) {
+        if (name == "info") {
+            return ErrorSeverity::INFO;
+        }
+        if (name == "critical") {
+            return ErrorSeverity::CRITICAL;
+        }
+        return ErrorSeverity::WARNING;
+    }
+}
+
+template<>
+msgpack11::MsgPack convertToMsgPack<ErrorReport>(const ErrorReport& value) {
+    msgpack11::MsgPack::object context;
+    if (!value.topic.empty()) {
+        context[msgpack11::MsgPack("topic")] = msgpack11::MsgPack(value.topic);
+    }
+    
+    msgpack11::MsgPack::object data;
+    data[msgpack11::MsgPack("severity")] = msgpack11::MsgPack(severityName(value.severity));
+    data[msgpack11::MsgPack("code")] = msgpack11::MsgPack(value.code);
+    data[msgpack11::MsgPack("message")] = msgpack11::MsgPack(value.message);
+    data[msgpack11::MsgPack("count")] = msgpack11::MsgPack(value.count);
+    data[msgpack11::MsgPack("total")] = msgpack11::MsgPack(value.total);
+    data[msgpack11::MsgPack("context")] = msgpack11::MsgPack(context);
+    
+    msgpack11::MsgPack::object object;
+    object[msgpack11::MsgPack("type")] = msgpack11::MsgPack("error");
+    object[msgpack11::MsgPack("version")] = msgpack11::MsgPack("1.0");
+    object[msgpack11::MsgPack("timestamp")] = msgpack11::MsgPack(value.timestamp);
+    object[msgpack11::MsgPack("source")] = msgpack11::MsgPack(value.source);
+    object[msgpack11::MsgPack("data")] = msgpack11::MsgPack(data);
+    return msgpack11::MsgPack(object);
+}
+
+template<>
+ErrorReport convertFromMsgPack<ErrorReport>(const msgpack11::MsgPack& msgpack) {
+    const msgpack11::MsgPack& data = msgpack["data"];
+    if (!msgpack.is_object() || !data.is_object()) {
+        throw MCPSerializationError("Expected map type in MessagePack data");
+    }
+    
+    ErrorReport report;
+    report.source = msgpack["source"].string_value();
+    report.timestamp = msgpack["timestamp"].uint64_value();
+    report.severity = severityFrom(data["severity"].string_value());
+    report.code = data["code"].string_value();
+    report.message = data["message"].string_value();
+    report.topic = data["context"]["topic"].string_value();
+    report.count = data["count"].uint64_value();
+    report.total = data["total"].uint64_value();
+    return report;
+}
+
+// Explicit instantiations for ErrorReport
+template std::shared_ptr<void> serializeToMsgPack<ErrorReport>(const ErrorReport& value, std::size_t& dataSize);
+template ErrorReport deserializeFromMsgPack<ErrorReport>(const void* data, std::size_t dataSize);
+template std::shared_ptr<MCPMessage_V1> createMsgPackMessage<ErrorReport>(const std::string& topic, int senderModuleId, const ErrorReport& value);
+template ErrorReport extractMessageData<ErrorReport>(const MCPMessage_V1* message);
+
+PayloadType peekMsgPackType(const void* data, std::size_t dataSize) {
+    if (!data || dataSize == 0) {
+        return PayloadType::ANY;
+    }
+    
+    uint8_t tag = *static_cast<const uint8_t*>(data);
+    if (tag <= 0x7f || tag >= 0xe0) {
+        return PayloadType::INTEGER;    // positive / negative fixint
+    }
+    if (tag <= 0x8f) {
+        return PayloadType::MAP;        // fixmap
+    }
+    if (tag <= 0x9f) {
+        return PayloadType::ARRAY;      // fixarray
+    }
+    if (tag <= 0xbf) {
+        return PayloadType::STRING;     // fixstr
+    }
+    
+    switch (tag) {
+        case 0xc0:
+            return PayloadType::NIL;
+        case 0xc2:
+        case 0xc3:
+            return PayloadType::BOOLEAN;
+        case 0xc4:
+        case 0xc5:
+        case 0xc6:
+            return PayloadType::BINARY;
+        case 0xca:
+        case 0xcb:
+            return PayloadType::FLOAT;
+        case 0xcc: case 0xcd: case 0xce: case 0xcf:
+        case 0xd0: case 0xd1: case 0xd2: case 0xd3:
+            return PayloadType::INTEGER;
+        case 0xd9:
+        case 0xda:
+        case 0xdb:
+            return PayloadType::STRING;
+        case 0xdc:
+        case 0xdd:
+            return PayloadType::ARRAY;
+        case 0xde:
+        case 0xdf:
+            return PayloadType::MAP;
+        default:
+            return PayloadType::ANY;    // extension types and the unused 0xc1
+    }
+}
+
 } // namespace serialization
 } // namespace mcp 
\ No newline at end of file
@@ -0,0 +1,218 @@
+#include "mcp/MCPSnapshot.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mcp {
+
+namespace {
+    const char SNAPSHOT_MAGIC[8] = {'M', 'C', 'P', 'S', 'N', 'A', 'P', '\0'};
+    const uint32_t SNAPSHOT_VERSION = 1;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t count;
+    };
+
+    // Followed by the topic, the data format and the payload, padded to 8 bytes
+    struct EntryHeader {
+        uint32_t topicSize;
+        uint32_t formatSize;
+        int32_t senderModuleId;
+        uint32_t reserved;
+        uint64_t dataSize;
+    };
+
+    std::size_t padded(std::size_t size) {
+        return (size + 7) & ~static_cast<std::size_t>(7);
+    }
+
+    std::size_t entrySize(const MCPMessage_V1& message) {
+        return sizeof(EntryHeader) +
+               padded(message.topic.size() + message.dataFormat.size() + message.dataSize);
+    }
+
+    // Serialize the messages into a buffer of the size computed by entrySize()
+    void fill(uint8_t* out, const std::vector<const MCPMessage_V1*>& messages) {
+        FileHeader header;
+        std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+        header.version = SNAPSHOT_VERSION;
+        header.count = static_cast<uint32_t>(messages.size());
+        std::memcpy(out, &header, sizeof(header));
+        out += sizeof(header);
+
+        for (const MCPMessage_V1* message : messages) {
+            EntryHeader entry;
+            entry.topicSize = static_cast<uint32_t>(message->topic.size());
+            entry.formatSize = static_cast<uint32_t>(message->dataFormat.size());
+            entry.senderModuleId = message->senderModuleId;
+            entry.reserved = 0;
+            entry.dataSize = message->dataSize;
+            std::memcpy(out, &entry, sizeof(entry));
+
+            uint8_t* body = out + sizeof(entry);
+            std::memcpy(body, message->topic.data(), entry.topicSize);
+            body += entry.topicSize;
+            std::memcpy(body, message->dataFormat.data(), entry.formatSize);
+            body += entry.formatSize;
+            if (message->dataSize > 0) {
+                std::memcpy(body, message->data.get(), message->dataSize);
+            }
+            body += message->dataSize;
+
+            uint8_t* end = out + entrySize(*message);
+            std::memset(body, 0, end - body);
+            out = end;
+        }
+    }
+
+    // Parse a snapshot image; payloads alias the image through its owner
+    bool parse(const std::shared_ptr<const uint8_t>& image, std::size_t size,
+               std::vector<std::shared_ptr<MCPMessage_V1>>& messages) {
+        const uint8_t* in = image.get();
+        FileHeader header;
+        if (size < sizeof(header)) {
+            return false;
+        }
+        std::memcpy(&header, in, sizeof(header));
+        if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic)) != 0 ||
+            header.version != SNAPSHOT_VERSION) {
+            return false;
+        }
+
+        std::vector<std::shared_ptr<MCPMessage_V1>> parsed;
+        std::size_t offset = sizeof(header);
+        for (uint32_t i = 0; i < header.count; ++i) {
+            EntryHeader entry;
+            if (size - offset < sizeof(entry)) {
+                return false;
+            }
+            std::memcpy(&entry, in + offset, sizeof(entry));
+            offset += sizeof(entry);
+
+            uint64_t bodySize = static_cast<uint64_t>(entry.topicSize) + entry.formatSize + entry.dataSize;
+            if (entry.topicSize == 0 || bodySize > size - offset) {
+                return false;
+            }
+
+            const char* body = reinterpret_cast<const char*>(in + offset);
+            std::string topic(body, entry.topicSize);
+            std::string format(body + entry.topicSize, entry.formatSize);
+            const uint8_t* payload = in + offset + entry.topicSize + entry.formatSize;
+            std::shared_ptr<void> data(image, const_cast<uint8_t*>(payload));
+
+            parsed.push_back(std::make_shared<MCPMessage_V1>(
+                topic, entry.senderModuleId, format, data, static_cast<std::size_t>(entry.dataSize)));
+            offset += std::min<std::size_t>(padded(static_cast<std::size_t>(bodySize)), size - offset);
+        }
+
+        messages.insert(messages.end(), parsed.begin(), parsed.end());
+        return true;
+    }
+}
+
+bool Snapshot::write(const std::string& path,
+                     const std::vector<std::shared_ptr<const MCPMessage_V1>>& messages) {
+    std::vector<const MCPMessage_V1*> entries;
+    std::size_t size = sizeof(FileHeader);
+    for (const auto& message : messages) {
+        if (message && !message->topic.empty() && (message->data || message->dataSize == 0)) {
+            entries.push_back(message.get());
+            size += entrySize(*message);
+        }
+    }
+
+    // Write next to the target and rename, so a crash never leaves a torn snapshot
+    std::string temporary = path + ".tmp";
+
+#if defined(_WIN32)
+    std::vector<uint8_t> buffer(size);
+    fill(buffer.data(), entries);
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+    bool written = std::fwrite(buffer.data(), 1, size, file) == size;
+    written = std::fclose(file) == 0 && written;
+#else
+    int fd = ::open(temporary.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    bool written = false;
+    if (::ftruncate(fd, static_cast<off_t>(size)) == 0) {
+        void* mapping = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (mapping != MAP_FAILED) {
+            fill(static_cast<uint8_t*>(mapping), entries);
+            written = ::msync(mapping, size, MS_SYNC) == 0;
+            ::munmap(mapping, size);
+        }
+    }
+    written = ::close(fd) == 0 && written;
+#endif
+
+    if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool Snapshot::read(const std::string& path,
+                    std::vector<std::shared_ptr<MCPMessage_V1>>& messages) {
+#if defined(_WIN32)
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        return false;
+    }
+    std::vector<uint8_t> buffer;
+    uint8_t chunk[4096];
+    std::size_t read = 0;
+    while ((read = std::fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        buffer.insert(buffer.end(), chunk, chunk + read);
+    }
+    std::fclose(file);
+
+    std::size_t size = buffer.size();
+    std::shared_ptr<uint8_t> image(new uint8_t[std::max<std::size_t>(1, size)],
+                                   [](uint8_t* p) { delete[] p; });
+    if (size > 0) {
+        std::memcpy(image.get(), buffer.data(), size);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat status;
+    if (::fstat(fd, &status) != 0 || status.st_size <= 0) {
+        ::close(fd);
+        return false;
+    }
+    std::size_t size = static_cast<std::size_t>(status.st_size);
+    void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+
+    // Unmapped once the last restored payload is released
+    std::shared_ptr<const uint8_t> image(static_cast<const uint8_t*>(mapping),
+                                         [size](const uint8_t* p) {
+                                             ::munmap(const_cast<uint8_t*>(p), size);
+                                         });
+#endif
+
+    return parse(image, size, messages);
+}
+
+} // namespace mcp
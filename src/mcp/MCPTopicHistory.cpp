@@ -0,0 +1,74 @@
+#include "mcp/MCPTopicHistory.h"
+#include <algorithm>
+#include <thread>
+
+namespace mcp {
+
+TopicHistory::TopicHistory(const HistoryConfig& config)
+    : m_config(config), m_appended(0) {
+    m_config.maxMessages = std::max<std::size_t>(1, m_config.maxMessages);
+    m_slots.reset(new Slot[m_config.maxMessages]);
+}
+
+void TopicHistory::append(std::shared_ptr<MCPMessage_V1> message,
+                          std::chrono::steady_clock::time_point publishTime) {
+    uint64_t sequence = m_appended.load(std::memory_order_relaxed);
+    Slot& slot = m_slots[sequence % m_config.maxMessages];
+
+    // Sequentially consistent with the reader's pin: either it sees the odd
+    // version and skips the slot, or this sees it pinned and waits for it
+    uint64_t version = slot.version.load(std::memory_order_relaxed);
+    slot.version.store(version + 1);
+    while (slot.readers.load() != 0) {
+        std::this_thread::yield();
+    }
+
+    slot.message = std::move(message);
+    slot.publishTime = publishTime;
+    slot.sequence = sequence;
+    slot.version.store(version + 2, std::memory_order_release);
+
+    // Publish the new count only after the slot holds the record
+    m_appended.store(sequence + 1, std::memory_order_release);
+}
+
+std::vector<std::shared_ptr<const MCPMessage_V1>> TopicHistory::read(std::size_t maxMessages) const {
+    uint64_t end = m_appended.load(std::memory_order_acquire);
+    uint64_t count = std::min<uint64_t>(end, m_config.maxMessages);
+    if (maxMessages > 0) {
+        count = std::min<uint64_t>(count, maxMessages);
+    }
+    return collect(end - count, end, std::chrono::steady_clock::time_point::min());
+}
+
+std::vector<std::shared_ptr<const MCPMessage_V1>> TopicHistory::readSince(
+    std::chrono::steady_clock::time_point since) const {
+    uint64_t end = m_appended.load(std::memory_order_acquire);
+    uint64_t count = std::min<uint64_t>(end, m_config.maxMessages);
+    return collect(end - count, end, since);
+}
+
+std::vector<std::shared_ptr<const MCPMessage_V1>> TopicHistory::collect(
+    uint64_t first, uint64_t end, std::chrono::steady_clock::time_point since) const {
+    if (m_config.maxAge.count() > 0) {
+        since = std::max(since, std::chrono::steady_clock::now() - m_config.maxAge);
+    }
+
+    std::vector<std::shared_ptr<const MCPMessage_V1>> messages;
+    messages.reserve(static_cast<std::size_t>(end - first));
+    for (uint64_t sequence = first; sequence < end; ++sequence) {
+        Slot& slot = m_slots[sequence % m_config.maxMessages];
+
+        // An odd version or a newer record means the writer lapped this
+        // slot while we were reading
+        slot.readers.fetch_add(1);
+        if ((slot.version.load() & 1) == 0 && slot.message && slot.sequence == sequence &&
+            slot.publishTime >= since) {
+            messages.push_back(slot.message);
+        }
+        slot.readers.fetch_sub(1, std::memory_order_release);
+    }
+    return messages;
+}
+
+} // namespace mcp
@@ -0,0 +1,210 @@
+#include "mcp/MCPWorkStealingPool.h"
+#include <algorithm>
+
+namespace mcp {
+
+namespace {
+    // Maximum tasks a strand runs before yielding its pool thread
+    const std::size_t STRAND_BATCH = 32;
+}
+
+// Shared with the pool threads so a thread can outlive the pool object when
+// the pool is destroyed from one of its own tasks
+struct WorkStealingPool::State {
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::atomic<std::size_t> nextQueue{0};
+    std::atomic<uint64_t> steals{0};
+
+    // Sleep/wake bookkeeping
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    std::size_t pending = 0;
+    bool stopping = false;
+
+    bool take(std::size_t self, std::function<void()>& task) {
+        // Own tasks in FIFO order, so a rescheduled strand queues behind the others
+        {
+            WorkerQueue& own = *queues[self];
+            std::lock_guard<std::mutex> lock(own.mutex);
+            if (!own.tasks.empty()) {
+                task = std::move(own.tasks.front());
+                own.tasks.pop_front();
+                return true;
+            }
+        }
+
+        // Then steal from the other end of another thread's deque
+        for (std::size_t i = 1; i < queues.size(); ++i) {
+            WorkerQueue& victim = *queues[(self + i) % queues.size()];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty()) {
+                task = std::move(victim.tasks.back());
+                victim.tasks.pop_back();
+                steals.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void run(std::size_t self);
+};
+
+namespace {
+    // Pool and queue index of the current thread, if it is a pool thread
+    thread_local const void* t_currentPool = nullptr;
+    thread_local std::size_t t_currentQueue = 0;
+}
+
+void WorkStealingPool::State::run(std::size_t self) {
+    t_currentPool = this;
+    t_currentQueue = self;
+
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return pending > 0 || stopping; });
+            if (stopping) {
+                break;
+            }
+            // Claim one task; it is guaranteed to be in some deque
+            --pending;
+        }
+
+        std::function<void()> task;
+        while (!take(self, task)) {
+            // The claimed task is being pushed right now
+            std::this_thread::yield();
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            // A failing task must not take down the pool thread
+        }
+    }
+}
+
+WorkStealingPool::WorkStealingPool(std::size_t threadCount)
+    : m_state(std::make_shared<State>()) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        m_state->queues.emplace_back(new State::WorkerQueue());
+    }
+    for (std::size_t i = 0; i < threadCount; ++i) {
+        std::shared_ptr<State> state = m_state;
+        m_threads.emplace_back([state, i]() { state->run(i); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(m_state->sleepMutex);
+        m_state->stopping = true;
+    }
+    m_state->wake.notify_all();
+
+    for (auto& thread : m_threads) {
+        if (thread.get_id() == std::this_thread::get_id()) {
+            // Destroyed from our own task - the thread keeps the state alive and exits by itself
+            thread.detach();
+        } else if (thread.joinable()) {
+            thread.join();
+        }
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    std::size_t index = 0;
+    if (t_currentPool == m_state.get()) {
+        index = t_currentQueue;
+    } else {
+        index = m_state->nextQueue.fetch_add(1, std::memory_order_relaxed) % m_state->queues.size();
+    }
+
+    {
+        State::WorkerQueue& queue = *m_state->queues[index];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_back(std::move(task));
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_state->sleepMutex);
+        m_state->pending++;
+    }
+    m_state->wake.notify_one();
+}
+
+std::size_t WorkStealingPool::getThreadCount() const {
+    return m_threads.size();
+}
+
+uint64_t WorkStealingPool::getStealCount() const {
+    return m_state->steals.load(std::memory_order_relaxed);
+}
+
+Strand::Strand(std::shared_ptr<WorkStealingPool> pool)
+    : m_pool(pool), m_scheduled(false), m_closed(false) {}
+
+void Strand::post(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_closed) {
+            return;
+        }
+        m_tasks.push_back(std::move(task));
+        if (m_scheduled) {
+            return;
+        }
+        m_scheduled = true;
+    }
+
+    std::shared_ptr<Strand> self = shared_from_this();
+    m_pool->submit([self]() { self->drain(); });
+}
+
+void Strand::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_closed = true;
+    m_tasks.clear();
+}
+
+std::size_t Strand::pending() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_tasks.size();
+}
+
+void Strand::drain() {
+    for (std::size_t i = 0; i < STRAND_BATCH; ++i) {
+        std::function<void()> task;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_tasks.empty()) {
+                m_scheduled = false;
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+
+        try {
+            task();
+        } catch (const std::exception& e) {
+            // Keep draining - one failing task must not stall the strand
+        }
+    }
+
+    // Batch used up - go to the back of the pool so other strands get a turn
+    std::shared_ptr<Strand> self = shared_from_this();
+    m_pool->submit([self]() { self->drain(); });
+}
+
+} // namespace mcp
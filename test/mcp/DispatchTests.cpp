@@ -0,0 +1,1498 @@
+#include "mcp/MCPBroker.h"
+#include "mcp/MCPDispatchQueue.h"
+#include "mcp/MCPMessage_V1.h"
+#include "mcp/MCPSerialization.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <memory>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <cstdio>
+
+namespace mcp {
+namespace test {
+
+namespace {
+
+// Wait until a condition becomes true or the timeout expires
+template<typename Predicate>
+bool waitUntil(Predicate predicate,
+               std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (predicate()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return predicate();
+}
+
+// Subscriber that records the per-topic sequence and detects concurrent
+// dispatch of the same topic
+class OrderingSubscriber : public IMCPSubscriber_V1 {
+public:
+    explicit OrderingSubscriber(std::chrono::microseconds workPerMessage)
+        : m_workPerMessage(workPerMessage) {}
+
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        int inFlight = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            inFlight = ++m_inFlight[message->topic];
+        }
+        if (inFlight > 1) {
+            m_concurrentSameTopic = true;
+        }
+
+        std::this_thread::sleep_for(m_workPerMessage);
+
+        int sequence = serialization::extractMessageData<int>(message);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto& received = m_received[message->topic];
+            if (!received.empty() && received.back() >= sequence) {
+                m_outOfOrder = true;
+            }
+            received.push_back(sequence);
+            --m_inFlight[message->topic];
+        }
+        m_total++;
+    }
+
+    int total() const { return m_total; }
+    bool outOfOrder() const { return m_outOfOrder; }
+    bool concurrentSameTopic() const { return m_concurrentSameTopic; }
+
+private:
+    std::chrono::microseconds m_workPerMessage;
+    std::mutex m_mutex;
+    std::map<std::string, std::vector<int>> m_received;
+    std::map<std::string, int> m_inFlight;
+    std::atomic<int> m_total{0};
+    std::atomic<bool> m_outOfOrder{false};
+    std::atomic<bool> m_concurrentSameTopic{false};
+};
+
+// Subscriber that records the int values it receives, optionally slowly
+class ValueSubscriber : public IMCPSubscriber_V1 {
+public:
+    explicit ValueSubscriber(std::chrono::microseconds workPerMessage = std::chrono::microseconds(0))
+        : m_workPerMessage(workPerMessage) {}
+
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        if (m_workPerMessage.count() > 0) {
+            std::this_thread::sleep_for(m_workPerMessage);
+        }
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_values.push_back(serialization::extractMessageData<int>(message));
+    }
+
+    std::vector<int> values() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_values;
+    }
+
+private:
+    std::chrono::microseconds m_workPerMessage;
+    std::mutex m_mutex;
+    std::vector<int> m_values;
+};
+
+// Subscriber that appends its name to a shared call log
+class NamedSubscriber : public IMCPSubscriber_V1 {
+public:
+    NamedSubscriber(const std::string& name, std::vector<std::string>& log, std::mutex& mutex)
+        : m_name(name), m_log(log), m_mutex(mutex) {}
+
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_log.push_back(m_name + ":" + message->topic);
+    }
+
+private:
+    std::string m_name;
+    std::vector<std::string>& m_log;
+    std::mutex& m_mutex;
+};
+
+// Subscriber that blocks the worker until released
+class GateSubscriber : public IMCPSubscriber_V1 {
+public:
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_entered = true;
+        m_cv.notify_all();
+        m_cv.wait(lock, [this] { return m_released; });
+    }
+
+    void waitEntered() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_cv.wait(lock, [this] { return m_entered; });
+    }
+
+    bool entered() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_entered;
+    }
+
+    void release() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_released = true;
+        m_cv.notify_all();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    bool m_entered = false;
+    bool m_released = false;
+};
+
+std::shared_ptr<MCPMessage_V1> makeMessage(const std::string& topic, int value) {
+    return serialization::createMsgPackMessage(topic, 1, value);
+}
+
+} // anonymous namespace
+
+// The dispatch queue serves topics in global FIFO order and never hands out
+// a topic that is in flight
+TEST(DispatchQueueTest, FifoAcrossTopicsAndInFlightExclusion) {
+    DispatchQueue queue;
+    auto now = std::chrono::steady_clock::now();
+
+    queue.push(makeMessage("a", 1), now);
+    queue.push(makeMessage("b", 1), now);
+    queue.push(makeMessage("a", 2), now);
+    EXPECT_EQ(3u, queue.size());
+    EXPECT_EQ(2u, queue.readyCount());
+
+    DispatchEntry entry;
+    DispatchQueue::TopicQueue* topicA = nullptr;
+    ASSERT_TRUE(queue.tryPop(entry, topicA));
+    EXPECT_EQ("a", entry.message->topic);
+
+    // "a" is in flight, so only "b" is available
+    DispatchQueue::TopicQueue* topicB = nullptr;
+    ASSERT_TRUE(queue.tryPop(entry, topicB));
+    EXPECT_EQ("b", entry.message->topic);
+
+    DispatchQueue::TopicQueue* none = nullptr;
+    EXPECT_FALSE(queue.tryPop(entry, none));
+
+    queue.complete(topicA);
+    ASSERT_TRUE(queue.tryPop(entry, topicA));
+    EXPECT_EQ("a", entry.message->topic);
+    EXPECT_EQ(2, serialization::extractMessageData<int>(entry.message.get()));
+    EXPECT_TRUE(queue.empty());
+}
+
+// Removed sub-queues are erased once drained, and clear() erases every
+// sub-queue except the ones still in flight
+TEST(DispatchQueueTest, RemoveTopicAndClearEraseSubQueues) {
+    DispatchQueue queue;
+    auto now = std::chrono::steady_clock::now();
+    int ran = 0;
+
+    queue.pushTask("@module/1", [&ran] { ++ran; }, now);
+    queue.pushTask("@module/2", [&ran] { ++ran; }, now);
+    EXPECT_EQ(2u, queue.topicCount());
+
+    // An idle sub-queue goes at once, a busy one after its last entry
+    DispatchEntry entry;
+    DispatchQueue::TopicQueue* topicQueue = nullptr;
+    ASSERT_TRUE(queue.tryPop(entry, topicQueue));
+    queue.removeTopic("@module/1");
+    queue.removeTopic("@module/2");
+    EXPECT_EQ(2u, queue.topicCount());
+    entry.task();
+    queue.complete(topicQueue);
+    EXPECT_EQ(1u, queue.topicCount());
+    ASSERT_TRUE(queue.tryPop(entry, topicQueue));
+    entry.task();
+    queue.complete(topicQueue);
+    EXPECT_EQ(0u, queue.topicCount());
+    EXPECT_EQ(2, ran);
+
+    queue.push(makeMessage("a", 1), now);
+    queue.push(makeMessage("b", 1), now);
+    ASSERT_TRUE(queue.tryPop(entry, topicQueue));
+    queue.clear();
+    EXPECT_EQ(1u, queue.topicCount());
+    queue.complete(topicQueue);
+    EXPECT_EQ(0u, queue.topicCount());
+    EXPECT_TRUE(queue.empty());
+}
+
+// Deficit round-robin serves a quiet topic after at most one turn of a
+// noisy one and honours weights
+TEST(DispatchQueueTest, DeficitRoundRobinAcrossTopics) {
+    DispatchQueue queue;
+    queue.setSchedulingPolicy(SchedulingPolicy::DEFICIT_ROUND_ROBIN);
+    queue.setTopicWeight("heavy", 3);
+    auto now = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < 100; ++i) {
+        queue.push(makeMessage("noisy", i), now);
+    }
+    for (int i = 0; i < 6; ++i) {
+        queue.push(makeMessage("heavy", i), now);
+    }
+    queue.push(makeMessage("quiet", 0), now);
+
+    std::vector<std::string> order;
+    std::vector<int> noisyValues;
+    DispatchEntry entry;
+    DispatchQueue::TopicQueue* topicQueue = nullptr;
+    for (int i = 0; i < 10 && queue.tryPop(entry, topicQueue); ++i) {
+        order.push_back(entry.message->topic);
+        if (entry.message->topic == "noisy") {
+            noisyValues.push_back(serialization::extractMessageData<int>(entry.message.get()));
+        }
+        queue.complete(topicQueue);
+    }
+
+    EXPECT_EQ((std::vector<std::string>{"noisy", "heavy", "heavy", "heavy", "quiet",
+                                         "noisy", "heavy", "heavy", "heavy", "noisy"}), order);
+    EXPECT_EQ((std::vector<int>{0, 1, 2}), noisyValues);
+
+    // Switching back keeps every queued message
+    queue.setSchedulingPolicy(SchedulingPolicy::EARLIEST_DEADLINE);
+    std::size_t remaining = 0;
+    while (queue.tryPop(entry, topicQueue)) {
+        queue.complete(topicQueue);
+        ++remaining;
+    }
+    EXPECT_EQ(97u, remaining);
+}
+
+// Extra workers are spawned under backlog and retired once idle
+TEST(WorkerPoolTest, ScalesUpUnderBacklogAndRetires) {
+    auto broker = std::make_shared<MCPBroker>();
+
+    WorkerPoolConfig config;
+    config.minWorkers = 1;
+    config.maxWorkers = 4;
+    config.scaleUpQueueDepth = 4;
+    config.scaleUpMessageAge = std::chrono::milliseconds(1);
+    config.scaleUpCooldown = std::chrono::milliseconds(0);
+    config.idleRetireTime = std::chrono::milliseconds(50);
+    broker->setWorkerPoolConfig(config);
+
+    auto subscriber = std::make_shared<OrderingSubscriber>(std::chrono::microseconds(2000));
+    const int numTopics = 8;
+    const int messagesPerTopic = 5;
+    for (int t = 0; t < numTopics; ++t) {
+        ASSERT_TRUE(broker->subscribe("pool/topic" + std::to_string(t), subscriber));
+    }
+
+    for (int i = 0; i < messagesPerTopic; ++i) {
+        for (int t = 0; t < numTopics; ++t) {
+            ASSERT_TRUE(broker->publish(makeMessage("pool/topic" + std::to_string(t), i)));
+        }
+    }
+
+    ASSERT_TRUE(waitUntil([&] { return subscriber->total() == numTopics * messagesPerTopic; }));
+    EXPECT_FALSE(subscriber->outOfOrder());
+    EXPECT_FALSE(subscriber->concurrentSameTopic());
+
+    auto stats = broker->getWorkerPoolStats();
+    EXPECT_GT(stats.peakWorkers, 1u);
+    EXPECT_LE(stats.peakWorkers, config.maxWorkers);
+
+    // Surplus workers retire after the idle period
+    ASSERT_TRUE(waitUntil([&] { return broker->getWorkerPoolStats().currentWorkers == 1; }));
+    stats = broker->getWorkerPoolStats();
+    EXPECT_GE(stats.workersRetired, 1u);
+    ASSERT_FALSE(stats.history.empty());
+    EXPECT_EQ(1u, stats.history.back().workers);
+}
+
+// Per-topic ordering holds with a fixed multi-worker pool
+TEST(WorkerPoolTest, PerTopicOrderingWithManyWorkers) {
+    auto broker = std::make_shared<MCPBroker>();
+
+    WorkerPoolConfig config;
+    config.minWorkers = 4;
+    config.maxWorkers = 4;
+    broker->setWorkerPoolConfig(config);
+    EXPECT_EQ(4u, broker->getWorkerPoolStats().currentWorkers);
+
+    auto subscriber = std::make_shared<OrderingSubscriber>(std::chrono::microseconds(50));
+    const int numTopics = 3;
+    const int messagesPerTopic = 200;
+    for (int t = 0; t < numTopics; ++t) {
+        ASSERT_TRUE(broker->subscribe("order/topic" + std::to_string(t), subscriber));
+    }
+
+    for (int i = 0; i < messagesPerTopic; ++i) {
+        for (int t = 0; t < numTopics; ++t) {
+            broker->publish(makeMessage("order/topic" + std::to_string(t), i));
+        }
+    }
+
+    ASSERT_TRUE(waitUntil([&] { return subscriber->total() == numTopics * messagesPerTopic; }));
+    EXPECT_FALSE(subscriber->outOfOrder());
+    EXPECT_FALSE(subscriber->concurrentSameTopic());
+}
+
+// Subscribers of one message are called latency class first, then EDF,
+// regardless of registration order
+TEST(DeadlineFanOutTest, LatencyCriticalSubscribersGoFirst) {
+    auto broker = std::make_shared<MCPBroker>();
+    std::mutex mutex;
+    std::vector<std::string> log;
+
+    auto background = std::make_shared<NamedSubscriber>("background", log, mutex);
+    auto ui = std::make_shared<NamedSubscriber>("ui", log, mutex);
+    auto uiTight = std::make_shared<NamedSubscriber>("uiTight", log, mutex);
+    auto audio = std::make_shared<NamedSubscriber>("audio", log, mutex);
+
+    SubscriptionOptions backgroundOptions;
+    backgroundOptions.latencyClass = LatencyClass::BACKGROUND;
+    SubscriptionOptions uiTightOptions;
+    uiTightOptions.deadline = std::chrono::microseconds(5000);
+    SubscriptionOptions audioOptions;
+    audioOptions.latencyClass = LatencyClass::REALTIME;
+
+    ASSERT_TRUE(broker->subscribe("fanout/clock", background, backgroundOptions));
+    ASSERT_TRUE(broker->subscribe("fanout/clock", ui));
+    ASSERT_TRUE(broker->subscribe("fanout/clock", uiTight, uiTightOptions));
+    ASSERT_TRUE(broker->subscribe("fanout/clock", audio, audioOptions));
+    EXPECT_FALSE(broker->subscribe("fanout/clock", audio, audioOptions));
+
+    ASSERT_TRUE(broker->publish(makeMessage("fanout/clock", 1)));
+    ASSERT_TRUE(waitUntil([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return log.size() == 4;
+    }));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<std::string> expected = {
+        "audio:fanout/clock", "uiTight:fanout/clock", "ui:fanout/clock", "background:fanout/clock"
+    };
+    EXPECT_EQ(expected, log);
+}
+
+// Queued messages of a topic with a realtime subscriber overtake older
+// messages of topics with looser deadlines, and background-only topics
+// yield to NORMAL ones
+TEST(DeadlineFanOutTest, EarliestDeadlineFirstAcrossMessages) {
+    auto broker = std::make_shared<MCPBroker>();
+    std::mutex mutex;
+    std::vector<std::string> log;
+
+    auto gate = std::make_shared<GateSubscriber>();
+    auto archive = std::make_shared<NamedSubscriber>("archive", log, mutex);
+    auto visualizer = std::make_shared<NamedSubscriber>("visualizer", log, mutex);
+    auto audio = std::make_shared<NamedSubscriber>("audio", log, mutex);
+
+    SubscriptionOptions audioOptions;
+    audioOptions.latencyClass = LatencyClass::REALTIME;
+    SubscriptionOptions backgroundOptions;
+    backgroundOptions.latencyClass = LatencyClass::BACKGROUND;
+    ASSERT_TRUE(broker->subscribe("edf/gate", gate));
+    ASSERT_TRUE(broker->subscribe("edf/archive", archive, backgroundOptions));
+    ASSERT_TRUE(broker->subscribe("edf/scope", visualizer));
+    ASSERT_TRUE(broker->subscribe("edf/audio", audio, audioOptions));
+
+    // Hold the single worker while the other messages are queued
+    ASSERT_TRUE(broker->publish(makeMessage("edf/gate", 0)));
+    gate->waitEntered();
+    ASSERT_TRUE(broker->publish(makeMessage("edf/archive", 1)));
+    ASSERT_TRUE(broker->publish(makeMessage("edf/scope", 2)));
+    ASSERT_TRUE(broker->publish(makeMessage("edf/audio", 3)));
+    gate->release();
+
+    ASSERT_TRUE(waitUntil([&] {
+        std::lock_guard<std::mutex> lock(mutex);
+        return log.size() == 3;
+    }));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    EXPECT_EQ("audio:edf/audio", log[0]);
+    EXPECT_EQ("visualizer:edf/scope", log[1]);
+    EXPECT_EQ("archive:edf/archive", log[2]);
+}
+
+// An overloaded STATE topic is coalesced, delivers its latest value and
+// reverts once the burst is over; EVENT topics are never coalesced
+TEST(AdaptiveConflationTest, StateTopicCoalescesUnderBurstAndReverts) {
+    auto broker = std::make_shared<MCPBroker>();
+
+    std::mutex eventMutex;
+    std::vector<ConflationEvent> events;
+    broker->setConflationListener([&](const ConflationEvent& event) {
+        std::lock_guard<std::mutex> lock(eventMutex);
+        events.push_back(event);
+    });
+
+    AdaptiveConflationConfig config;
+    config.enabled = true;
+    config.sampleWindow = std::chrono::milliseconds(10);
+    config.backlogThreshold = 8;
+    broker->setAdaptiveConflation(config);
+    broker->setTopicKind("conflate/state", TopicKind::STATE);
+    EXPECT_EQ(TopicKind::STATE, broker->getTopicKind("conflate/state"));
+    EXPECT_EQ(TopicKind::EVENT, broker->getTopicKind("conflate/event"));
+
+    auto stateSubscriber = std::make_shared<ValueSubscriber>(std::chrono::microseconds(1000));
+    auto eventSubscriber = std::make_shared<ValueSubscriber>(std::chrono::microseconds(1000));
+    ASSERT_TRUE(broker->subscribe("conflate/state", stateSubscriber));
+    ASSERT_TRUE(broker->subscribe("conflate/event", eventSubscriber));
+
+    // Burst far faster than the 1 kHz the subscribers can absorb
+    const int burst = 300;
+    for (int i = 0; i < burst; ++i) {
+        broker->publish(makeMessage("conflate/state", i));
+        broker->publish(makeMessage("conflate/event", i));
+        if (i % 10 == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    ASSERT_TRUE(waitUntil([&] {
+        auto values = stateSubscriber->values();
+        return !values.empty() && values.back() == burst - 1;
+    }));
+    ASSERT_TRUE(waitUntil([&] { return eventSubscriber->values().size() == burst; }));
+
+    EXPECT_LT(stateSubscriber->values().size(), static_cast<size_t>(burst));
+    EXPECT_FALSE(broker->isTopicConflating("conflate/event"));
+
+    // A slow trickle lets the topic revert
+    ASSERT_TRUE(waitUntil([&] {
+        broker->publish(makeMessage("conflate/state", burst));
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+        return !broker->isTopicConflating("conflate/state");
+    }));
+
+    std::lock_guard<std::mutex> lock(eventMutex);
+    ASSERT_GE(events.size(), 2u);
+    EXPECT_EQ("conflate/state", events.front().topic);
+    EXPECT_TRUE(events.front().conflating);
+    EXPECT_GT(events.front().produceRate, events.front().consumeRate);
+    EXPECT_FALSE(events.back().conflating);
+    EXPECT_EQ(events.size(), broker->getConflationSwitchCount());
+}
+
+// History keeps the newest messages and late joiners get them before live ones
+TEST(TopicHistoryTest, BoundedRingAndReplayBeforeLive) {
+    auto broker = std::make_shared<MCPBroker>();
+    HistoryConfig config;
+    config.maxMessages = 4;
+    broker->enableHistory("history/topic", config);
+
+    auto gate = std::make_shared<GateSubscriber>();
+    ASSERT_TRUE(broker->subscribe("history/topic", gate));
+
+    // Message 1 is dispatched (and recorded) but blocks in the gate;
+    // the others stay queued behind it
+    for (int i = 1; i <= 3; ++i) {
+        broker->publish(makeMessage("history/topic", i));
+    }
+    gate->waitEntered();
+
+    auto late = std::make_shared<ValueSubscriber>();
+    SubscriptionOptions options;
+    options.replayHistory = true;
+    ASSERT_TRUE(broker->subscribe("history/topic", late, options));
+
+    gate->release();
+    ASSERT_TRUE(waitUntil([&] { return late->values().size() == 3; }));
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), late->values());
+
+    // The ring keeps only the newest maxMessages, oldest first
+    for (int i = 4; i <= 10; ++i) {
+        broker->publish(makeMessage("history/topic", i));
+    }
+    ASSERT_TRUE(waitUntil([&] { return late->values().size() == 10; }));
+
+    auto history = broker->getTopicHistory("history/topic");
+    ASSERT_NE(nullptr, history);
+    EXPECT_EQ(10u, history->getAppendedCount());
+
+    std::vector<int> retained;
+    for (const auto& message : history->read()) {
+        retained.push_back(serialization::extractMessageData<int>(message.get()));
+    }
+    EXPECT_EQ((std::vector<int>{7, 8, 9, 10}), retained);
+    ASSERT_EQ(2u, broker->getHistory("history/topic", 2).size());
+    EXPECT_EQ(10, serialization::extractMessageData<int>(
+        broker->getHistory("history/topic", 2).back().get()));
+
+    // Another late joiner replays the same retained messages
+    auto late2 = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("history/topic", late2, options));
+    ASSERT_TRUE(waitUntil([&] { return late2->values().size() == 4; }));
+    EXPECT_EQ(retained, late2->values());
+
+    EXPECT_TRUE(broker->disableHistory("history/topic"));
+    EXPECT_EQ(nullptr, broker->getTopicHistory("history/topic"));
+    EXPECT_TRUE(broker->getHistory("history/topic").empty());
+}
+
+// Readers racing with the writer see increasing, never torn, runs of messages
+TEST(TopicHistoryTest, ConcurrentReadsDuringAppends) {
+    HistoryConfig config;
+    config.maxMessages = 8;
+    TopicHistory history(config);
+    const int messageCount = 20000;
+
+    std::atomic<bool> done(false);
+    std::atomic<bool> outOfOrder(false);
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                int previous = -1;
+                for (const auto& message : history.read()) {
+                    int value = serialization::extractMessageData<int>(message.get());
+                    if (value <= previous) {
+                        outOfOrder = true;
+                    }
+                    previous = value;
+                }
+            }
+        });
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    for (int i = 0; i < messageCount; ++i) {
+        history.append(makeMessage("history/topic", i), now);
+    }
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_FALSE(outOfOrder.load());
+    auto retained = history.read();
+    ASSERT_EQ(8u, retained.size());
+    EXPECT_EQ(messageCount - 1, serialization::extractMessageData<int>(retained.back().get()));
+}
+
+// A derived topic's chain runs once per source message for all its consumers
+TEST(DerivedTopicTest, MapFilterRunOncePerMessage) {
+    auto broker = std::make_shared<MCPBroker>();
+    std::atomic<int> mapCalls{0};
+
+    DerivedTopicSpec spec;
+    spec.topic = "sensor/hot_f";
+    spec.sourceTopic = "sensor/celsius";
+    spec.operators.push_back(StreamOperator::filterValue<int>(
+        [](const int& celsius) { return celsius > 30; }));
+    spec.operators.push_back(StreamOperator::mapValue<int, int>(
+        [&mapCalls](const int& celsius) { mapCalls++; return celsius * 9 / 5 + 32; }));
+    ASSERT_TRUE(broker->defineDerivedTopic(spec));
+    EXPECT_FALSE(broker->defineDerivedTopic(spec));
+
+    // Cycles are rejected
+    DerivedTopicSpec cycle;
+    cycle.topic = "sensor/celsius";
+    cycle.sourceTopic = "sensor/hot_f";
+    cycle.operators.push_back(StreamOperator::throttle(std::chrono::milliseconds(1)));
+    EXPECT_FALSE(broker->defineDerivedTopic(cycle));
+
+    auto first = std::make_shared<ValueSubscriber>();
+    auto second = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("sensor/hot_f", first));
+    ASSERT_TRUE(broker->subscribe("sensor/hot_f", second));
+
+    for (int celsius : {20, 35, 25, 40, 100}) {
+        broker->publish(makeMessage("sensor/celsius", celsius));
+    }
+
+    std::vector<int> expected{95, 104, 212};
+    ASSERT_TRUE(waitUntil([&] { return second->values().size() == expected.size(); }));
+    EXPECT_EQ(expected, first->values());
+    EXPECT_EQ(expected, second->values());
+    EXPECT_EQ(3, mapCalls.load());
+
+    EXPECT_TRUE(broker->removeDerivedTopic("sensor/hot_f"));
+    EXPECT_TRUE(broker->getDerivedTopics().empty());
+}
+
+// Throttle keeps the first message of an interval; debounce emits the last
+// message after the source goes quiet
+TEST(DerivedTopicTest, ThrottleAndDebounce) {
+    auto broker = std::make_shared<MCPBroker>();
+
+    DerivedTopicSpec throttled;
+    throttled.topic = "knob/throttled";
+    throttled.sourceTopic = "knob";
+    throttled.operators.push_back(StreamOperator::throttle(std::chrono::seconds(10)));
+    ASSERT_TRUE(broker->defineDerivedTopic(throttled));
+
+    DerivedTopicSpec debounced;
+    debounced.topic = "knob/settled";
+    debounced.sourceTopic = "knob";
+    debounced.operators.push_back(StreamOperator::debounce(std::chrono::milliseconds(30)));
+    ASSERT_TRUE(broker->defineDerivedTopic(debounced));
+
+    auto throttledSubscriber = std::make_shared<ValueSubscriber>();
+    auto debouncedSubscriber = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("knob/throttled", throttledSubscriber));
+    ASSERT_TRUE(broker->subscribe("knob/settled", debouncedSubscriber));
+
+    for (int i = 1; i <= 20; ++i) {
+        broker->publish(makeMessage("knob", i));
+    }
+
+    ASSERT_TRUE(waitUntil([&] { return !debouncedSubscriber->values().empty(); }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    EXPECT_EQ((std::vector<int>{20}), debouncedSubscriber->values());
+    EXPECT_EQ((std::vector<int>{1}), throttledSubscriber->values());
+
+    // A second burst settles again
+    broker->publish(makeMessage("knob", 42));
+    ASSERT_TRUE(waitUntil([&] { return debouncedSubscriber->values().size() == 2; }));
+    EXPECT_EQ(42, debouncedSubscriber->values().back());
+}
+
+// A manual-pump broker runs no threads and dispatches only when pumped
+TEST(ManualPumpTest, HostDrivenDispatch) {
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    EXPECT_EQ(DispatchMode::MANUAL_PUMP, broker->getDispatchMode());
+    EXPECT_EQ(0u, broker->getWorkerPoolStats().currentWorkers);
+
+    // Even a pool config must not start workers
+    WorkerPoolConfig config;
+    config.minWorkers = 2;
+    config.maxWorkers = 4;
+    broker->setWorkerPoolConfig(config);
+    EXPECT_EQ(0u, broker->getWorkerPoolStats().currentWorkers);
+
+    class ThrowingSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            throw std::runtime_error("subscriber failure");
+        }
+    };
+
+    auto throwing = std::make_shared<ThrowingSubscriber>();
+    auto values = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("pump/topic", throwing));
+    ASSERT_TRUE(broker->subscribe("pump/topic", values));
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(broker->publish(makeMessage("pump/topic", i)));
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_TRUE(values->values().empty());
+
+    EXPECT_EQ(3u, broker->pump(3));
+    EXPECT_EQ((std::vector<int>{0, 1, 2}), values->values());
+
+    EXPECT_EQ(7u, broker->pump(std::chrono::microseconds(1000000)));
+    EXPECT_EQ(0u, broker->pump());
+    EXPECT_EQ(10u, values->values().size());
+    for (int i = 0; i < 10; ++i) {
+        EXPECT_EQ(i, values->values()[i]);
+    }
+}
+
+// Off-thread subscribers run in parallel, keep their own order and do not
+// hold up inline subscribers
+TEST(CallbackExecutorTest, PoolAndDedicatedSubscribers) {
+    auto broker = std::make_shared<MCPBroker>();
+    auto pool = std::make_shared<WorkStealingPool>(2);
+
+    SubscriptionOptions pooled;
+    pooled.executor = CallbackExecutor::SHARED_POOL;
+    pooled.pool = pool;
+    SubscriptionOptions dedicated;
+    dedicated.executor = CallbackExecutor::DEDICATED_THREAD;
+
+    auto gateA = std::make_shared<GateSubscriber>();
+    auto gateB = std::make_shared<GateSubscriber>();
+    auto inlineValues = std::make_shared<ValueSubscriber>();
+    auto slowValues = std::make_shared<ValueSubscriber>(std::chrono::microseconds(200));
+    ASSERT_TRUE(broker->subscribe("exec/topic", gateA, pooled));
+    ASSERT_TRUE(broker->subscribe("exec/topic", gateB, pooled));
+    ASSERT_TRUE(broker->subscribe("exec/topic", inlineValues));
+    ASSERT_TRUE(broker->subscribe("exec/topic", slowValues, dedicated));
+
+    for (int i = 0; i < 50; ++i) {
+        ASSERT_TRUE(broker->publish(makeMessage("exec/topic", i)));
+    }
+
+    // Both blocking subscribers are inside a callback at the same time, and
+    // the inline subscriber got everything while they block
+    EXPECT_TRUE(waitUntil([&] { return gateA->entered() && gateB->entered(); }));
+    EXPECT_TRUE(waitUntil([&] { return inlineValues->values().size() == 50; }));
+
+    EXPECT_TRUE(waitUntil([&] { return slowValues->values().size() == 50; }));
+    std::vector<int> expected;
+    for (int i = 0; i < 50; ++i) {
+        expected.push_back(i);
+    }
+    EXPECT_EQ(expected, inlineValues->values());
+    EXPECT_EQ(expected, slowValues->values());
+
+    gateA->release();
+    gateB->release();
+
+    // Nothing is delivered after unsubscribing
+    ASSERT_TRUE(broker->unsubscribe("exec/topic", slowValues));
+    ASSERT_TRUE(broker->publish(makeMessage("exec/topic", 50)));
+    EXPECT_TRUE(waitUntil([&] { return inlineValues->values().size() == 51; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    EXPECT_EQ(50u, slowValues->values().size());
+}
+
+// Strands serialize their own tasks but run in parallel with each other
+TEST(CallbackExecutorTest, StrandOrderingOnWorkStealingPool) {
+    auto pool = std::make_shared<WorkStealingPool>(4);
+    EXPECT_EQ(4u, pool->getThreadCount());
+
+    const int strandCount = 8;
+    const int tasksPerStrand = 200;
+    std::vector<std::shared_ptr<Strand>> strands;
+    std::vector<std::vector<int>> results(strandCount);
+    std::vector<std::atomic<int>> running(strandCount);
+    std::atomic<bool> overlapped{false};
+    std::atomic<int> done{0};
+
+    for (int s = 0; s < strandCount; ++s) {
+        running[s] = 0;
+        strands.push_back(std::make_shared<Strand>(pool));
+    }
+    for (int i = 0; i < tasksPerStrand; ++i) {
+        for (int s = 0; s < strandCount; ++s) {
+            strands[s]->post([&, s, i]() {
+                if (++running[s] > 1) {
+                    overlapped = true;
+                }
+                results[s].push_back(i);
+                --running[s];
+                ++done;
+            });
+        }
+    }
+
+    ASSERT_TRUE(waitUntil([&] { return done == strandCount * tasksPerStrand; }));
+    EXPECT_FALSE(overlapped);
+    for (int s = 0; s < strandCount; ++s) {
+        ASSERT_EQ(static_cast<std::size_t>(tasksPerStrand), results[s].size());
+        for (int i = 0; i < tasksPerStrand; ++i) {
+            EXPECT_EQ(i, results[s][i]);
+        }
+    }
+
+    // Closed strands drop later work
+    strands[0]->close();
+    strands[0]->post([&]() { ++done; });
+    EXPECT_EQ(0u, strands[0]->pending());
+}
+
+// Each message goes to exactly one member of each consumer group
+TEST(ConsumerGroupTest, RoundRobinAndLeastLoaded) {
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+
+    SubscriptionOptions workers;
+    workers.group = "workers";
+    std::vector<std::shared_ptr<ValueSubscriber>> members;
+    for (int i = 0; i < 3; ++i) {
+        members.push_back(std::make_shared<ValueSubscriber>());
+        ASSERT_TRUE(broker->subscribe("jobs", members.back(), workers));
+    }
+    auto observer = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("jobs", observer));
+
+    for (int i = 0; i < 30; ++i) {
+        ASSERT_TRUE(broker->publish(makeMessage("jobs", i)));
+    }
+    EXPECT_EQ(30u, broker->pump());
+
+    std::vector<int> all;
+    for (const auto& member : members) {
+        std::vector<int> values = member->values();
+        EXPECT_EQ(10u, values.size());
+        all.insert(all.end(), values.begin(), values.end());
+    }
+    std::sort(all.begin(), all.end());
+    EXPECT_EQ(observer->values(), all);
+
+    // A member that is still busy is passed over while an idle one is free
+    SubscriptionOptions balanced;
+    balanced.group = "renderers";
+    balanced.balancing = GroupBalancing::LEAST_LOADED;
+    SubscriptionOptions balancedPooled = balanced;
+    balancedPooled.executor = CallbackExecutor::DEDICATED_THREAD;
+
+    auto busy = std::make_shared<GateSubscriber>();
+    auto idle = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("render", busy, balancedPooled));
+    ASSERT_TRUE(broker->subscribe("render", idle, balanced));
+
+    for (int i = 0; i < 10; ++i) {
+        ASSERT_TRUE(broker->publish(makeMessage("render", i)));
+    }
+    EXPECT_EQ(10u, broker->pump());
+    busy->waitEntered();
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 5, 6, 7, 8, 9}), idle->values());
+    busy->release();
+}
+
+// Without credit, messages are held, conflated or dropped instead of delivered
+TEST(FlowControlTest, HoldConflateAndDrop) {
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+
+    auto holdCredits = std::make_shared<DeliveryCredits>(2);
+    auto conflateCredits = std::make_shared<DeliveryCredits>(2);
+    auto dropCredits = std::make_shared<DeliveryCredits>(2);
+
+    SubscriptionOptions hold;
+    hold.credits = holdCredits;
+    hold.creditPolicy = CreditPolicy::HOLD;
+    SubscriptionOptions conflate;
+    conflate.credits = conflateCredits;
+    conflate.creditPolicy = CreditPolicy::CONFLATE;
+    SubscriptionOptions drop;
+    drop.credits = dropCredits;
+    drop.creditPolicy = CreditPolicy::DROP;
+
+    auto held = std::make_shared<ValueSubscriber>();
+    auto conflated = std::make_shared<ValueSubscriber>();
+    auto dropped = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("flow", held, hold));
+    ASSERT_TRUE(broker->subscribe("flow", conflated, conflate));
+    ASSERT_TRUE(broker->subscribe("flow", dropped, drop));
+
+    for (int i = 0; i < 6; ++i) {
+        ASSERT_TRUE(broker->publish(makeMessage("flow", i)));
+    }
+    broker->pump();
+
+    // Only the first two fit the initial credit
+    EXPECT_EQ((std::vector<int>{0, 1}), held->values());
+    EXPECT_EQ((std::vector<int>{0, 1}), conflated->values());
+    EXPECT_EQ((std::vector<int>{0, 1}), dropped->values());
+    EXPECT_EQ(4u, dropCredits->getDroppedCount());
+    EXPECT_EQ(3u, conflateCredits->getConflatedCount());
+
+    // Granted credit releases the held messages on the next pump, in order
+    holdCredits->grant(10);
+    conflateCredits->grant(10);
+    dropCredits->grant(10);
+    broker->pump();
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4, 5}), held->values());
+    EXPECT_EQ((std::vector<int>{0, 1, 5}), conflated->values());
+    EXPECT_EQ((std::vector<int>{0, 1}), dropped->values());
+
+    // With credit, messages flow straight through
+    ASSERT_TRUE(broker->publish(makeMessage("flow", 6)));
+    broker->pump();
+    EXPECT_EQ(6, held->values().back());
+    EXPECT_EQ(6, conflated->values().back());
+    EXPECT_EQ(6, dropped->values().back());
+    EXPECT_EQ(5u, holdCredits->available());
+}
+
+// A credit grant wakes an idle worker to release held messages, with no
+// further publication on the topic
+TEST(FlowControlTest, GrantWakesWorker) {
+    auto broker = std::make_shared<MCPBroker>();
+
+    auto credits = std::make_shared<DeliveryCredits>(1);
+    SubscriptionOptions options;
+    options.credits = credits;
+    options.creditPolicy = CreditPolicy::HOLD;
+
+    auto subscriber = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("flow", subscriber, options));
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(broker->publish(makeMessage("flow", i)));
+    }
+    ASSERT_TRUE(waitUntil([&] { return subscriber->values().size() == 1; }));
+
+    // Grant from another thread, as an audio thread would
+    std::thread granter([&] { credits->grant(3); });
+    granter.join();
+    ASSERT_TRUE(waitUntil([&] { return subscriber->values().size() == 4; }));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), subscriber->values());
+    EXPECT_EQ(0u, credits->available());
+}
+
+// A directed message reaches only its target, in send order
+TEST(DirectedMessageTest, SendToModule) {
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+
+    auto target = std::make_shared<ValueSubscriber>();
+    auto other = std::make_shared<ValueSubscriber>();
+    auto topicSubscriber = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->registerEndpoint(7, target));
+    ASSERT_TRUE(broker->registerEndpoint(8, other));
+    EXPECT_FALSE(broker->registerEndpoint(7, other));
+    ASSERT_TRUE(broker->subscribe("command/preset-load", topicSubscriber));
+
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_TRUE(broker->sendTo(7, makeMessage("command/preset-load", i)));
+    }
+    EXPECT_FALSE(broker->sendTo(9, makeMessage("command/preset-load", 0)));
+    EXPECT_EQ(5u, broker->pump());
+
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3, 4}), target->values());
+    EXPECT_TRUE(other->values().empty());
+    EXPECT_TRUE(topicSubscriber->values().empty());
+
+    // Unregistered and expired targets are unreachable
+    EXPECT_TRUE(broker->unregisterEndpoint(7));
+    EXPECT_FALSE(broker->sendTo(7, makeMessage("command/preset-load", 5)));
+    other.reset();
+    EXPECT_FALSE(broker->sendTo(8, makeMessage("command/preset-load", 5)));
+    ASSERT_TRUE(broker->registerEndpoint(8, target));
+}
+
+// Requests reach the topic's handler only when asked and get exactly one outcome
+TEST(RequestReplyTest, FutureCallbackTimeoutAndDeferredReply) {
+    class DumpHandler : public IMCPRequestHandler_V1 {
+    public:
+        std::shared_ptr<MCPMessage_V1> onMCPRequest(const MCPMessage_V1* request) override {
+            m_calls++;
+            int query = serialization::extractMessageData<int>(request);
+            if (query < 0) {
+                throw std::runtime_error("bad query");
+            }
+            if (query == 0) {
+                // Answer later
+                m_deferred = request->correlationId;
+                return nullptr;
+            }
+            return makeMessage("state/dump", query * 10);
+        }
+        std::atomic<int> m_calls{0};
+        std::atomic<uint64_t> m_deferred{0};
+    };
+
+    auto broker = std::make_shared<MCPBroker>();
+    auto handler = std::make_shared<DumpHandler>();
+    ASSERT_TRUE(broker->registerRequestHandler("state/dump", handler));
+    EXPECT_FALSE(broker->registerRequestHandler("state/dump", std::make_shared<DumpHandler>()));
+    EXPECT_EQ(0, handler->m_calls.load());
+
+    auto request = makeMessage("state/dump", 4);
+    Reply answer = broker->request(request, std::chrono::milliseconds(2000)).get();
+    ASSERT_EQ(ReplyStatus::OK, answer.status);
+    EXPECT_EQ(40, serialization::extractMessageData<int>(answer.message.get()));
+    EXPECT_NE(0u, request->correlationId);
+    EXPECT_EQ(request->correlationId, answer.message->correlationId);
+
+    EXPECT_EQ(ReplyStatus::FAILED,
+              broker->request(makeMessage("state/dump", -1), std::chrono::milliseconds(2000)).get().status);
+    EXPECT_EQ(ReplyStatus::NO_HANDLER,
+              broker->request(makeMessage("state/none", 1), std::chrono::milliseconds(2000)).get().status);
+    EXPECT_FALSE(broker->request(makeMessage("state/none", 1), [](const Reply&) {},
+                                 std::chrono::milliseconds(10)));
+
+    // A deferred answer arrives through reply()
+    std::promise<Reply> deferred;
+    ASSERT_TRUE(broker->request(makeMessage("state/dump", 0), [&deferred](const Reply& reply) {
+        deferred.set_value(reply);
+    }, std::chrono::milliseconds(2000)));
+    ASSERT_TRUE(waitUntil([&] { return handler->m_deferred.load() != 0; }));
+    auto late = makeMessage("state/dump", 99);
+    late->correlationId = handler->m_deferred.load();
+    EXPECT_TRUE(broker->reply(late));
+    EXPECT_FALSE(broker->reply(late));
+    Reply deferredAnswer = deferred.get_future().get();
+    EXPECT_EQ(ReplyStatus::OK, deferredAnswer.status);
+    EXPECT_EQ(99, serialization::extractMessageData<int>(deferredAnswer.message.get()));
+
+    // An unanswered request times out
+    auto start = std::chrono::steady_clock::now();
+    Reply timedOut = broker->request(makeMessage("state/dump", 0), std::chrono::milliseconds(30)).get();
+    EXPECT_EQ(ReplyStatus::TIMEOUT, timedOut.status);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(30));
+    EXPECT_EQ(4, handler->m_calls.load());
+}
+
+// Deadbands suppress values close to the last one delivered to that subscriber
+TEST(DeadbandTest, AbsoluteAndRelative) {
+    class FloatSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            m_received++;
+            try {
+                m_values.push_back(serialization::extractMessageData<float>(message));
+            } catch (const MCPSerializationError& e) {
+                // Not a float
+            }
+        }
+        std::vector<float> m_values;
+        int m_received = 0;
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    SubscriptionOptions absolute;
+    absolute.deadbandAbsolute = 0.1;
+    SubscriptionOptions relative;
+    relative.deadbandRelative = 0.005;
+
+    auto all = std::make_shared<FloatSubscriber>();
+    auto absoluteSubscriber = std::make_shared<FloatSubscriber>();
+    auto relativeSubscriber = std::make_shared<FloatSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/parameter2", all));
+    ASSERT_TRUE(broker->subscribe("reference/parameter2", absoluteSubscriber, absolute));
+    ASSERT_TRUE(broker->subscribe("reference/parameter2", relativeSubscriber, relative));
+
+    std::vector<float> steps = {1.0f, 1.001f, 1.004f, 1.008f, 1.05f, 1.11f, 1.112f, 0.9f};
+    for (float step : steps) {
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter2", 1, step)));
+    }
+    // Non-numeric payloads are never filtered
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter2", 1, std::string("reset"))));
+    broker->pump();
+
+    EXPECT_EQ(9, all->m_received);
+    EXPECT_EQ(4, absoluteSubscriber->m_received);
+    EXPECT_EQ(6, relativeSubscriber->m_received);
+    EXPECT_EQ((std::vector<float>{1.0f, 1.11f, 0.9f}), absoluteSubscriber->m_values);
+    EXPECT_EQ((std::vector<float>{1.0f, 1.008f, 1.05f, 1.11f, 0.9f}), relativeSubscriber->m_values);
+
+    // A value dropped for lack of credit does not become the reference
+    auto credits = std::make_shared<DeliveryCredits>(1);
+    SubscriptionOptions gated = absolute;
+    gated.credits = credits;
+    gated.creditPolicy = CreditPolicy::DROP;
+    auto gatedSubscriber = std::make_shared<FloatSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", gatedSubscriber, gated));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 1.0f)));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 2.0f)));
+    broker->pump();
+    credits->grant();
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 2.05f)));
+    broker->pump();
+    EXPECT_EQ((std::vector<float>{1.0f, 2.05f}), gatedSubscriber->m_values);
+}
+
+TEST(RateLimitTest, LatestValueWithTrailingUpdate) {
+    class FloatSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            m_values.push_back(serialization::extractMessageData<float>(message));
+        }
+        std::vector<float> m_values;
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    SubscriptionOptions limited;
+    limited.minInterval = std::chrono::milliseconds(20);
+
+    auto all = std::make_shared<FloatSubscriber>();
+    auto meter = std::make_shared<FloatSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/parameter2", all));
+    ASSERT_TRUE(broker->subscribe("reference/parameter2", meter, limited));
+
+    // A burst: the first value goes through, the rest replace each other
+    for (int i = 1; i <= 5; ++i) {
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter2", 1, static_cast<float>(i))));
+    }
+    broker->pump();
+    EXPECT_EQ(5u, all->m_values.size());
+    EXPECT_EQ((std::vector<float>{1.0f}), meter->m_values);
+
+    // The final value of the burst arrives once the interval has passed
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    broker->pump();
+    EXPECT_EQ((std::vector<float>{1.0f, 5.0f}), meter->m_values);
+
+    // Nothing is left over, and an isolated later value is delivered directly
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter2", 1, 6.0f)));
+    broker->pump();
+    EXPECT_EQ((std::vector<float>{1.0f, 5.0f, 6.0f}), meter->m_values);
+}
+
+TEST(TopicDescriptorTest, RejectsMismatchedPublishes) {
+    class Provider : public IMCPProvider_V1 {
+    public:
+        std::vector<std::string> getProvidedTopics() const override { return {"reference/parameter1"}; }
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    auto provider = std::make_shared<Provider>();
+    auto otherProvider = std::make_shared<Provider>();
+
+    TopicDescriptor descriptor;
+    descriptor.payloadType = PayloadType::INTEGER;
+    descriptor.dataFormat = DataFormat::MSGPACK;
+    descriptor.kind = TopicKind::STATE;
+    descriptor.nominalRate = 100.0;
+    descriptor.maxPayloadSize = 16;
+    ASSERT_TRUE(broker->registerContext("reference/parameter1", provider, descriptor));
+    EXPECT_EQ(TopicKind::STATE, broker->getTopicKind("reference/parameter1"));
+
+    // Every provider of the topic must agree on the declaration
+    TopicDescriptor conflicting = descriptor;
+    conflicting.payloadType = PayloadType::FLOAT;
+    EXPECT_FALSE(broker->registerContext("reference/parameter1", otherProvider, conflicting));
+    EXPECT_EQ(1u, broker->findProviders("reference/parameter1").size());
+    EXPECT_TRUE(broker->registerContext("reference/parameter1", otherProvider, descriptor));
+
+    TopicDescriptor declared;
+    ASSERT_TRUE(broker->getTopicDescriptor("reference/parameter1", declared));
+    EXPECT_EQ(descriptor, declared);
+    EXPECT_FALSE(broker->getTopicDescriptor("reference/parameter2", declared));
+
+    auto subscriber = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", subscriber));
+
+    EXPECT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 7)));
+    EXPECT_FALSE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 7.5)));
+    EXPECT_FALSE(broker->publish(serialization::createJSONMessage("reference/parameter1", 1, 7)));
+    EXPECT_FALSE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, std::string(32, 'x'))));
+    broker->pump();
+    EXPECT_EQ(std::vector<int>{7}, subscriber->values());
+
+    // Undeclared topics are not checked
+    EXPECT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter2", 1, 7.5)));
+}
+
+TEST(TopicLiteralTest, HashedLookupAndCollisionCheck) {
+    using namespace mcp::literals;
+    constexpr TopicLiteral PARAMETER1("reference/parameter1");
+    static_assert(hashTopicName("a", 1) == 0xaf63dc4c8601ec8cull, "FNV-1a 64");
+    static_assert(PARAMETER1.hash() == "reference/parameter1"_topic.hash(), "same name, same hash");
+    EXPECT_EQ(hashTopicName(std::string("reference/parameter1")), PARAMETER1.hash());
+
+    // The dispatch queue refuses a second topic under an indexed hash
+    DispatchQueue queue;
+    EXPECT_TRUE(queue.indexTopicHash("reference/parameter1", 42));
+    EXPECT_TRUE(queue.indexTopicHash("reference/parameter1", 42));
+    EXPECT_FALSE(queue.indexTopicHash("reference/parameter2", 42));
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    auto literalSubscriber = std::make_shared<ValueSubscriber>();
+    auto stringSubscriber = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe(PARAMETER1, literalSubscriber));
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", stringSubscriber));
+    EXPECT_FALSE(broker->subscribe(PARAMETER1, literalSubscriber));
+
+    // Hashed and plain messages reach the same subscribers in order
+    auto hashed = serialization::createMsgPackMessage(PARAMETER1, 1, 1);
+    EXPECT_EQ(PARAMETER1.hash(), hashed->topicHash);
+    ASSERT_TRUE(broker->publish(hashed));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 2)));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage(PARAMETER1, 1, 3)));
+    broker->pump();
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), literalSubscriber->values());
+    EXPECT_EQ((std::vector<int>{1, 2, 3}), stringSubscriber->values());
+
+    // The index follows the topic being emptied and subscribed again
+    ASSERT_TRUE(broker->unsubscribe("reference/parameter1", literalSubscriber));
+    ASSERT_TRUE(broker->unsubscribe("reference/parameter1", stringSubscriber));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage(PARAMETER1, 1, 4)));
+    broker->pump();
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", stringSubscriber));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage(PARAMETER1, 1, 5)));
+    broker->pump();
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 5}), stringSubscriber->values());
+}
+
+TEST(SnapshotTest, WarmStartRestoresStateTopics) {
+    std::string path = ::testing::TempDir() + "mcp_snapshot_test.bin";
+    std::remove(path.c_str());
+
+    {
+        auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+        EXPECT_FALSE(broker->enableSnapshot(path));
+        broker->setTopicKind("reference/parameter1", TopicKind::STATE);
+        broker->setTopicKind("reference/parameter2", TopicKind::STATE);
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 3, 1)));
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 3, 2)));
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/events", 3, 9)));
+        broker->pump();
+
+        auto retained = broker->getRetainedValue("reference/parameter1");
+        ASSERT_TRUE(retained != nullptr);
+        EXPECT_EQ(2, serialization::extractMessageData<int>(retained.get()));
+        EXPECT_TRUE(broker->getRetainedValue("reference/parameter2") == nullptr);
+        EXPECT_TRUE(broker->getRetainedValue("reference/events") == nullptr);
+    }
+
+    // The next broker has the value before any provider publishes
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    ASSERT_TRUE(broker->enableSnapshot(path));
+    EXPECT_EQ(TopicKind::STATE, broker->getTopicKind("reference/parameter1"));
+    auto restored = broker->getRetainedValue("reference/parameter1");
+    ASSERT_TRUE(restored != nullptr);
+    EXPECT_EQ(3, restored->senderModuleId);
+    EXPECT_EQ(DataFormat::MSGPACK, restored->dataFormat);
+    EXPECT_EQ(2, serialization::extractMessageData<int>(restored.get()));
+
+    SubscriptionOptions replay;
+    replay.replayHistory = true;
+    auto subscriber = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", subscriber, replay));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 3, 5)));
+    broker->pump();
+    EXPECT_EQ((std::vector<int>{2, 5}), subscriber->values());
+
+    // Damaged files are rejected
+    {
+        FILE* file = std::fopen(path.c_str(), "r+b");
+        ASSERT_TRUE(file != nullptr);
+        std::fputc('X', file);
+        std::fclose(file);
+    }
+    EXPECT_FALSE(broker->loadSnapshot(path));
+    broker.reset();
+    std::remove(path.c_str());
+}
+
+TEST(SnapshotTest, ShutdownSavesBeforeClearing) {
+    std::string path = ::testing::TempDir() + "mcp_shutdown_snapshot_test.bin";
+    std::remove(path.c_str());
+
+    {
+        auto broker = MCPBroker::getInstance();
+        EXPECT_FALSE(broker->enableSnapshot(path));
+        broker->setTopicKind("reference/parameter1", TopicKind::STATE);
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 3, 7)));
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (!broker->getRetainedValue("reference/parameter1") && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        ASSERT_TRUE(broker->getRetainedValue("reference/parameter1") != nullptr);
+    }
+    shutdownMCPBroker();
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    ASSERT_TRUE(broker->loadSnapshot(path));
+    auto restored = broker->getRetainedValue("reference/parameter1");
+    ASSERT_TRUE(restored != nullptr);
+    EXPECT_EQ(7, serialization::extractMessageData<int>(restored.get()));
+
+    // Destroying a cleared broker does not overwrite the file with nothing
+    {
+        auto cleared = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+        ASSERT_TRUE(cleared->enableSnapshot(path));
+        cleared->clearAllRegistries();
+    }
+    ASSERT_TRUE(broker->loadSnapshot(path));
+    EXPECT_TRUE(broker->getRetainedValue("reference/parameter1") != nullptr);
+    broker.reset();
+    std::remove(path.c_str());
+}
+
+TEST(BatchedSubscriberTest, QueuedMessagesArriveInOneCall) {
+    class BatchSubscriber : public IMCPSubscriber_V2 {
+    public:
+        void onMCPMessages(const MCPMessage_V1* const* messages, std::size_t count) override {
+            m_batchSizes.push_back(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                m_values.push_back(serialization::extractMessageData<int>(messages[i]));
+            }
+        }
+        std::vector<std::size_t> m_batchSizes;
+        std::vector<int> m_values;
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    auto batched = std::make_shared<BatchSubscriber>();
+    auto single = std::make_shared<ValueSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", batched));
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", single));
+
+    // Everything published before the drain runs arrives as one batch, in order
+    for (int i = 1; i <= 5; ++i) {
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, i)));
+    }
+    broker->pump();
+    EXPECT_EQ((std::vector<std::size_t>{5}), batched->m_batchSizes);
+    EXPECT_EQ((std::vector<int>{1, 2, 3, 4, 5}), batched->m_values);
+    EXPECT_EQ(5u, single->values().size());
+
+    // Single-message paths reach the subscriber as a batch of one
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 6)));
+    broker->pump();
+    EXPECT_EQ((std::vector<std::size_t>{5, 1}), batched->m_batchSizes);
+    EXPECT_EQ(6, batched->m_values.back());
+
+    // A drain queued before unsubscribing finds the mailbox closed, and a new
+    // subscription gets a fresh mailbox
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 7)));
+    EXPECT_EQ(1u, broker->pump(1));
+    ASSERT_TRUE(broker->unsubscribe("reference/parameter1", batched));
+    broker->pump();
+    EXPECT_EQ((std::vector<std::size_t>{5, 1}), batched->m_batchSizes);
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", batched));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, 8)));
+    broker->pump();
+    EXPECT_EQ((std::vector<std::size_t>{5, 1, 1}), batched->m_batchSizes);
+    EXPECT_EQ(8, batched->m_values.back());
+}
+
+TEST(ErrorReportTest, DeduplicatedAndRateLimited) {
+    class FailingSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            throw std::runtime_error("cannot handle value");
+        }
+    };
+    class ReportSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            m_reports.push_back(serialization::extractMessageData<ErrorReport>(message));
+        }
+        std::vector<ErrorReport> m_reports;
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    broker->setErrorReportInterval(std::chrono::milliseconds(50));
+    auto failing = std::make_shared<FailingSubscriber>();
+    auto reports = std::make_shared<ReportSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/parameter1", failing));
+    ASSERT_TRUE(broker->subscribe(ERROR_REPORTS_TOPIC, reports));
+
+    // The first failure is reported right away, the rest wait for the interval
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter1", 1, i)));
+    }
+    broker->pump();
+    ASSERT_EQ(1u, reports->m_reports.size());
+    EXPECT_EQ("reference/parameter1", reports->m_reports[0].source);
+    EXPECT_EQ(ErrorCode::SUBSCRIBER_FAILED, reports->m_reports[0].code);
+    EXPECT_EQ(0u, reports->m_reports[0].message.find("cannot handle value"));
+    EXPECT_NE(std::string::npos, reports->m_reports[0].message.find("FailingSubscriber"));
+    EXPECT_EQ(1u, reports->m_reports[0].count);
+
+    // One summary per (source, code) pair, with the occurrences counted
+    broker->reportError("test.module", ErrorCode::SERIALIZATION_FAILED, ErrorSeverity::CRITICAL, "bad payload");
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    broker->pump();
+    ASSERT_EQ(3u, reports->m_reports.size());
+    std::sort(reports->m_reports.begin() + 1, reports->m_reports.end(),
+        [](const ErrorReport& a, const ErrorReport& b) { return a.source < b.source; });
+    EXPECT_EQ(99u, reports->m_reports[1].count);
+    EXPECT_EQ(100u, reports->m_reports[1].total);
+    EXPECT_EQ("test.module", reports->m_reports[2].source);
+    EXPECT_EQ(ErrorSeverity::CRITICAL, reports->m_reports[2].severity);
+    EXPECT_EQ(1u, reports->m_reports[2].count);
+
+    // Nothing new, nothing published
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    broker->pump();
+    EXPECT_EQ(3u, reports->m_reports.size());
+
+    // Failures on a strand are reported as well
+    SubscriptionOptions pooled;
+    pooled.executor = CallbackExecutor::SHARED_POOL;
+    ASSERT_TRUE(broker->subscribe("reference/parameter2", failing, pooled));
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameter2", 1, 1)));
+    broker->pump();
+    ASSERT_TRUE(waitUntil([&] {
+        broker->pump();
+        return reports->m_reports.size() == 4;
+    }));
+    EXPECT_EQ("reference/parameter2", reports->m_reports[3].source);
+    EXPECT_EQ(ErrorCode::SUBSCRIBER_FAILED, reports->m_reports[3].code);
+}
+
+TEST(ContentDedupTest, SuppressesRepeatsAndSharesCachedPayloads) {
+    class PayloadSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            m_payloads.push_back(message->data.get());
+            m_values.push_back(serialization::extractMessageData<std::vector<float>>(message));
+        }
+        std::vector<const void*> m_payloads;
+        std::vector<std::vector<float>> m_values;
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    ContentDedupConfig config;
+    config.minPayloadSize = 64;
+    broker->setContentDedup(config);
+    broker->setTopicKind("reference/preset", TopicKind::STATE);
+
+    auto presets = std::make_shared<PayloadSubscriber>();
+    auto events = std::make_shared<PayloadSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/preset", presets));
+    ASSERT_TRUE(broker->subscribe("reference/parameters", events));
+
+    std::vector<float> preset(64, 0.25f);
+    std::vector<float> other(64, 0.5f);
+
+    // Unchanged state is dispatched once
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/preset", 1, preset)));
+    }
+    ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/preset", 1, other)));
+    broker->pump();
+    EXPECT_EQ((std::vector<std::vector<float>>{preset, other}), presets->m_values);
+    EXPECT_EQ(2u, broker->getContentDedupStats().suppressed);
+
+    // Repeated events are all delivered, the repeats by reference to one cached blob
+    std::vector<float> automation(64, 0.75f);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("reference/parameters", 1, automation)));
+    }
+    broker->pump();
+    ASSERT_EQ(3u, events->m_values.size());
+    EXPECT_EQ(automation, events->m_values[2]);
+    EXPECT_NE(events->m_payloads[0], events->m_payloads[1]);
+    EXPECT_EQ(events->m_payloads[1], events->m_payloads[2]);
+
+    ContentDedupStats stats = broker->getContentDedupStats();
+    EXPECT_EQ(2u, stats.shared);
+    EXPECT_EQ(3u, stats.cachedPayloads);
+    EXPECT_GE(stats.cachedBytes, 3 * automation.size() * sizeof(float));
+}
+
+TEST(ContentDedupTest, RecognizesRepeatsAfterDispatch) {
+    class CountingSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            m_count++;
+        }
+        std::atomic<int> m_count{0};
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::WORKER_THREADS);
+    ContentDedupConfig config;
+    config.minPayloadSize = 64;
+    broker->setContentDedup(config);
+    broker->setTopicKind("reference/preset", TopicKind::STATE);
+    auto presets = std::make_shared<CountingSubscriber>();
+    auto events = std::make_shared<CountingSubscriber>();
+    ASSERT_TRUE(broker->subscribe("reference/preset", presets));
+    ASSERT_TRUE(broker->subscribe("reference/parameters", events));
+
+    // Each message is dispatched and released before the next is published
+    auto publishAndWait = [&](const std::string& topic, const std::vector<float>& payload,
+                              const CountingSubscriber& subscriber, int expected) {
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage(topic, 1, payload)));
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (subscriber.m_count < expected && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    };
+
+    std::vector<float> preset(64, 0.25f);
+    std::vector<float> automation(64, 0.75f);
+    for (int i = 0; i < 3; ++i) {
+        publishAndWait("reference/preset", preset, *presets, 1);
+        publishAndWait("reference/parameters", automation, *events, i + 1);
+    }
+    EXPECT_EQ(1, presets->m_count.load());
+    EXPECT_EQ(3, events->m_count.load());
+
+    ContentDedupStats stats = broker->getContentDedupStats();
+    EXPECT_EQ(2u, stats.suppressed);
+    EXPECT_EQ(2u, stats.shared);
+}
+
+} // namespace test
+} // namespace mcp
@@ -502,4 +502,220 @@ TEST_F(MCPPerformanceTest, MessageSizeImpact) {
     }
 }
 
+// Pure dispatch cost, measured on the calling thread without a broker thread
+TEST(MCPDispatchBenchmark, ManualPumpDispatchCost) {
+    class CountingSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            m_received++;
+        }
+        int m_received = 0;
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    auto subscriber = std::make_shared<CountingSubscriber>();
+    ASSERT_TRUE(broker->subscribe("benchmark/pump", subscriber));
+
+    const int messageCount = 20000;
+    auto message = serialization::createMsgPackMessage("benchmark/pump", 1, 1.0f);
+    for (int i = 0; i < messageCount; ++i) {
+        broker->publish(message);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::size_t dispatched = broker->pump();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    double nsPerMessage = std::chrono::duration<double, std::nano>(elapsed).count() / messageCount;
+    std::cout << "Manual pump dispatch: " << std::fixed << std::setprecision(1)
+              << nsPerMessage << " ns/message" << std::endl;
+
+    EXPECT_EQ(static_cast<std::size_t>(messageCount), dispatched);
+    EXPECT_EQ(messageCount, subscriber->m_received);
+}
+
+// Delivery delay of a quiet topic while a noisy neighbour publishes faster
+// than the broker dispatches, under each scheduling policy
+TEST(MCPDispatchBenchmark, NoisyNeighborQuietTopicLatency) {
+    class LatencySubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            if (message->topic == "benchmark/quiet") {
+                int round = serialization::extractMessageData<int>(message);
+                m_maxDelay = std::max(m_maxDelay, std::chrono::steady_clock::now() - m_publishTimes[round]);
+                m_maxDispatchedAhead = std::max(m_maxDispatchedAhead, m_dispatched - m_publishCounts[round]);
+                m_quiet++;
+            }
+            m_dispatched++;
+        }
+
+        // Note a quiet publish, indexed by its round
+        void quietPublished() {
+            m_publishTimes.push_back(std::chrono::steady_clock::now());
+            m_publishCounts.push_back(m_dispatched);
+        }
+
+        std::vector<std::chrono::steady_clock::time_point> m_publishTimes;
+        std::vector<uint64_t> m_publishCounts;
+        std::chrono::steady_clock::duration m_maxDelay{0};
+        uint64_t m_dispatched = 0;
+        uint64_t m_maxDispatchedAhead = 0;
+        int m_quiet = 0;
+    };
+
+    auto run = [](SchedulingPolicy policy, const char* name) {
+        auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+        broker->setSchedulingPolicy(policy);
+        auto subscriber = std::make_shared<LatencySubscriber>();
+        broker->subscribe("benchmark/noisy", subscriber);
+        broker->subscribe("benchmark/quiet", subscriber);
+
+        // Each round the noisy topic publishes twice what the broker dispatches
+        const int rounds = 50;
+        auto noisy = serialization::createMsgPackMessage("benchmark/noisy", 1, 1.0f);
+        for (int round = 0; round < rounds; ++round) {
+            for (int i = 0; i < 200; ++i) {
+                broker->publish(noisy);
+            }
+            subscriber->quietPublished();
+            broker->publish(serialization::createMsgPackMessage("benchmark/quiet", 2, round));
+            broker->pump(100);
+        }
+        broker->pump();
+
+        std::cout << name << ": quiet topic max delay "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(subscriber->m_maxDelay).count()
+                  << " us, up to " << subscriber->m_maxDispatchedAhead
+                  << " messages dispatched ahead of it" << std::endl;
+        EXPECT_EQ(rounds, subscriber->m_quiet);
+        return subscriber->m_maxDispatchedAhead;
+    };
+
+    uint64_t edfAhead = run(SchedulingPolicy::EARLIEST_DEADLINE, "Earliest deadline");
+    uint64_t drrAhead = run(SchedulingPolicy::DEFICIT_ROUND_ROBIN, "Deficit round-robin");
+
+    // Round-robin bounds the wait to one noisy turn; FIFO order grows with the backlog
+    EXPECT_LE(drrAhead, 1u);
+    EXPECT_GT(edfAhead, 1000u);
+}
+
+// Time to load a 500-module patch, one call per topic versus the bulk APIs
+TEST(MCPDispatchBenchmark, PatchLoad) {
+    class PatchModule : public IMCPProvider_V1, public IMCPSubscriber_V1 {
+    public:
+        std::vector<std::string> getProvidedTopics() const override { return m_provided; }
+        void onMCPMessage(const MCPMessage_V1* message) override {}
+
+        std::vector<std::string> m_provided;
+        std::vector<std::string> m_subscribed;
+    };
+
+    // Each module provides 4 topics and listens to 8 topics of its neighbours
+    const int moduleCount = 500;
+    std::vector<std::shared_ptr<PatchModule>> modules;
+    for (int i = 0; i < moduleCount; ++i) {
+        auto module = std::make_shared<PatchModule>();
+        for (int t = 0; t < 4; ++t) {
+            module->m_provided.push_back("patch/module" + std::to_string(i) + "/out" + std::to_string(t));
+        }
+        for (int t = 0; t < 8; ++t) {
+            int source = (i + 1 + t / 4) % moduleCount;
+            module->m_subscribed.push_back("patch/module" + std::to_string(source) + "/out" + std::to_string(t % 4));
+        }
+        modules.push_back(module);
+    }
+
+    auto load = [&](bool bulk, const char* name) {
+        auto start = std::chrono::steady_clock::now();
+        auto broker = std::make_shared<MCPBroker>();
+        std::size_t registered = 0;
+        std::size_t subscribed = 0;
+        for (const auto& module : modules) {
+            if (bulk) {
+                registered += broker->registerContexts(module->m_provided, module);
+                subscribed += broker->subscribeMany(module->m_subscribed, module);
+                continue;
+            }
+            for (const auto& topic : module->m_provided) {
+                registered += broker->registerContext(topic, module) ? 1 : 0;
+            }
+            for (const auto& topic : module->m_subscribed) {
+                subscribed += broker->subscribe(topic, module) ? 1 : 0;
+            }
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+
+        std::cout << name << ": " << moduleCount << " modules loaded in "
+                  << std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count()
+                  << " us" << std::endl;
+        EXPECT_EQ(static_cast<std::size_t>(moduleCount * 4), registered);
+        EXPECT_EQ(static_cast<std::size_t>(moduleCount * 8), subscribed);
+
+        // Loading a patch does not start the dispatch workers
+        EXPECT_EQ(0u, broker->getWorkerPoolStats().currentWorkers);
+        ASSERT_TRUE(broker->publish(serialization::createMsgPackMessage("patch/module0/out0", 1, 1.0f)));
+        EXPECT_GE(broker->getWorkerPoolStats().currentWorkers, 1u);
+    };
+
+    load(false, "Per-topic registration");
+    load(true, "Bulk registration");
+}
+
+// Latency of the last subscriber of a large fan-out, serial versus parallel
+TEST(MCPDispatchBenchmark, ParallelFanout) {
+    class ClockSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            // A little work per callback, like a module updating its state
+            auto until = std::chrono::steady_clock::now() + std::chrono::microseconds(2);
+            while (std::chrono::steady_clock::now() < until) {}
+            
+            int tick = serialization::extractMessageData<int>(message);
+            if (tick != m_lastTick + 1) {
+                m_outOfOrder = true;
+            }
+            m_lastTick = tick;
+            m_received = std::chrono::steady_clock::now();
+        }
+        int m_lastTick = 0;
+        bool m_outOfOrder = false;
+        std::chrono::steady_clock::time_point m_received;
+    };
+
+    const int ticks = 50;
+    for (std::size_t subscriberCount : {16u, 64u, 256u, 1024u}) {
+        for (bool parallel : {false, true}) {
+            auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+            broker->setParallelFanout(parallel ? 32 : 0);
+            std::vector<std::shared_ptr<ClockSubscriber>> subscribers;
+            for (std::size_t i = 0; i < subscriberCount; ++i) {
+                subscribers.push_back(std::make_shared<ClockSubscriber>());
+                ASSERT_TRUE(broker->subscribe("system/clock", subscribers.back()));
+            }
+            
+            double totalLatency = 0.0;
+            for (int tick = 1; tick <= ticks; ++tick) {
+                auto message = serialization::createMsgPackMessage("system/clock", 1, tick);
+                auto published = message->timestamp;
+                ASSERT_TRUE(broker->publish(message));
+                broker->pump();
+                
+                auto last = published;
+                for (const auto& subscriber : subscribers) {
+                    last = std::max(last, subscriber->m_received);
+                }
+                totalLatency += std::chrono::duration<double, std::micro>(last - published).count();
+            }
+            
+            std::cout << (parallel ? "Parallel" : "Serial") << " fan-out to " << subscriberCount
+                      << " subscribers: last subscriber after " << std::fixed << std::setprecision(1)
+                      << totalLatency / ticks << " us" << std::endl;
+            for (const auto& subscriber : subscribers) {
+                EXPECT_EQ(ticks, subscriber->m_lastTick);
+                EXPECT_FALSE(subscriber->m_outOfOrder);
+            }
+        }
+    }
+}
+
 }} // namespace mcp::test 
\ No newline at end of file
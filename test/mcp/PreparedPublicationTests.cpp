@@ -0,0 +1,175 @@
+#include "mcp/MCPBroker.h"
+#include "mcp/MCPPreparedPublication.h"
+#include "mcp/MCPSerialization.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include <set>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <atomic>
+
+namespace mcp {
+namespace test {
+
+namespace {
+
+// Subscriber that decodes floats and remembers which message objects it saw,
+// without keeping any reference to them
+class FloatSubscriber : public IMCPSubscriber_V1 {
+public:
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        float value = serialization::extractMessageData<float>(message);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_values.push_back(value);
+        m_messageObjects.insert(message);
+    }
+
+    std::size_t count() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_values.size();
+    }
+
+    std::vector<float> values() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_values;
+    }
+
+    std::size_t distinctMessageObjects() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_messageObjects.size();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<float> m_values;
+    std::set<const MCPMessage_V1*> m_messageObjects;
+};
+
+// Subscriber that keeps every payload alive
+class RetainingSubscriber : public IMCPSubscriber_V1 {
+public:
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_retained.push_back(message->data);
+    }
+
+    std::size_t count() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_retained.size();
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<void>> m_retained;
+};
+
+template<typename Predicate>
+bool waitUntil(Predicate predicate) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (predicate()) {
+            return true;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return predicate();
+}
+
+} // anonymous namespace
+
+// Steady-state publishing reuses the same few message objects
+TEST(PreparedPublicationTest, RecyclesMessagesInSteadyState) {
+    auto broker = std::make_shared<MCPBroker>();
+    auto subscriber = std::make_shared<FloatSubscriber>();
+    ASSERT_TRUE(broker->subscribe("prepared/float", subscriber));
+
+    PreparedPublication publication(broker, "prepared/float", 7, DataFormat::MSGPACK, 16, 2, 8);
+    EXPECT_EQ("prepared/float", publication.getTopic());
+    EXPECT_EQ(2u, publication.getSlotCount());
+
+    const int count = 500;
+    for (int i = 0; i < count; ++i) {
+        ASSERT_TRUE(publication.publish(static_cast<float>(i)));
+        ASSERT_TRUE(waitUntil([&] { return subscriber->count() == static_cast<size_t>(i + 1); }));
+    }
+
+    auto values = subscriber->values();
+    ASSERT_EQ(static_cast<size_t>(count), values.size());
+    for (int i = 0; i < count; ++i) {
+        EXPECT_FLOAT_EQ(static_cast<float>(i), values[i]);
+    }
+
+    EXPECT_EQ(static_cast<uint64_t>(count), publication.getPublishedCount());
+    EXPECT_EQ(0u, publication.getReplacedCount());
+    EXPECT_LE(publication.getSlotCount(), 8u);
+    EXPECT_LE(subscriber->distinctMessageObjects(), publication.getSlotCount());
+}
+
+// Storage still referenced by a subscriber is never overwritten
+TEST(PreparedPublicationTest, DoesNotReuseRetainedStorage) {
+    auto broker = std::make_shared<MCPBroker>();
+    auto subscriber = std::make_shared<RetainingSubscriber>();
+    ASSERT_TRUE(broker->subscribe("prepared/retained", subscriber));
+
+    PreparedPublication publication(broker, "prepared/retained", 7, DataFormat::MSGPACK, 16, 1, 3);
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(publication.publish(1.0f));
+        ASSERT_TRUE(waitUntil([&] { return subscriber->count() == static_cast<size_t>(i + 1); }));
+    }
+    EXPECT_EQ(3u, publication.getSlotCount());
+
+    // Every pooled payload is still held, so the next publish replaces one
+    // in the pool instead of overwriting it
+    ASSERT_TRUE(publication.publish(2.0f));
+    ASSERT_TRUE(waitUntil([&] { return subscriber->count() == 4u; }));
+    EXPECT_EQ(3u, publication.getSlotCount());
+    EXPECT_EQ(1u, publication.getReplacedCount());
+    EXPECT_EQ(4u, publication.getPublishedCount());
+
+    // Payload larger than the prepared capacity is rejected
+    uint8_t big[32] = {};
+    EXPECT_FALSE(publication.publishBytes(big, sizeof(big)));
+}
+
+// A history ring keeping messages alive neither starves nor corrupts the pool
+TEST(PreparedPublicationTest, PublishesOnTopicWithHistory) {
+    auto broker = std::make_shared<MCPBroker>();
+    HistoryConfig history;
+    history.maxMessages = 16;
+    broker->enableHistory("prepared/history", history);
+    auto subscriber = std::make_shared<FloatSubscriber>();
+    ASSERT_TRUE(broker->subscribe("prepared/history", subscriber));
+
+    PreparedPublication publication(broker, "prepared/history", 7, DataFormat::MSGPACK, 16, 2, 4);
+    const int count = 100;
+    for (int i = 0; i < count; ++i) {
+        ASSERT_TRUE(publication.publish(static_cast<float>(i)));
+        ASSERT_TRUE(waitUntil([&] { return subscriber->count() == static_cast<size_t>(i + 1); }));
+    }
+
+    EXPECT_EQ(static_cast<uint64_t>(count), publication.getPublishedCount());
+    EXPECT_EQ(0u, publication.getReplacedCount());
+    EXPECT_LE(publication.getSlotCount(), 20u);
+
+    // The ring still holds the values it recorded
+    auto retained = broker->getHistory("prepared/history");
+    ASSERT_EQ(16u, retained.size());
+    for (std::size_t i = 0; i < retained.size(); ++i) {
+        EXPECT_FLOAT_EQ(static_cast<float>(count - 16 + static_cast<int>(i)),
+                        serialization::extractMessageData<float>(retained[i].get()));
+    }
+
+    // Without the sizing (history enabled after the fact) it still publishes
+    PreparedPublication late(broker, "prepared/other", 7, DataFormat::MSGPACK, 16, 1, 2);
+    broker->enableHistory("prepared/other", history);
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_TRUE(late.publish(static_cast<float>(i)));
+    }
+    EXPECT_EQ(8u, late.getPublishedCount());
+    EXPECT_GT(late.getReplacedCount(), 0u);
+}
+
+} // namespace test
+} // namespace mcp
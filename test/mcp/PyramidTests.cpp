@@ -0,0 +1,134 @@
+#include "mcp/MCPBroker.h"
+#include "mcp/MCPPyramid.h"
+#include "mcp/MCPSerialization.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <cmath>
+
+namespace mcp {
+namespace test {
+
+namespace {
+
+// Records whether each message carried a full array or a decimated level
+class ResolutionSubscriber : public IMCPSubscriber_V1 {
+public:
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        try {
+            m_levels.push_back(serialization::extractMessageData<MinMaxLevel>(message));
+        } catch (const MCPSerializationError& e) {
+            m_fullSizes.push_back(serialization::extractMessageData<std::vector<float>>(message).size());
+        }
+    }
+
+    std::vector<MinMaxLevel> levels() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_levels;
+    }
+
+    std::vector<std::size_t> fullSizes() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_fullSizes;
+    }
+
+private:
+    std::mutex m_mutex;
+    std::vector<MinMaxLevel> m_levels;
+    std::vector<std::size_t> m_fullSizes;
+};
+
+std::vector<float> makeSignal(std::size_t size) {
+    std::vector<float> samples(size);
+    for (std::size_t i = 0; i < size; ++i) {
+        samples[i] = std::sin(static_cast<float>(i) * 0.37f) * static_cast<float>(i % 7);
+    }
+    return samples;
+}
+
+} // anonymous namespace
+
+// Every level matches a straightforward per-bin reduction of the source
+TEST(MinMaxPyramidTest, LevelsMatchNaiveReduction) {
+    // Odd size exercises the carried-over bins and the scalar remainder
+    auto samples = makeSignal(1001);
+    MinMaxPyramid pyramid(samples, 10);
+    ASSERT_GT(pyramid.getLevelCount(), 0u);
+
+    for (std::size_t l = 0; l < pyramid.getLevelCount(); ++l) {
+        const MinMaxLevel& level = pyramid.getLevel(l);
+        EXPECT_EQ(2u << l, level.binSize);
+        EXPECT_EQ(1001u, level.sourceSize);
+        ASSERT_EQ((samples.size() + level.binSize - 1) / level.binSize, level.size());
+
+        for (std::size_t bin = 0; bin < level.size(); ++bin) {
+            auto first = samples.begin() + bin * level.binSize;
+            auto last = samples.begin() + std::min(samples.size(), (bin + 1) * level.binSize);
+            EXPECT_EQ(*std::min_element(first, last), level.min[bin]);
+            EXPECT_EQ(*std::max_element(first, last), level.max[bin]);
+        }
+    }
+
+    // The coarsest level stops at the requested resolution
+    EXPECT_LE(pyramid.getLevel(pyramid.getLevelCount() - 1).size(), 10u);
+
+    // Means of full bins are exact
+    const MinMaxLevel& finest = pyramid.getLevel(0);
+    EXPECT_FLOAT_EQ((samples[2] + samples[3]) * 0.5f, finest.mean[1]);
+
+    // Level selection picks the coarsest level that is still wide enough
+    int selected = pyramid.selectLevel(100);
+    ASSERT_GE(selected, 0);
+    EXPECT_GE(pyramid.getLevel(selected).size(), 100u);
+    if (selected + 1 < static_cast<int>(pyramid.getLevelCount())) {
+        EXPECT_LT(pyramid.getLevel(selected + 1).size(), 100u);
+    }
+    EXPECT_EQ(-1, pyramid.selectLevel(600));
+}
+
+// Subscribers with a target resolution get a decimated level, others the full array
+TEST(MinMaxPyramidTest, BrokerDeliversRequestedResolution) {
+    auto broker = std::make_shared<MCPBroker>();
+    broker->enablePyramid("com.vcvrack.core/spectrum");
+
+    auto full = std::make_shared<ResolutionSubscriber>();
+    auto narrow = std::make_shared<ResolutionSubscriber>();
+    SubscriptionOptions options;
+    options.targetResolution = 200;
+    ASSERT_TRUE(broker->subscribe("com.vcvrack.core/spectrum", full));
+    ASSERT_TRUE(broker->subscribe("com.vcvrack.core/spectrum", narrow, options));
+
+    auto samples = makeSignal(4096);
+    auto message = serialization::createMsgPackMessage("com.vcvrack.core/spectrum", 1, samples);
+    std::size_t fullBytes = message->dataSize;
+    ASSERT_TRUE(broker->publish(message));
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((full->fullSizes().empty() || narrow->levels().empty()) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    ASSERT_EQ(1u, full->fullSizes().size());
+    EXPECT_EQ(4096u, full->fullSizes()[0]);
+
+    ASSERT_EQ(1u, narrow->levels().size());
+    MinMaxLevel level = narrow->levels()[0];
+    EXPECT_GE(level.size(), 200u);
+    EXPECT_LT(level.size(), 400u);
+    EXPECT_EQ(4096u, level.sourceSize);
+    EXPECT_EQ(*std::max_element(samples.begin(), samples.end()),
+              *std::max_element(level.max.begin(), level.max.end()));
+
+    // The decimated payload is a fraction of the full array
+    auto encoded = serialization::createMsgPackMessage("x", 1, level);
+    EXPECT_LT(encoded->dataSize * 4, fullBytes);
+}
+
+} // namespace test
+} // namespace mcp
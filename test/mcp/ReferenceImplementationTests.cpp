@@ -175,4 +175,49 @@ TEST_F(ReferenceImplementationTest, ThreadSafeCommunication) {
     int expectedProcessCycles = 500 / 6; // Time / audio processing interval
     int tolerance = expectedProcessCycles / 2; // Allow for significant timing variation in tests
     EXPECT_NEAR(processedCount.load(), expectedProcessCycles, tolerance);
-} 
\ No newline at end of file
+}
+
+// Deliveries on several topics at once with a multi-worker pool
+TEST_F(ReferenceImplementationTest, ConcurrentTopicsWithWorkerPool) {
+    mcp::WorkerPoolConfig config;
+    config.minWorkers = 4;
+    config.maxWorkers = 4;
+    m_broker->setWorkerPoolConfig(config);
+    
+    auto subscriber = std::make_shared<mcp::MCPReferenceSubscriber>(2002);
+    subscriber->onAdd();
+    
+    // Drain on a simulated audio thread while two topics are published
+    std::atomic<bool> running(true);
+    auto processingThread = std::thread([&]() {
+        rack::engine::setThreadType(rack::engine::AUDIO_THREAD);
+        float buffer[64];
+        while (running.load()) {
+            subscriber->process(buffer, 64);
+            std::this_thread::sleep_for(std::chrono::microseconds(200));
+        }
+    });
+    
+    const int count = 2000;
+    for (int i = 1; i <= count; ++i) {
+        m_broker->publish(mcp::serialization::createMsgPackMessage("reference/parameter1", 1, static_cast<float>(i)));
+        m_broker->publish(mcp::serialization::createMsgPackMessage("reference/parameter2", 1, static_cast<float>(-i)));
+    }
+    
+    // State topics conflate while the ring is full, so the latest values arrive
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while ((subscriber->getParameter(1) != count || subscriber->getParameter(2) != -count) &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    running.store(false);
+    processingThread.join();
+    subscriber->onRemove();
+    m_broker->setWorkerPoolConfig(mcp::WorkerPoolConfig());
+    
+    EXPECT_EQ(static_cast<float>(count), subscriber->getParameter(1));
+    EXPECT_EQ(static_cast<float>(-count), subscriber->getParameter(2));
+    EXPECT_EQ(subscriber->getTotalMessagesReceived(),
+              subscriber->getMessageCount("reference/parameter1") +
+              subscriber->getMessageCount("reference/parameter2"));
+}
@@ -0,0 +1,214 @@
+#include "mcp/MCPSequencedLog.h"
+#include "mcp/MCPBroker.h"
+#include "mcp/MCPSerialization.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+namespace mcp {
+namespace test {
+
+namespace {
+
+// Subscriber that checks it sees message IDs strictly in publish order
+class SequenceCheckingSubscriber : public IMCPSubscriber_V1 {
+public:
+    void onMCPMessage(const MCPMessage_V1* message) override {
+        if (message->messageId != m_expected) {
+            m_outOfOrder = true;
+        }
+        m_expected = message->messageId + 1;
+        m_count++;
+    }
+
+    uint64_t count() const { return m_count; }
+    bool outOfOrder() const { return m_outOfOrder; }
+
+private:
+    uint64_t m_expected = 0;
+    std::atomic<uint64_t> m_count{0};
+    std::atomic<bool> m_outOfOrder{false};
+};
+
+std::shared_ptr<MCPMessage_V1> makeMessage(const std::string& topic, uint64_t id) {
+    auto message = serialization::createMsgPackMessage(topic, 1, static_cast<int>(id));
+    message->messageId = id;
+    return message;
+}
+
+} // anonymous namespace
+
+// The producer is gated by the slowest consumer and consumers read in batches
+TEST(SequencedLogTest, GatingAndBatchReads) {
+    SequencedLog<int> log(3, 2);
+    EXPECT_EQ(4u, log.capacity());
+
+    auto fast = log.addConsumer();
+    auto slow = log.addConsumer();
+    ASSERT_NE(nullptr, fast);
+    ASSERT_NE(nullptr, slow);
+    EXPECT_EQ(nullptr, log.addConsumer());
+
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_TRUE(log.tryPublish(i));
+    }
+    EXPECT_FALSE(log.tryPublish(4));
+
+    std::vector<int> values;
+    std::vector<bool> batchEnds;
+    EXPECT_EQ(4u, fast->poll([&](const int& value, uint64_t sequence, bool endOfBatch) {
+        EXPECT_EQ(static_cast<uint64_t>(value), sequence);
+        values.push_back(value);
+        batchEnds.push_back(endOfBatch);
+    }));
+    EXPECT_EQ((std::vector<int>{0, 1, 2, 3}), values);
+    EXPECT_EQ((std::vector<bool>{false, false, false, true}), batchEnds);
+
+    // The slow consumer still holds every slot
+    EXPECT_FALSE(log.tryPublish(4));
+    EXPECT_EQ(4u, slow->backlog());
+
+    EXPECT_EQ(2u, slow->poll([](const int&, uint64_t, bool) {}, 2));
+    EXPECT_TRUE(log.tryPublish(4));
+    EXPECT_TRUE(log.tryPublish(5));
+    EXPECT_FALSE(log.tryPublish(6));
+
+    // A detached consumer no longer gates the producer
+    log.removeConsumer(slow);
+    EXPECT_EQ(nullptr, slow);
+    EXPECT_EQ(2u, fast->poll([](const int&, uint64_t, bool) {}));
+    EXPECT_TRUE(log.tryPublish(6));
+
+    // New consumers start at the head of the log
+    auto late = log.addConsumer();
+    ASSERT_NE(nullptr, late);
+    EXPECT_EQ(7u, late->position());
+    EXPECT_EQ(0u, late->backlog());
+}
+
+// Consumers joining and leaving while the producer runs never read an overwritten slot
+TEST(SequencedLogTest, ConsumersJoinWhilePublishing) {
+    SequencedLog<uint64_t> log(8, 2);
+    const uint64_t entryCount = 200000;
+
+    std::thread producer([&] {
+        for (uint64_t sequence = 0; sequence < entryCount; ++sequence) {
+            log.publish(sequence);
+        }
+    });
+
+    bool mismatch = false;
+    uint64_t read = 0;
+    while (log.published() < entryCount) {
+        auto consumer = log.addConsumer();
+        ASSERT_NE(nullptr, consumer);
+        for (int batch = 0; batch < 4; ++batch) {
+            read += consumer->poll([&](const uint64_t& value, uint64_t sequence, bool) {
+                mismatch = mismatch || value != sequence;
+            });
+            std::this_thread::yield();
+        }
+        log.removeConsumer(consumer);
+    }
+    producer.join();
+
+    EXPECT_FALSE(mismatch);
+    EXPECT_GT(read, 0u);
+}
+
+// Many subscribers consume one producer's stream concurrently, in order
+TEST(SequencedLogTest, ConcurrentFanOutThroughAdapters) {
+    SequencedMessageLog log(256, 8);
+
+    const int subscriberCount = 4;
+    const uint64_t messageCount = 20000;
+    std::vector<std::shared_ptr<SequenceCheckingSubscriber>> subscribers;
+    std::vector<std::unique_ptr<SequencedLogSubscriber>> adapters;
+    for (int i = 0; i < subscriberCount; ++i) {
+        subscribers.push_back(std::make_shared<SequenceCheckingSubscriber>());
+        adapters.emplace_back(new SequencedLogSubscriber(log, subscribers.back()));
+        ASSERT_TRUE(adapters.back()->isAttached());
+        adapters.back()->start();
+    }
+
+    // Build the messages up front so the loop measures only the log
+    std::vector<std::shared_ptr<MCPMessage_V1>> messages;
+    for (uint64_t id = 0; id < messageCount; ++id) {
+        messages.push_back(makeMessage("log/stream", id));
+    }
+    for (const auto& message : messages) {
+        log.publish(message);
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    for (const auto& subscriber : subscribers) {
+        while (subscriber->count() < messageCount && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    for (int i = 0; i < subscriberCount; ++i) {
+        adapters[i]->stop();
+        EXPECT_EQ(messageCount, subscribers[i]->count());
+        EXPECT_EQ(messageCount, adapters[i]->getDeliveredCount());
+        EXPECT_FALSE(subscribers[i]->outOfOrder());
+    }
+}
+
+// Adapters can filter by topic and be drained from an existing thread
+TEST(SequencedLogTest, ManualDrainWithTopicFilter) {
+    SequencedMessageLog log(16, 2);
+    auto subscriber = std::make_shared<SequenceCheckingSubscriber>();
+    SequencedLogSubscriber adapter(log, subscriber, "log/wanted");
+
+    log.publish(makeMessage("log/wanted", 0));
+    log.publish(makeMessage("log/other", 7));
+    log.publish(makeMessage("log/wanted", 1));
+
+    EXPECT_EQ(3u, adapter.drain(2));
+    EXPECT_EQ(2u, subscriber->count());
+    EXPECT_FALSE(subscriber->outOfOrder());
+    EXPECT_EQ(0u, adapter.drain());
+}
+
+// Subscriber failures are reported to the broker the adapter was given
+TEST(SequencedLogTest, ReportsFailuresToGivenBroker) {
+    class FailingSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            throw std::runtime_error("cannot handle entry");
+        }
+    };
+    class ReportSubscriber : public IMCPSubscriber_V1 {
+    public:
+        void onMCPMessage(const MCPMessage_V1* message) override {
+            m_reports.push_back(serialization::extractMessageData<ErrorReport>(message));
+        }
+        std::vector<ErrorReport> m_reports;
+    };
+
+    auto broker = std::make_shared<MCPBroker>(DispatchMode::MANUAL_PUMP);
+    auto reports = std::make_shared<ReportSubscriber>();
+    ASSERT_TRUE(broker->subscribe(ERROR_REPORTS_TOPIC, reports));
+
+    SequencedMessageLog log(16, 1);
+    auto failing = std::make_shared<FailingSubscriber>();
+    SequencedLogSubscriber adapter(log, failing, std::string(), broker);
+    log.publish(makeMessage("log/wanted", 0));
+    log.publish(makeMessage("log/wanted", 1));
+    EXPECT_EQ(2u, adapter.drain());
+
+    broker->pump();
+    ASSERT_EQ(1u, reports->m_reports.size());
+    EXPECT_EQ("mcp.sequenced-log", reports->m_reports[0].source);
+    EXPECT_EQ(ErrorCode::SUBSCRIBER_FAILED, reports->m_reports[0].code);
+    EXPECT_EQ(0u, reports->m_reports[0].message.find("cannot handle entry (subscriber "));
+    EXPECT_NE(std::string::npos, reports->m_reports[0].message.find("FailingSubscriber"));
+    EXPECT_EQ(2u, reports->m_reports[0].count);
+}
+
+} // namespace test
+} // namespace mcp
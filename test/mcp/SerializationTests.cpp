@@ -1,5 +1,6 @@
 #include "mcp/MCPMessage_V1.h"
 #include "mcp/MCPSerialization.h"
+#include "mcp/MCPPyramid.h"
 #include "../../external/msgpack11/msgpack11.hpp"
 #include <gtest/gtest.h>
 #include <string>
@@ -154,4 +155,59 @@ TEST_F(SerializationTest, SerializationErrors) {
         mcp::serialization::extractMessageData<std::string>(&invalidMessage),
         mcp::MCPSerializationError
     );
-} 
\ No newline at end of file
+}
+
+// Test allocation-free encoding into a caller-owned buffer
+TEST_F(SerializationTest, EncodeIntoBuffer) {
+    uint8_t buffer[256];
+    
+    // Every encoding must round-trip through the regular decoder
+    std::size_t size = mcp::serialization::encodeMsgPackInto(2.5f, buffer, sizeof(buffer));
+    ASSERT_GT(size, 0u);
+    EXPECT_FLOAT_EQ(2.5f, mcp::serialization::deserializeFromMsgPack<float>(buffer, size));
+    
+    size = mcp::serialization::encodeMsgPackInto(simpleDouble, buffer, sizeof(buffer));
+    ASSERT_GT(size, 0u);
+    EXPECT_DOUBLE_EQ(simpleDouble, mcp::serialization::deserializeFromMsgPack<double>(buffer, size));
+    
+    int negative = -123456;
+    size = mcp::serialization::encodeMsgPackInto(negative, buffer, sizeof(buffer));
+    ASSERT_GT(size, 0u);
+    EXPECT_EQ(negative, mcp::serialization::deserializeFromMsgPack<int>(buffer, size));
+    
+    std::string longString(100, 'x');
+    size = mcp::serialization::encodeMsgPackInto(longString, buffer, sizeof(buffer));
+    ASSERT_GT(size, 0u);
+    EXPECT_EQ(longString, mcp::serialization::deserializeFromMsgPack<std::string>(buffer, size));
+    
+    std::vector<float> longArray(20, 0.25f);
+    size = mcp::serialization::encodeMsgPackInto(longArray, buffer, sizeof(buffer));
+    ASSERT_GT(size, 0u);
+    EXPECT_EQ(longArray, mcp::serialization::deserializeFromMsgPack<std::vector<float>>(buffer, size));
+    
+    // Too small a buffer writes nothing
+    EXPECT_EQ(0u, mcp::serialization::encodeMsgPackInto(simpleDouble, buffer, 4));
+    EXPECT_EQ(0u, mcp::serialization::encodeMsgPackInto(longArray, buffer, 64));
+}
+
+// Test MinMaxLevel round trip
+TEST_F(SerializationTest, MinMaxLevelRoundTrip) {
+    mcp::MinMaxLevel level;
+    level.min = {-1.0f, -0.5f};
+    level.max = {1.0f, 0.75f};
+    level.mean = {0.0f, 0.125f};
+    level.binSize = 512;
+    level.sourceSize = 1024;
+    
+    auto message = mcp::serialization::createMsgPackMessage("level", 1, level);
+    mcp::MinMaxLevel decoded = mcp::serialization::extractMessageData<mcp::MinMaxLevel>(message.get());
+    EXPECT_EQ(level.min, decoded.min);
+    EXPECT_EQ(level.max, decoded.max);
+    EXPECT_EQ(level.mean, decoded.mean);
+    EXPECT_EQ(512u, decoded.binSize);
+    EXPECT_EQ(1024u, decoded.sourceSize);
+    
+    // A plain array is not a level
+    auto array = mcp::serialization::createMsgPackMessage("level", 1, std::vector<float>{1.0f});
+    EXPECT_THROW(mcp::serialization::extractMessageData<mcp::MinMaxLevel>(array.get()), mcp::MCPSerializationError);
+}